@@ -317,10 +317,111 @@ class QueryBench final : public td::Benchmark {
   td::ActorOwn<ServerActor> server_;
 };
 
+template <int type>
+class SendToBusyActorBench final : public td::Benchmark {
+  static constexpr int EVENTS_PER_ROUND = 100;
+
+ public:
+  struct SenderActor;
+
+  struct TargetActor final : public td::Actor {
+    td::ActorId<SenderActor> sender;
+    int left_rounds = 0;
+    int received_n = 0;
+
+    void send_round() {
+      // the actor is running, so all events are added to its mailbox
+      for (int i = 0; i < EVENTS_PER_ROUND; i++) {
+        send_closure(actor_id(this), &TargetActor::on_event);
+      }
+    }
+
+    void hop() {
+      // the events will be sent by the sender before the actor is registered on the main scheduler
+      send_closure(sender, &SenderActor::on_ping);
+      migrate(0);
+    }
+
+    void start_round() {
+      if (type == 0) {
+        send_round();
+      } else {
+        hop();
+      }
+    }
+
+    void on_event() {
+      if (++received_n < EVENTS_PER_ROUND) {
+        return;
+      }
+      received_n = 0;
+      if (--left_rounds == 0) {
+        td::Scheduler::instance()->finish();
+        return;
+      }
+      if (type == 0) {
+        send_round();
+      } else {
+        send_closure_later(actor_id(this), &TargetActor::hop);
+        migrate(1);
+      }
+    }
+  };
+
+  struct SenderActor final : public td::Actor {
+    td::ActorId<TargetActor> target;
+
+    void on_ping() {
+      for (int i = 0; i < EVENTS_PER_ROUND; i++) {
+        send_closure(target, &TargetActor::on_event);
+      }
+    }
+  };
+
+ private:
+  td::ConcurrentScheduler *scheduler_ = nullptr;
+  td::ActorId<TargetActor> target_;
+
+ public:
+  td::string get_description() const final {
+    static const char *types[] = {"running", "migrating"};
+    static_assert(0 <= type && type < 2, "");
+    return PSTRING() << "SendToBusyActor (" << types[type] << ")";
+  }
+
+  void start_up() final {
+    scheduler_ = new td::ConcurrentScheduler();
+    scheduler_->init(type);
+    target_ = scheduler_->create_actor_unsafe<TargetActor>(type, "TargetActor").release();
+    auto sender = scheduler_->create_actor_unsafe<SenderActor>(0, "SenderActor").release();
+    target_.get_actor_unsafe()->sender = sender;
+    sender.get_actor_unsafe()->target = target_;
+    scheduler_->start();
+  }
+
+  void run(int n) final {
+    target_.get_actor_unsafe()->left_rounds = td::max(n / EVENTS_PER_ROUND, 1);
+    {
+      auto guard = scheduler_->get_main_guard();
+      send_closure(target_, &TargetActor::start_round);
+    }
+    while (scheduler_->run_main(10)) {
+      // empty
+    }
+  }
+
+  void tear_down() final {
+    scheduler_->finish();
+    delete scheduler_;
+  }
+};
+
 int main() {
   td::init_openssl_threads();
 
   bench(CreateActorBench());
+  bench(SendToBusyActorBench<0>());
+  bench(SendToBusyActorBench<1>());
   bench(RingBench<4>(504, 0));
   bench(RingBench<3>(504, 0));
   bench(RingBench<0>(504, 0));
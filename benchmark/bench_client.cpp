@@ -0,0 +1,85 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2021
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/Client.h"
+#include "td/telegram/td_api.h"
+
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/SliceBuilder.h"
+
+#include <memory>
+
+// requests are sent to the same clients from several threads simultaneously
+class ClientManagerSendBench final : public td::Benchmark {
+ public:
+  explicit ClientManagerSendBench(int threads_n) : threads_n_(threads_n) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "ClientManager::send from " << threads_n_ << " threads";
+  }
+
+  void start_up() final {
+    client_manager_ = std::make_unique<td::ClientManager>();
+    client_ids_.clear();
+    for (int i = 0; i < CLIENT_COUNT; i++) {
+      client_ids_.push_back(client_manager_->create_client_id());
+    }
+    // create all Td instances before the measurement
+    for (auto client_id : client_ids_) {
+      client_manager_->send(client_id, 1, td::td_api::make_object<td::td_api::testSquareInt>(3));
+    }
+    wait_responses(CLIENT_COUNT);
+  }
+
+  void run(int n) final {
+    td::vector<td::thread> threads;
+    for (int thread_id = 0; thread_id < threads_n_; thread_id++) {
+      threads.emplace_back([&, thread_id] {
+        for (int i = thread_id; i < n; i += threads_n_) {
+          auto client_id = client_ids_[i % client_ids_.size()];
+          client_manager_->send(client_id, 2, td::td_api::make_object<td::td_api::testSquareInt>(i));
+        }
+      });
+    }
+    wait_responses(n);
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  void tear_down() final {
+    client_manager_ = nullptr;
+  }
+
+ private:
+  static constexpr int CLIENT_COUNT = 16;
+
+  int threads_n_;
+  std::unique_ptr<td::ClientManager> client_manager_;
+  td::vector<td::ClientManager::ClientId> client_ids_;
+
+  void wait_responses(int count) {
+    while (count > 0) {
+      auto response = client_manager_->receive(10.0);
+      if (response.object != nullptr && response.request_id != 0) {
+        CHECK(response.object->get_id() == td::td_api::testInt::ID);
+        count--;
+      }
+    }
+  }
+};
+
+int main() {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(WARNING));
+  td::ClientManager::execute(td::td_api::make_object<td::td_api::setLogVerbosityLevel>(1));
+  for (int threads_n : {1, 2, 4, 8, 16}) {
+    td::bench(ClientManagerSendBench(threads_n));
+  }
+}
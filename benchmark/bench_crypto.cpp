@@ -133,6 +133,49 @@ class AesIgeDecryptBench final : public td::Benchmark {
   }
 };
 
+// each operation processes one DATA_SIZE message, so the results can be compared with AesIgeEncryptBench
+template <bool is_encrypt>
+class AesIgeMultipleBench final : public td::Benchmark {
+ public:
+  explicit AesIgeMultipleBench(size_t message_count) : message_count_(message_count) {
+  }
+
+  std::string get_description() const final {
+    return PSTRING() << "AES IGE multiple " << (is_encrypt ? "encrypt" : "decrypt") << " [" << (DATA_SIZE >> 10)
+                     << "KB x " << message_count_ << "]";
+  }
+
+  void start_up() final {
+    keys_.resize(message_count_);
+    ivs_.resize(message_count_);
+    messages_.resize(message_count_);
+    data_.resize(message_count_);
+    for (size_t i = 0; i < message_count_; i++) {
+      td::Random::secure_bytes(as_slice(keys_[i]));
+      td::Random::secure_bytes(as_slice(ivs_[i]));
+      messages_[i] = std::string(DATA_SIZE, static_cast<char>(123));
+      data_[i] = {as_slice(keys_[i]), as_slice(ivs_[i]), messages_[i], messages_[i]};
+    }
+  }
+
+  void run(int n) final {
+    for (int i = 0; i < n; i += static_cast<int>(message_count_)) {
+      if (is_encrypt) {
+        td::aes_ige_encrypt_multiple(data_);
+      } else {
+        td::aes_ige_decrypt_multiple(data_);
+      }
+    }
+  }
+
+ private:
+  size_t message_count_;
+  std::vector<td::UInt256> keys_;
+  std::vector<td::UInt256> ivs_;
+  std::vector<std::string> messages_;
+  std::vector<td::AesIgeData> data_;
+};
+
 class AesCtrBench final : public td::Benchmark {
  public:
   alignas(64) unsigned char data[DATA_SIZE];
@@ -401,6 +444,10 @@ int main() {
   td::bench(AesIgeShortBench<false>());
   td::bench(AesIgeEncryptBench());
   td::bench(AesIgeDecryptBench());
+  for (size_t message_count : {1, 2, 4, 8, 32}) {
+    td::bench(AesIgeMultipleBench<true>(message_count));
+    td::bench(AesIgeMultipleBench<false>(message_count));
+  }
   td::bench(AesEcbBench());
 
   td::bench(Pbkdf2Bench());
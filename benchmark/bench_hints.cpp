@@ -0,0 +1,183 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2021
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/format.h"
+#include "td/utils/Hints.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/Stat.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
+
+#include <utility>
+
+static constexpr int DIALOG_COUNT = 100000;
+
+// chat titles and user names built from a small set of syllables, so many words share prefixes
+static td::vector<td::string> create_names(int count) {
+  static const char *syllables[] = {"an",  "na", "ma",  "ri", "ko", "le",  "sa", "to", "vi", "el",
+                                    "mi",  "ja", "ro",  "de", "ka", "li",  "ne", "pe", "ta", "zu",
+                                    "\xd0\xb0\xd0\xbd", "\xd0\xbc\xd0\xb0", "\xd0\xbb\xd0\xb5",
+                                    "\xd1\x80\xd0\xb8"};
+  static const char *words[] = {"Chat", "Group", "Team", "News", "Family", "Work", "Club", "Project"};
+  const int syllable_count = static_cast<int>(sizeof(syllables) / sizeof(syllables[0]));
+  const int word_count = static_cast<int>(sizeof(words) / sizeof(words[0]));
+
+  td::Random::Xorshift128plus rnd(123);
+  td::vector<td::string> result;
+  result.reserve(count);
+  for (int i = 0; i < count; i++) {
+    td::string name;
+    int name_word_count = rnd.fast(1, 3);
+    for (int j = 0; j < name_word_count; j++) {
+      if (j > 0) {
+        name += ' ';
+      }
+      if (rnd.fast(0, 3) == 0) {
+        name += words[rnd.fast(0, word_count - 1)];
+        continue;
+      }
+      int word_syllable_count = rnd.fast(2, 4);
+      for (int k = 0; k < word_syllable_count; k++) {
+        name += syllables[rnd.fast(0, syllable_count - 1)];
+      }
+    }
+    result.push_back(std::move(name));
+  }
+  return result;
+}
+
+static void fill_hints(td::Hints &hints, const td::vector<td::string> &names) {
+  for (size_t i = 0; i < names.size(); i++) {
+    auto key = static_cast<td::int64>(i + 1);
+    hints.add(key, names[i]);
+    hints.set_rating(key, -key);
+  }
+}
+
+class HintsAddBench final : public td::Benchmark {
+ public:
+  td::string get_description() const final {
+    return PSTRING() << "Hints::add of " << DIALOG_COUNT << " dialogs";
+  }
+
+  void start_up() final {
+    names_ = create_names(DIALOG_COUNT);
+  }
+
+  void run(int n) final {
+    for (int i = 0; i < n; i++) {
+      td::Hints hints;
+      fill_hints(hints, names_);
+      td::do_not_optimize_away(hints.size());
+    }
+  }
+
+ private:
+  td::vector<td::string> names_;
+};
+
+class HintsAddAllBench final : public td::Benchmark {
+ public:
+  td::string get_description() const final {
+    return PSTRING() << "Hints::add_all of " << DIALOG_COUNT << " dialogs";
+  }
+
+  void start_up() final {
+    names_ = create_names(DIALOG_COUNT);
+  }
+
+  void run(int n) final {
+    for (int i = 0; i < n; i++) {
+      td::vector<std::pair<td::int64, td::string>> key_names;
+      key_names.reserve(names_.size());
+      for (size_t j = 0; j < names_.size(); j++) {
+        key_names.emplace_back(static_cast<td::int64>(j + 1), names_[j]);
+      }
+      td::Hints hints;
+      hints.add_all(std::move(key_names));
+      td::do_not_optimize_away(hints.size());
+    }
+  }
+
+ private:
+  td::vector<td::string> names_;
+};
+
+// dialog titles change and dialogs are added and removed while the index is used
+class HintsUpdateBench final : public td::Benchmark {
+ public:
+  td::string get_description() const final {
+    return PSTRING() << "Hints::add with changed names in " << DIALOG_COUNT << " dialogs";
+  }
+
+  void start_up() final {
+    names_ = create_names(DIALOG_COUNT * 2);
+    hints_ = td::Hints();
+    fill_hints(hints_, td::vector<td::string>(names_.begin(), names_.begin() + DIALOG_COUNT));
+  }
+
+  void run(int n) final {
+    for (int i = 0; i < n; i++) {
+      auto key = static_cast<td::int64>(i % DIALOG_COUNT + 1);
+      hints_.add(key, names_[(i + DIALOG_COUNT) % names_.size()]);
+    }
+  }
+
+ private:
+  td::vector<td::string> names_;
+  td::Hints hints_;
+};
+
+class HintsSearchBench final : public td::Benchmark {
+ public:
+  explicit HintsSearchBench(td::vector<td::string> queries) : queries_(std::move(queries)) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "Hints::search of " << td::format::as_array(queries_) << " in " << DIALOG_COUNT << " dialogs";
+  }
+
+  void start_up() final {
+    hints_ = td::Hints();
+    fill_hints(hints_, create_names(DIALOG_COUNT));
+  }
+
+  void run(int n) final {
+    size_t total_count = 0;
+    for (int i = 0; i < n; i++) {
+      total_count += hints_.search(queries_[i % queries_.size()], 100).first;
+    }
+    td::do_not_optimize_away(total_count);
+  }
+
+ private:
+  td::vector<td::string> queries_;
+  td::Hints hints_;
+};
+
+static void print_memory_usage() {
+  auto names = create_names(DIALOG_COUNT);
+  auto old_size = td::mem_stat().move_as_ok().resident_size_;
+  td::Hints hints;
+  fill_hints(hints, names);
+  auto new_size = td::mem_stat().move_as_ok().resident_size_;
+  LOG(ERROR) << "Hints with " << hints.size() << " dialogs use " << td::format::as_size(new_size - old_size);
+}
+
+int main() {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+  print_memory_usage();
+  td::bench(HintsAddBench());
+  td::bench(HintsAddAllBench());
+  td::bench(HintsUpdateBench());
+  td::bench(HintsSearchBench({"a", "m", "k", "c"}));
+  td::bench(HintsSearchBench({"ma", "ko", "ri", "te"}));
+  td::bench(HintsSearchBench({"mari", "anle", "kosa", "vide"}));
+  td::bench(HintsSearchBench({"team ma", "ko le", "news ri", "ch a"}));
+}
@@ -0,0 +1,170 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2021
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/td_api.h"
+#include "td/telegram/td_api_json.h"
+
+#include "td/utils/algorithm.h"
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/JsonBuilder.h"
+#include "td/utils/logging.h"
+#include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/StackAllocator.h"
+#include "td/utils/Status.h"
+#include "td/utils/StringBuilder.h"
+
+#include <utility>
+
+namespace td_api = td::td_api;
+
+static td_api::object_ptr<td_api::message> create_message(td::int64 id, td::string text) {
+  auto message = td_api::make_object<td_api::message>();
+  message->id_ = id << 20;
+  message->sender_ = td_api::make_object<td_api::messageSenderUser>(123456789 + id % 10);
+  message->chat_id_ = -1001234567890;
+  message->date_ = 1600000000 + static_cast<td::int32>(id);
+  message->can_be_edited_ = true;
+  message->can_be_forwarded_ = true;
+  message->can_be_deleted_for_all_users_ = true;
+  auto entities = td::transform(td::vector<td::int32>{0, 10, 20}, [](td::int32 offset) {
+    return td_api::make_object<td_api::textEntity>(offset, 5, td_api::make_object<td_api::textEntityTypeBold>());
+  });
+  message->content_ = td_api::make_object<td_api::messageText>(
+      td_api::make_object<td_api::formattedText>(std::move(text), std::move(entities)), nullptr);
+  return message;
+}
+
+// a stream of typical updates and responses: new messages, chat lists and message history
+static td::vector<td_api::object_ptr<td_api::Object>> create_objects() {
+  td::vector<td_api::object_ptr<td_api::Object>> result;
+  td::string ascii_text;
+  for (int i = 0; i < 10; i++) {
+    ascii_text += "Lorem ipsum dolor sit amet, consectetur adipiscing elit. ";
+  }
+  td::string quoted_text = "\"Quoted\" text\nwith a new line and a path C:\\Windows\\";
+  td::string utf8_text = "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82, \xd0\xbc\xd0\xb8\xd1\x80! \xf0\x9f\x91\x8b";
+  td::int64 message_id = 1;
+  for (int i = 0; i < 10; i++) {
+    result.push_back(td_api::make_object<td_api::updateNewMessage>(create_message(message_id++, ascii_text)));
+    result.push_back(td_api::make_object<td_api::updateNewMessage>(create_message(message_id++, quoted_text)));
+    result.push_back(td_api::make_object<td_api::updateNewMessage>(create_message(message_id++, utf8_text)));
+  }
+
+  td::vector<td::int64> chat_ids;
+  for (int i = 0; i < 100; i++) {
+    chat_ids.push_back(-1001234567890 + i);
+  }
+  result.push_back(td_api::make_object<td_api::chats>(static_cast<td::int32>(chat_ids.size()), std::move(chat_ids)));
+
+  td::vector<td_api::object_ptr<td_api::message>> messages;
+  for (int i = 0; i < 100; i++) {
+    messages.push_back(create_message(message_id++, i % 2 == 0 ? ascii_text : utf8_text));
+  }
+  result.push_back(td_api::make_object<td_api::messages>(static_cast<td::int32>(messages.size()), std::move(messages)));
+  return result;
+}
+
+template <bool reuse_buffer>
+class ToJsonBench final : public td::Benchmark {
+ public:
+  td::string get_description() const final {
+    return PSTRING() << "td_api to JSON (" << (reuse_buffer ? "reused buffer" : "new buffer") << ")";
+  }
+
+  void start_up() final {
+    objects_ = create_objects();
+  }
+
+  void run(int n) final {
+    size_t total_size = 0;
+    for (int i = 0; i < n; i++) {
+      auto &object = *objects_[i % objects_.size()];
+      if (reuse_buffer) {
+        // the same way as ClientJson serializes responses
+        builder_.string_builder().clear();
+        builder_.enter_value() << td::ToJson(object);
+        total_size += builder_.string_builder().as_cslice().size();
+      } else {
+        auto buf = td::StackAllocator::alloc(1 << 18);
+        td::JsonBuilder jb(td::StringBuilder(buf.as_slice(), true), -1);
+        jb.enter_value() << td::ToJson(object);
+        output_ = jb.string_builder().as_cslice().str();
+        total_size += output_.size();
+      }
+    }
+    td::do_not_optimize_away(total_size);
+  }
+
+ private:
+  td::vector<td_api::object_ptr<td_api::Object>> objects_;
+  td::JsonBuilder builder_;
+  td::string output_;
+};
+
+// typical requests of bots, which send a lot of messages
+static td::vector<td::string> create_requests() {
+  td::string long_text;
+  for (int i = 0; i < 30; i++) {
+    long_text += "Lorem ipsum dolor sit amet, consectetur adipiscing elit. ";
+  }
+  long_text += "\\\"Quoted\\\" text\\nwith a new line \\u2022 and a non-ASCII character";
+
+  td::vector<td::string> result;
+  for (int i = 0; i < 10; i++) {
+    result.push_back(PSTRING() << "{\"@type\":\"sendMessage\",\"chat_id\":" << -1001234567890 + i
+                               << ",\"input_message_content\":{\"@type\":\"inputMessageText\",\"text\":{\"@type\":"
+                                  "\"formattedText\",\"text\":\""
+                               << long_text
+                               << "\",\"entities\":[{\"@type\":\"textEntity\",\"offset\":0,\"length\":5,\"type\":{\"@type\":"
+                                  "\"textEntityTypeBold\"}}]},\"disable_web_page_preview\":true,\"clear_draft\":false}"
+                                  ",\"@extra\":"
+                               << i << "}");
+  }
+  result.push_back(
+      "{\"@type\":\"getChatHistory\",\"chat_id\":-1001234567890,\"from_message_id\":1048576,\"offset\":0,"
+      "\"limit\":100,\"only_local\":false,\"@extra\":{\"request\":\"history\",\"id\":123}}");
+  result.push_back(
+      "{\"@type\":\"searchMessages\",\"chat_list\":{\"@type\":\"chatListMain\"},\"query\":\"lorem ipsum\","
+      "\"offset_date\":0,\"offset_chat_id\":0,\"offset_message_id\":0,\"limit\":100,\"filter\":null,"
+      "\"min_date\":0,\"max_date\":0,\"@extra\":\"search\"}");
+  return result;
+}
+
+class FromJsonBench final : public td::Benchmark {
+ public:
+  td::string get_description() const final {
+    return "JSON to td_api requests";
+  }
+
+  void start_up() final {
+    requests_ = create_requests();
+  }
+
+  void run(int n) final {
+    size_t total_size = 0;
+    for (int i = 0; i < n; i++) {
+      // the same way as ClientJson parses requests
+      auto request = requests_[i % requests_.size()];
+      auto json_value = td::json_decode(request).move_as_ok();
+      td_api::object_ptr<td_api::Function> function;
+      td_api::from_json(function, std::move(json_value)).ensure();
+      total_size += request.size();
+    }
+    td::do_not_optimize_away(total_size);
+  }
+
+ private:
+  td::vector<td::string> requests_;
+};
+
+int main() {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(WARNING));
+  td::bench(ToJsonBench<false>());
+  td::bench(ToJsonBench<true>());
+  td::bench(FromJsonBench());
+}
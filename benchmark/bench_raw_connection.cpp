@@ -0,0 +1,183 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2021
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/mtproto/AuthKey.h"
+#include "td/mtproto/CryptoWorkerPool.h"
+#include "td/mtproto/KDF.h"
+#include "td/mtproto/ProxySecret.h"
+#include "td/mtproto/RawConnection.h"
+#include "td/mtproto/Transport.h"
+#include "td/mtproto/TransportType.h"
+
+#include "td/utils/as.h"
+#include "td/utils/benchmark.h"
+#include "td/utils/BufferedFd.h"
+#include "td/utils/common.h"
+#include "td/utils/crypto.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/IPAddress.h"
+#include "td/utils/port/SocketFd.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/Status.h"
+#include "td/utils/UInt.h"
+
+#if TD_PORT_POSIX && !TD_THREAD_UNSUPPORTED
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <utility>
+
+// creates a packet in the same way as the server does, framed for the intermediate TCP transport
+static td::string create_server_packet(const td::mtproto::AuthKey &auth_key, size_t data_size) {
+  CHECK(data_size % 4 == 0);
+  constexpr size_t HEADER_SIZE = 8 + 16;
+  constexpr size_t ENCRYPTED_HEADER_SIZE = 8 + 8 + 8 + 4 + 4;
+  size_t encrypted_size = (ENCRYPTED_HEADER_SIZE + data_size + 12 + 15) & ~static_cast<size_t>(15);
+
+  td::string result(4 + HEADER_SIZE + encrypted_size, '\0');
+  td::MutableSlice packet = td::MutableSlice(result).substr(4);
+  td::as<td::uint32>(packet.begin() - 4) = static_cast<td::uint32>(packet.size());
+  td::as<td::uint64>(packet.begin()) = auth_key.id();
+
+  auto to_encrypt = packet.substr(HEADER_SIZE);
+  td::Random::secure_bytes(to_encrypt);
+  td::as<td::uint32>(to_encrypt.begin() + ENCRYPTED_HEADER_SIZE - 4) = static_cast<td::uint32>(data_size);
+
+  auto message_key = td::mtproto::Transport::calc_message_key2(auth_key, 8, to_encrypt).second;
+  packet.substr(8, 16).copy_from(td::as_slice(message_key));
+
+  td::UInt256 aes_key;
+  td::UInt256 aes_iv;
+  td::mtproto::KDF2(auth_key.key(), message_key, 8, &aes_key, &aes_iv);
+  td::aes_ige_encrypt(td::as_slice(aes_key), td::as_slice(aes_iv), to_encrypt, to_encrypt);
+  return result;
+}
+
+class RawConnectionReadBench final : public td::Benchmark {
+ public:
+  RawConnectionReadBench(size_t packet_size, bool use_crypto_workers, bool is_slow_network = false)
+      : packet_size_(packet_size), use_crypto_workers_(use_crypto_workers), is_slow_network_(is_slow_network) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "RawConnection read [" << (packet_size_ >> 10) << "KB]"
+                     << (use_crypto_workers_ ? " with crypto workers" : "")
+                     << (is_slow_network_ ? " from slow network" : "");
+  }
+
+  void start_up() final {
+    td::string key(256, '\0');
+    td::Random::secure_bytes(key);
+    auth_key_ = td::mtproto::AuthKey(td::Random::secure_uint64(), std::move(key));
+
+    packets_.clear();
+    for (int i = 0; i < 16; i++) {
+      packets_.push_back(create_server_packet(auth_key_, packet_size_));
+    }
+  }
+
+  void run(int n) final {
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    auto socket_fd = td::SocketFd::from_native_fd(td::NativeFd(fds[0])).move_as_ok();
+    auto raw_connection = td::mtproto::RawConnection::create(
+        td::IPAddress(), td::BufferedFd<td::SocketFd>(std::move(socket_fd)),
+        td::mtproto::TransportType{td::mtproto::TransportType::Tcp, 0, td::mtproto::ProxySecret()}, nullptr);
+    raw_connection->set_use_crypto_workers(use_crypto_workers_);
+
+    Callback callback(packet_size_);
+    if (is_slow_network_) {
+      // the data is received in small parts, each of them is handled before the next part arrives
+      constexpr size_t PART_SIZE = 16 << 10;
+      for (int i = 0; i < n; i++) {
+        td::Slice packet = packets_[i % packets_.size()];
+        while (!packet.empty()) {
+          auto part = packet.substr(0, PART_SIZE);
+          CHECK(::write(fds[1], part.data(), part.size()) == static_cast<ssize_t>(part.size()));
+          packet.remove_prefix(part.size());
+          raw_connection->get_poll_info().add_flags(td::PollFlags::Read());
+          raw_connection->flush(auth_key_, callback).ensure();
+        }
+      }
+      CHECK(callback.packet_count == n);
+      raw_connection->close();
+      ::close(fds[1]);
+      return;
+    }
+
+    td::thread server([&, fd = fds[1]] {
+      for (int i = 0; i < n; i++) {
+        td::Slice packet = packets_[i % packets_.size()];
+        while (!packet.empty()) {
+          auto written = ::write(fd, packet.data(), packet.size());
+          CHECK(written > 0);
+          packet.remove_prefix(static_cast<size_t>(written));
+        }
+      }
+    });
+
+    while (callback.packet_count < n) {
+      raw_connection->get_poll_info().add_flags(td::PollFlags::Read());
+      raw_connection->flush(auth_key_, callback).ensure();
+    }
+
+    server.join();
+    raw_connection->close();
+    ::close(fds[1]);
+  }
+
+ private:
+  class Callback final : public td::mtproto::RawConnection::Callback {
+   public:
+    explicit Callback(size_t packet_size) : packet_size_(packet_size) {
+    }
+
+    td::Status on_raw_packet(const td::mtproto::PacketInfo &info, td::BufferSlice packet) final {
+      CHECK(packet.size() == packet_size_ + 16);
+      packet_count++;
+      return td::Status::OK();
+    }
+
+    int packet_count = 0;
+
+   private:
+    size_t packet_size_;
+  };
+
+  size_t packet_size_;
+  bool use_crypto_workers_;
+  bool is_slow_network_;
+  td::mtproto::AuthKey auth_key_;
+  td::vector<td::string> packets_;
+};
+
+static void print_throughput(size_t packet_size, bool use_crypto_workers) {
+  RawConnectionReadBench bench(packet_size, use_crypto_workers);
+  int packet_count = static_cast<int>((static_cast<size_t>(1) << 30) / packet_size);
+  auto time = td::bench_n(bench, packet_count).first;
+  LOG(ERROR) << bench.get_description() << ": " << static_cast<double>(packet_size) * packet_count / time / (1 << 20)
+             << " MB/s";
+}
+#endif
+
+int main() {
+  SET_VERBOSITY_LEVEL(VERBOSITY_NAME(ERROR));
+#if TD_PORT_POSIX && !TD_THREAD_UNSUPPORTED
+  LOG(ERROR) << "Use " << td::mtproto::CryptoWorkerPool::get_worker_count() << " crypto worker threads";
+  for (size_t packet_size : {4 << 10, 128 << 10, 512 << 10, 1 << 20}) {
+    td::bench(RawConnectionReadBench(packet_size, false));
+    td::bench(RawConnectionReadBench(packet_size, true));
+    td::bench(RawConnectionReadBench(packet_size, false, true));
+  }
+  for (size_t packet_size : {128 << 10, 1 << 20}) {
+    print_throughput(packet_size, false);
+    print_throughput(packet_size, true);
+  }
+#endif
+}
@@ -10,6 +10,7 @@
 #include "td/telegram/NotificationId.h"
 #include "td/telegram/ServerMessageId.h"
 #include "td/telegram/UserId.h"
+#include "td/telegram/Version.h"
 
 #include "td/db/DbKey.h"
 #include "td/db/SqliteConnectionSafe.h"
@@ -22,8 +23,11 @@
 #include "td/utils/buffer.h"
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
+#include "td/utils/port/Stat.h"
 #include "td/utils/Random.h"
+#include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
+#include "td/utils/tl_helpers.h"
 
 #include <memory>
 
@@ -70,6 +74,9 @@ class MessagesDbBench final : public td::Benchmark {
     scheduler_->run_main(0.1);
     {
       auto guard = scheduler_->get_main_guard();
+      auto statistics = messages_db_async_->get_statistics();
+      LOG(INFO) << "Committed " << statistics.write_count << " writes in " << statistics.transaction_count
+                << " transactions";
       sql_connection_.reset();
       messages_db_sync_safe_.reset();
       messages_db_async_.reset();
@@ -108,7 +115,130 @@ class MessagesDbBench final : public td::Benchmark {
   }
 };
 
+// data similar to a serialized text message: version, flags, message identifier, date, text and entities
+class MessageData {
+ public:
+  MessageData(td::MessageId message_id, td::int32 date) : message_id_(message_id), date_(date) {
+    static const td::vector<td::string> words{"lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing",
+                                              "elit",  "hello", "world", "chat", "bot", "https://t.me/",
+                                              "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82"};
+    auto word_count = td::Random::fast(3, 60);
+    for (int i = 0; i < word_count; i++) {
+      if (i != 0) {
+        text_ += ' ';
+      }
+      text_ += words[td::Random::fast(0, static_cast<int>(words.size()) - 1)];
+    }
+  }
+
+  template <class StorerT>
+  void store(StorerT &storer) const {
+    td::store(static_cast<td::int32>(td::Version::Next) - 1, storer);
+    td::store(static_cast<td::int32>(1 << 3), storer);
+    td::store(message_id_.get(), storer);
+    td::store(date_, storer);
+    td::store(text_, storer);
+    td::store(static_cast<td::int32>(2), storer);
+    for (td::int32 offset : {0, 10}) {
+      td::store(offset, storer);
+      td::store(static_cast<td::int32>(5), storer);
+    }
+  }
+
+ private:
+  td::MessageId message_id_;
+  td::int32 date_;
+  td::string text_;
+};
+
+// size of a database with 100 chats with 200 messages in each and throughput of loading of their history
+class MessagesDbReadBench final : public td::Benchmark {
+ public:
+  explicit MessagesDbReadBench(bool use_data_compression) : use_data_compression_(use_data_compression) {
+  }
+
+  td::string get_description() const final {
+    return PSTRING() << "MessagesDb history load with" << (use_data_compression_ ? "" : "out") << " data compression";
+  }
+
+  void start_up() final {
+    scheduler_ = td::make_unique<td::ConcurrentScheduler>();
+    scheduler_->init(0);
+    auto guard = scheduler_->get_main_guard();
+
+    td::SqliteDb::destroy(path_).ignore();
+    td::SqliteDb::open_with_key(path_, true, td::DbKey::empty()).ensure();
+    sql_connection_ = std::make_shared<td::SqliteConnectionSafe>(path_, td::DbKey::empty());
+    auto &db = sql_connection_->get();
+    init_db(db).ensure();
+    db.exec("BEGIN TRANSACTION").ensure();
+    init_messages_db(db, 0).ensure();
+    db.exec("COMMIT TRANSACTION").ensure();
+
+    messages_db_sync_safe_ = td::create_messages_db_sync(sql_connection_, use_data_compression_);
+    raw_data_size_ = 0;
+    auto &messages_db = messages_db_sync_safe_->get();
+    messages_db.begin_write_transaction().ensure();
+    for (int i = 1; i <= DIALOG_COUNT; i++) {
+      auto dialog_id = td::DialogId(td::UserId(static_cast<td::int64>(i)));
+      for (int j = 1; j <= MESSAGE_COUNT; j++) {
+        auto message_id = td::MessageId{td::ServerMessageId{j}};
+        auto data = td::serialize(MessageData(message_id, 1600000000 + j * 60));
+        messages_db
+            .add_message({dialog_id, message_id}, td::ServerMessageId(), td::UserId(), 0, 0, 0, 0, "",
+                         td::NotificationId(), td::MessageId(), td::BufferSlice(data))
+            .ensure();
+        raw_data_size_ += data.size();
+      }
+    }
+    messages_db.commit_transaction().ensure();
+    db.exec("PRAGMA wal_checkpoint(TRUNCATE)").ensure();
+    LOG(INFO) << "Stored " << raw_data_size_ << " bytes of message data in a database of size "
+              << td::stat(path_).move_as_ok().size_;
+  }
+
+  void run(int n) final {
+    auto guard = scheduler_->get_main_guard();
+    auto &messages_db = messages_db_sync_safe_->get();
+    size_t total_size = 0;
+    for (int i = 0; i < n; i++) {
+      td::MessagesDbMessagesQuery query;
+      query.dialog_id = td::DialogId(td::UserId(static_cast<td::int64>(td::Random::fast(1, DIALOG_COUNT))));
+      query.from_message_id = td::MessageId{td::ServerMessageId{td::Random::fast(100, MESSAGE_COUNT)}};
+      query.limit = 100;
+      for (auto &message : messages_db.get_messages(std::move(query)).move_as_ok()) {
+        total_size += message.data.size();
+      }
+    }
+    td::do_not_optimize_away(total_size);
+  }
+
+  void tear_down() final {
+    {
+      auto guard = scheduler_->get_main_guard();
+      messages_db_sync_safe_.reset();
+      sql_connection_->close_and_destroy();
+      sql_connection_.reset();
+    }
+    scheduler_.reset();
+  }
+
+ private:
+  static constexpr int DIALOG_COUNT = 100;
+  static constexpr int MESSAGE_COUNT = 200;
+
+  bool use_data_compression_;
+  td::string path_ = "bench_messages_db.sqlite";
+  size_t raw_data_size_ = 0;
+  td::unique_ptr<td::ConcurrentScheduler> scheduler_;
+  std::shared_ptr<td::SqliteConnectionSafe> sql_connection_;
+  std::shared_ptr<td::MessagesDbSyncSafeInterface> messages_db_sync_safe_;
+};
+
 int main() {
   SET_VERBOSITY_LEVEL(VERBOSITY_NAME(WARNING));
   td::bench(MessagesDbBench());
+  for (auto use_data_compression : {false, true}) {
+    td::bench(MessagesDbReadBench(use_data_compression));
+  }
 }
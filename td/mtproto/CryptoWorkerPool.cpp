@@ -0,0 +1,148 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2021
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/mtproto/CryptoWorkerPool.h"
+
+#include "td/utils/misc.h"
+#include "td/utils/port/thread.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
+namespace td {
+namespace mtproto {
+
+#if !TD_THREAD_UNSUPPORTED
+namespace {
+
+class WorkerPool {
+ public:
+  struct Job {
+    const std::function<void(size_t)> *f = nullptr;
+    size_t task_count = 0;
+    size_t next_task = 0;
+    size_t finished_task_count = 0;
+  };
+
+  explicit WorkerPool(size_t worker_count) {
+    for (size_t i = 0; i < worker_count; i++) {
+      workers_.emplace_back([this] { loop(); });
+      workers_.back().set_name("CryptoWorker");
+    }
+  }
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+  WorkerPool(WorkerPool &&) = delete;
+  WorkerPool &operator=(WorkerPool &&) = delete;
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      is_closed_ = true;
+    }
+    job_cv_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  size_t get_worker_count() const {
+    return workers_.size();
+  }
+
+  void run(Job &job) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    jobs_.push_back(&job);
+    job_cv_.notify_all();
+
+    // the calling thread executes the tasks too, because it would wait for them anyway
+    while (job.next_task < job.task_count) {
+      run_task(job, lock);
+    }
+    finished_cv_.wait(lock, [&job] { return job.finished_task_count == job.task_count; });
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable job_cv_;
+  std::condition_variable finished_cv_;
+  vector<Job *> jobs_;  // jobs with not started tasks
+  bool is_closed_ = false;
+  vector<thread> workers_;
+
+  void run_task(Job &job, std::unique_lock<std::mutex> &lock) {
+    auto task_id = job.next_task++;
+    if (job.next_task == job.task_count) {
+      jobs_.erase(std::find(jobs_.begin(), jobs_.end(), &job));
+    }
+
+    lock.unlock();
+    (*job.f)(task_id);
+    lock.lock();
+
+    // the job can be destroyed by its owner as soon as the last task is finished
+    if (++job.finished_task_count == job.task_count) {
+      finished_cv_.notify_all();
+    }
+  }
+
+  void loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      job_cv_.wait(lock, [this] { return is_closed_ || !jobs_.empty(); });
+      if (is_closed_) {
+        return;
+      }
+      run_task(*jobs_.front(), lock);
+    }
+  }
+};
+
+size_t calc_worker_count() {
+  // leave at least one core for the scheduler threads
+  auto cpu_count = static_cast<size_t>(thread::hardware_concurrency());
+  return clamp(cpu_count, static_cast<size_t>(1), static_cast<size_t>(5)) - 1;
+}
+
+WorkerPool *get_worker_pool() {
+  static auto worker_count = calc_worker_count();
+  if (worker_count == 0) {
+    return nullptr;
+  }
+  static WorkerPool worker_pool(worker_count);
+  return &worker_pool;
+}
+
+}  // namespace
+#endif
+
+void CryptoWorkerPool::run(size_t task_count, const std::function<void(size_t)> &f) {
+#if !TD_THREAD_UNSUPPORTED
+  auto worker_pool = task_count > 1 ? get_worker_pool() : nullptr;
+  if (worker_pool != nullptr) {
+    WorkerPool::Job job;
+    job.f = &f;
+    job.task_count = task_count;
+    worker_pool->run(job);
+    return;
+  }
+#endif
+  for (size_t i = 0; i < task_count; i++) {
+    f(i);
+  }
+}
+
+size_t CryptoWorkerPool::get_worker_count() {
+#if TD_THREAD_UNSUPPORTED
+  return 0;
+#else
+  auto worker_pool = get_worker_pool();
+  return worker_pool == nullptr ? 0 : worker_pool->get_worker_count();
+#endif
+}
+
+}  // namespace mtproto
+}  // namespace td
@@ -0,0 +1,27 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2021
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+
+#include <functional>
+
+namespace td {
+namespace mtproto {
+
+// process-wide pool of threads, which decrypt large MTProto packets for all connections
+class CryptoWorkerPool {
+ public:
+  // calls f(0), ..., f(task_count - 1) in the current thread and in the worker threads
+  // returns after all the calls have finished
+  static void run(size_t task_count, const std::function<void(size_t)> &f);
+
+  static size_t get_worker_count();
+};
+
+}  // namespace mtproto
+}  // namespace td
@@ -27,6 +27,9 @@ class Transport final : public IStreamTransport {
   }
 
   Result<size_t> read_next(BufferSlice *message, uint32 *quick_ack) final TD_WARN_UNUSED_RESULT;
+  size_t get_inplace_read_size() final {
+    return 0;
+  }
   bool support_quick_ack() const final {
     return false;
   }
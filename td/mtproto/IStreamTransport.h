@@ -23,6 +23,8 @@ class IStreamTransport {
   IStreamTransport &operator=(const IStreamTransport &) = delete;
   virtual ~IStreamTransport() = default;
   virtual Result<size_t> read_next(BufferSlice *message, uint32 *quick_ack) = 0;
+  // returns size of the received part of the next packet, if it is kept as is at the end of the input buffer, or 0
+  virtual size_t get_inplace_read_size() = 0;
   virtual bool support_quick_ack() const = 0;
   virtual void write(BufferWriter &&message, bool quick_ack) = 0;
   virtual bool can_read() const = 0;
@@ -7,6 +7,7 @@
 #include "td/mtproto/RawConnection.h"
 
 #include "td/mtproto/AuthKey.h"
+#include "td/mtproto/CryptoWorkerPool.h"
 #include "td/mtproto/IStreamTransport.h"
 #include "td/mtproto/ProxySecret.h"
 #include "td/mtproto/Transport.h"
@@ -46,6 +47,10 @@ class RawConnectionDefault final : public RawConnection {
     connection_token_ = std::move(connection_token);
   }
 
+  void set_use_crypto_workers(bool use_crypto_workers) final {
+    use_crypto_workers_ = use_crypto_workers;
+  }
+
   bool can_send() const final {
     return transport_->can_write();
   }
@@ -137,6 +142,23 @@ class RawConnectionDefault final : public RawConnection {
 
   ConnectionManager::ConnectionToken connection_token_;
 
+  // AES-IGE decrypts about 1 GB/s, so decryption of a packet smaller than 64 KB takes less than 64 microseconds,
+  // which is comparable with the cost of waking up a worker thread and waiting for it to finish
+  static constexpr size_t MIN_PARALLEL_DECRYPT_SIZE = 1 << 16;
+
+  // the rest of a bigger packet is received to a separate buffer, so the packet needn't be copied to solid memory
+  static constexpr size_t MIN_RESERVED_READ_SIZE = 1 << 15;
+  bool is_read_reserved_ = false;
+
+  struct ReadPacket {
+    BufferSlice packet;
+    uint32 quick_ack = 0;
+    PacketInfo info;
+    Result<Transport::ReadResult> r_read_result;
+    bool is_decrypted = false;
+  };
+  bool use_crypto_workers_ = false;
+
   Status flush_read(const AuthKey &auth_key, Callback &callback) {
     auto r = socket_fd_.flush_read();
     if (r.is_ok()) {
@@ -145,62 +167,138 @@ class RawConnectionDefault final : public RawConnection {
       }
       callback.on_read(r.ok());
     }
-    while (transport_->can_read()) {
-      BufferSlice packet;
-      uint32 quick_ack = 0;
-      TRY_RESULT(wait_size, transport_->read_next(&packet, &quick_ack));
-      if (!is_aligned_pointer<4>(packet.as_slice().ubegin())) {
-        BufferSlice new_packet(packet.size());
-        new_packet.as_slice().copy_from(packet.as_slice());
-        packet = std::move(new_packet);
+    if (use_crypto_workers_) {
+      TRY_STATUS(read_packets_parallel(auth_key, callback));
+    } else {
+      while (transport_->can_read()) {
+        BufferSlice packet;
+        uint32 quick_ack = 0;
+        TRY_RESULT(is_ready, read_next_packet(&packet, &quick_ack));
+        if (!is_ready) {
+          break;
+        }
+
+        if (quick_ack != 0) {
+          TRY_STATUS(on_quick_ack(quick_ack, callback));
+          continue;
+        }
+
+        PacketInfo info;
+        info.version = 2;
+
+        auto r_read_result = Transport::read(packet.as_slice(), auth_key, &info);
+        TRY_STATUS(on_read_result(std::move(packet), info, std::move(r_read_result), auth_key, callback));
       }
-      LOG_CHECK(is_aligned_pointer<4>(packet.as_slice().ubegin()))
-          << packet.as_slice().ubegin() << ' ' << packet.size() << ' ' << wait_size;
-      if (wait_size != 0) {
-        constexpr size_t MAX_PACKET_SIZE = (1 << 22) + 1024;
-        if (wait_size > MAX_PACKET_SIZE) {
-          return Status::Error(PSLICE() << "Expected packet size is too big: " << wait_size);
+    }
+
+    TRY_STATUS(std::move(r));
+    return Status::OK();
+  }
+
+  // returns false if more data is needed
+  Result<bool> read_next_packet(BufferSlice *packet, uint32 *quick_ack) {
+    TRY_RESULT(wait_size, transport_->read_next(packet, quick_ack));
+    if (!is_aligned_pointer<4>(packet->as_slice().ubegin())) {
+      BufferSlice new_packet(packet->size());
+      new_packet.as_slice().copy_from(packet->as_slice());
+      *packet = std::move(new_packet);
+    }
+    LOG_CHECK(is_aligned_pointer<4>(packet->as_slice().ubegin()))
+        << packet->as_slice().ubegin() << ' ' << packet->size() << ' ' << wait_size;
+    if (wait_size != 0) {
+      constexpr size_t MAX_PACKET_SIZE = (1 << 22) + 1024;
+      if (wait_size > MAX_PACKET_SIZE) {
+        return Status::Error(PSLICE() << "Expected packet size is too big: " << wait_size);
+      }
+      if (!is_read_reserved_) {
+        auto received_size = transport_->get_inplace_read_size();
+        if (received_size != 0 && received_size < wait_size && wait_size - received_size >= MIN_RESERVED_READ_SIZE) {
+          socket_fd_.reserve_input(wait_size - received_size, received_size);
+          is_read_reserved_ = true;
         }
+      }
+      return false;
+    }
+    is_read_reserved_ = false;
+    return true;
+  }
+
+  // reads all available packets, decrypts large of them in parallel and handles them in the order of receiving
+  Status read_packets_parallel(const AuthKey &auth_key, Callback &callback) {
+    vector<ReadPacket> read_packets;
+    Status status;
+    while (transport_->can_read()) {
+      ReadPacket read_packet;
+      auto r_is_ready = read_next_packet(&read_packet.packet, &read_packet.quick_ack);
+      if (r_is_ready.is_error()) {
+        status = r_is_ready.move_as_error();
+        break;
+      }
+      if (!r_is_ready.ok()) {
         break;
       }
+      read_packet.info.version = 2;
+      read_packets.push_back(std::move(read_packet));
+    }
 
-      if (quick_ack != 0) {
-        TRY_STATUS(on_quick_ack(quick_ack, callback));
-        continue;
+    // decryption of a packet can't be split between threads and the current thread decrypts packets too,
+    // so at least 2 large packets are needed for the worker threads to save time
+    vector<ReadPacket *> large_packets;
+    for (auto &read_packet : read_packets) {
+      if (read_packet.quick_ack == 0 && read_packet.packet.size() >= MIN_PARALLEL_DECRYPT_SIZE) {
+        large_packets.push_back(&read_packet);
       }
+    }
+    if (large_packets.size() >= 2) {
+      CryptoWorkerPool::run(large_packets.size(), [&large_packets, &auth_key](size_t i) {
+        auto *read_packet = large_packets[i];
+        read_packet->r_read_result = Transport::read(read_packet->packet.as_slice(), auth_key, &read_packet->info);
+        read_packet->is_decrypted = true;
+      });
+    }
 
-      PacketInfo info;
-      info.version = 2;
+    for (auto &read_packet : read_packets) {
+      if (read_packet.quick_ack != 0) {
+        TRY_STATUS(on_quick_ack(read_packet.quick_ack, callback));
+        continue;
+      }
+      if (!read_packet.is_decrypted) {
+        read_packet.r_read_result = Transport::read(read_packet.packet.as_slice(), auth_key, &read_packet.info);
+      }
+      TRY_STATUS(on_read_result(std::move(read_packet.packet), read_packet.info,
+                                std::move(read_packet.r_read_result), auth_key, callback));
+    }
+    return status;
+  }
 
-      TRY_RESULT(read_result, Transport::read(packet.as_slice(), auth_key, &info));
-      switch (read_result.type()) {
-        case Transport::ReadResult::Quickack: {
-          TRY_STATUS(on_quick_ack(read_result.quick_ack(), callback));
-          break;
-        }
-        case Transport::ReadResult::Error: {
-          TRY_STATUS(on_read_mtproto_error(read_result.error()));
-          break;
-        }
-        case Transport::ReadResult::Packet: {
-          // If a packet was successfully decrypted, then it is ok to assume that the connection is alive
-          if (!auth_key.empty()) {
-            if (stats_callback_) {
-              stats_callback_->on_pong();
-            }
+  Status on_read_result(BufferSlice packet, const PacketInfo &info, Result<Transport::ReadResult> r_read_result,
+                        const AuthKey &auth_key, Callback &callback) {
+    TRY_RESULT(read_result, std::move(r_read_result));
+    switch (read_result.type()) {
+      case Transport::ReadResult::Quickack: {
+        TRY_STATUS(on_quick_ack(read_result.quick_ack(), callback));
+        break;
+      }
+      case Transport::ReadResult::Error: {
+        TRY_STATUS(on_read_mtproto_error(read_result.error()));
+        break;
+      }
+      case Transport::ReadResult::Packet: {
+        // If a packet was successfully decrypted, then it is ok to assume that the connection is alive
+        if (!auth_key.empty()) {
+          if (stats_callback_) {
+            stats_callback_->on_pong();
           }
-
-          TRY_STATUS(callback.on_raw_packet(info, packet.from_slice(read_result.packet())));
-          break;
         }
-        case Transport::ReadResult::Nop:
-          break;
-        default:
-          UNREACHABLE();
+
+        TRY_STATUS(callback.on_raw_packet(info, packet.from_slice(read_result.packet())));
+        break;
       }
+      case Transport::ReadResult::Nop:
+        break;
+      default:
+        UNREACHABLE();
     }
-
-    TRY_STATUS(std::move(r));
     return Status::OK();
   }
 
@@ -272,6 +370,9 @@ class RawConnectionHttp final : public RawConnection {
     connection_token_ = std::move(connection_token);
   }
 
+  void set_use_crypto_workers(bool use_crypto_workers) final {
+  }
+
   bool can_send() const final {
     return mode_ == Send;
   }
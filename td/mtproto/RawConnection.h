@@ -46,6 +46,9 @@ class RawConnection {
 
   virtual void set_connection_token(ConnectionManager::ConnectionToken connection_token) = 0;
 
+  // if enabled, large received packets are decrypted in parallel by CryptoWorkerPool
+  virtual void set_use_crypto_workers(bool use_crypto_workers) = 0;
+
   virtual bool can_send() const = 0;
   virtual TransportType get_transport_type() const = 0;
   virtual void send_crypto(const Storer &storer, int64 session_id, int64 salt, const AuthKey &auth_key,
@@ -226,6 +226,10 @@ Status SessionConnection::on_packet_container(const MsgInfo &info, Slice packet)
   return Status::OK();
 }
 
+Status SessionConnection::Callback::on_message_result_gzip(uint64 id, BufferSlice packed_data, size_t original_size) {
+  return on_message_result_ok(id, gzdecode(packed_data.as_slice()), original_size);
+}
+
 Status SessionConnection::on_packet_rpc_result(const MsgInfo &info, Slice packet) {
   TlParser parser(packet);
   uint64 req_msg_id = parser.fetch_long();
@@ -249,14 +253,14 @@ Status SessionConnection::on_packet_rpc_result(const MsgInfo &info, Slice packet
       return Status::OK();
     }
     case mtproto_api::gzip_packed::ID: {
-      mtproto_api::gzip_packed gzip(parser);
+      // yep, gzip in rpc_result
+      // parse gzip_packed manually to avoid copying of packed_data
+      auto packed_data = parser.fetch_string<Slice>();
       if (parser.get_error()) {
         return Status::Error(PSLICE() << "Failed to parse mtproto_api::gzip_packed: " << parser.get_error());
       }
-      // yep, gzip in rpc_result
-      BufferSlice object = gzdecode(gzip.packed_data_);
       // send header no more optimization
-      return callback_->on_message_result_ok(req_msg_id, std::move(object), info.size);
+      return callback_->on_message_result_gzip(req_msg_id, as_buffer_slice(packed_data), info.size);
     }
     default:
       packet.remove_prefix(sizeof(req_msg_id));
@@ -117,6 +117,8 @@ class SessionConnection final
 
     virtual void on_message_ack(uint64 id) = 0;
     virtual Status on_message_result_ok(uint64 id, BufferSlice packet, size_t original_size) = 0;
+    // the default implementation decompresses the result synchronously
+    virtual Status on_message_result_gzip(uint64 id, BufferSlice packed_data, size_t original_size);
     virtual void on_message_result_error(uint64 id, int code, string message) = 0;
     virtual void on_message_failed(uint64 id, Status status) = 0;
     virtual void on_message_info(uint64 id, int32 state, uint64 answer_id, int32 answer_size) = 0;
@@ -37,13 +37,11 @@ size_t IntermediateTransport::read_from_stream(ChainBufferReader *stream, Buffer
 
   size_t total_size = data_size + header_size;
   if (stream_size < total_size) {
-    // optimization
-    // stream->make_solid(total_size);
     return total_size;
   }
 
   stream->advance(header_size);
-  *message = stream->cut_head(data_size).move_as_buffer_slice();
+  *message = stream->cut_head(data_size).move_as_joined_buffer_slice();
   return 0;
 }
 
@@ -100,13 +98,11 @@ size_t AbridgedTransport::read_from_stream(ChainBufferReader *stream, BufferSlic
 
   size_t total_size = header_size + data_size;
   if (stream->size() < total_size) {
-    // optimization
-    // stream->make_solid(total_size);
     return total_size;
   }
 
   stream->advance(header_size);
-  *message = stream->cut_head(data_size).move_as_buffer_slice();
+  *message = stream->cut_head(data_size).move_as_joined_buffer_slice();
   return 0;
 }
 
@@ -211,6 +207,15 @@ Result<size_t> ObfuscatedTransport::read_next(BufferSlice *message, uint32 *quic
   return impl_.read_from_stream(byte_flow_sink_.get_output(), message, quick_ack);
 }
 
+size_t ObfuscatedTransport::get_inplace_read_size() {
+  if (secret_.emulate_tls()) {
+    // TLS records are unpacked to another buffer
+    return 0;
+  }
+  // AES-CTR decrypts the data in place
+  return byte_flow_sink_.get_output()->size();
+}
+
 void ObfuscatedTransport::write(BufferWriter &&message, bool quick_ack) {
   impl_.write_prepare_inplace(&message, quick_ack);
   output_state_.encrypt(message.as_slice(), message.as_slice());
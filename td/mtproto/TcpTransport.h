@@ -85,6 +85,9 @@ class OldTransport final : public IStreamTransport {
   Result<size_t> read_next(BufferSlice *message, uint32 *quick_ack) final TD_WARN_UNUSED_RESULT {
     return impl_.read_from_stream(input_, message, quick_ack);
   }
+  size_t get_inplace_read_size() final {
+    return input_->size();
+  }
   bool support_quick_ack() const final {
     return impl_.support_quick_ack();
   }
@@ -134,6 +137,8 @@ class ObfuscatedTransport final : public IStreamTransport {
 
   Result<size_t> read_next(BufferSlice *message, uint32 *quick_ack) final TD_WARN_UNUSED_RESULT;
 
+  size_t get_inplace_read_size() final;
+
   bool support_quick_ack() const final {
     return impl_.support_quick_ack();
   }
@@ -13,17 +13,19 @@
 #include "td/actor/ConcurrentScheduler.h"
 
 #include "td/utils/algorithm.h"
+#include "td/utils/bits.h"
 #include "td/utils/common.h"
 #include "td/utils/crypto.h"
 #include "td/utils/ExitGuard.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
 #include "td/utils/MpscPollableQueue.h"
-#include "td/utils/port/RwMutex.h"
 #include "td/utils/port/thread.h"
 #include "td/utils/Slice.h"
+#include "td/utils/Time.h"
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <limits>
 #include <memory>
@@ -31,6 +33,7 @@
 #include <queue>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 
 namespace td {
 
@@ -237,7 +240,7 @@ class MultiTd final : public Actor {
  public:
   explicit MultiTd(Td::Options options) : options_(std::move(options)) {
   }
-  void create(int32 td_id, unique_ptr<TdCallback> callback) {
+  void create(int32 td_id, int32 sched_id, unique_ptr<TdCallback> callback) {
     auto &td = tds_[td_id];
     CHECK(td.empty());
 
@@ -245,7 +248,7 @@ class MultiTd final : public Actor {
     auto context = std::make_shared<ActorContext>();
     auto old_context = set_context(context);
     auto old_tag = set_tag(to_string(td_id));
-    td = create_actor<Td>("Td", std::move(callback), options_);
+    td = create_actor_on_scheduler<Td>("Td", sched_id, std::move(callback), options_);
     set_context(old_context);
     set_tag(old_tag);
   }
@@ -341,14 +344,25 @@ class TdReceiver {
   }
 };
 
+static std::atomic<int32> shared_scheduler_pool_thread_count{0};
+
 class MultiImpl {
  public:
   static constexpr int32 ADDITIONAL_THREAD_COUNT = 3;
 
-  explicit MultiImpl(std::shared_ptr<NetQueryStats> net_query_stats) {
+  // if shared_thread_count is positive, then all Td instances are distributed between shared_thread_count schedulers
+  MultiImpl(std::shared_ptr<NetQueryStats> net_query_stats, int32 shared_thread_count) {
+    is_shared_ = shared_thread_count > 0;
+    auto thread_count = is_shared_ ? shared_thread_count : 1 + ADDITIONAL_THREAD_COUNT;
     concurrent_scheduler_ = std::make_shared<ConcurrentScheduler>();
-    concurrent_scheduler_->init(ADDITIONAL_THREAD_COUNT);
+    concurrent_scheduler_->init(thread_count - 1);
+    // busy time of schedulers is used to choose the least loaded scheduler for new clients
+    concurrent_scheduler_->set_collect_busy_time(is_shared_);
     concurrent_scheduler_->start();
+    if (is_shared_) {
+      scheduler_loads_.resize(thread_count);
+      last_load_update_time_ = Time::now();
+    }
 
     {
       auto guard = concurrent_scheduler_->get_main_guard();
@@ -374,8 +388,9 @@ class MultiImpl {
   }
 
   void create(int32 td_id, unique_ptr<TdCallback> callback) {
+    auto sched_id = is_shared_ ? choose_scheduler(td_id) : 0;
     auto guard = concurrent_scheduler_->get_send_guard();
-    send_closure(multi_td_, &MultiTd::create, td_id, std::move(callback));
+    send_closure(multi_td_, &MultiTd::create, td_id, sched_id, std::move(callback));
   }
 
   static bool is_valid_client_id(int32 client_id) {
@@ -389,6 +404,13 @@ class MultiImpl {
   }
 
   void close(ClientManager::ClientId client_id) {
+    if (is_shared_) {
+      std::lock_guard<std::mutex> lock(scheduler_loads_mutex_);
+      auto it = client_sched_ids_.find(client_id);
+      CHECK(it != client_sched_ids_.end());
+      scheduler_loads_[it->second].client_count--;
+      client_sched_ids_.erase(it);
+    }
     auto guard = concurrent_scheduler_->get_send_guard();
     send_closure(multi_td_, &MultiTd::close, client_id);
   }
@@ -412,7 +434,55 @@ class MultiImpl {
   thread scheduler_thread_;
   ActorOwn<MultiTd> multi_td_;
 
+  bool is_shared_ = false;
+
+  struct SchedulerLoad {
+    double busy_time = 0.0;
+    double load = 0.0;
+    int32 client_count = 0;
+  };
+  std::mutex scheduler_loads_mutex_;
+  vector<SchedulerLoad> scheduler_loads_;
+  double last_load_update_time_ = 0.0;
+  std::unordered_map<int32, int32> client_sched_ids_;
+
   static std::atomic<uint32> current_id_;
+
+  void update_scheduler_loads() {
+    static constexpr double LOAD_UPDATE_PERIOD = 1.0;
+    auto now = Time::now();
+    auto passed_time = now - last_load_update_time_;
+    if (passed_time < LOAD_UPDATE_PERIOD) {
+      return;
+    }
+    last_load_update_time_ = now;
+    for (size_t i = 0; i < scheduler_loads_.size(); i++) {
+      auto &scheduler_load = scheduler_loads_[i];
+      auto busy_time = concurrent_scheduler_->get_busy_time(static_cast<int32>(i));
+      scheduler_load.load = (busy_time - scheduler_load.busy_time) / passed_time;
+      scheduler_load.busy_time = busy_time;
+    }
+  }
+
+  int32 choose_scheduler(int32 td_id) {
+    std::lock_guard<std::mutex> lock(scheduler_loads_mutex_);
+    update_scheduler_loads();
+
+    // loads are compared with 5% precision; the number of clients is used to distribute clients between idle schedulers
+    auto get_order = [](const SchedulerLoad &scheduler_load) {
+      return std::make_pair(static_cast<int32>(scheduler_load.load * 20), scheduler_load.client_count);
+    };
+    size_t best_pos = 0;
+    for (size_t i = 1; i < scheduler_loads_.size(); i++) {
+      if (get_order(scheduler_loads_[i]) < get_order(scheduler_loads_[best_pos])) {
+        best_pos = i;
+      }
+    }
+    scheduler_loads_[best_pos].client_count++;
+    auto sched_id = static_cast<int32>(best_pos);
+    client_sched_ids_[td_id] = sched_id;
+    return sched_id;
+  }
 };
 
 std::atomic<uint32> MultiImpl::current_id_{1};
@@ -424,8 +494,13 @@ class MultiImplPool {
     if (impls_.empty()) {
       init_openssl_threads();
 
-      impls_.resize(clamp(thread::hardware_concurrency(), 8u, 20u) * 5 / 4);
-      CHECK(impls_.size() * (1 + MultiImpl::ADDITIONAL_THREAD_COUNT + 1 /* IOCP */) < 128);
+      shared_thread_count_ = shared_scheduler_pool_thread_count.load(std::memory_order_relaxed);
+      if (shared_thread_count_ > 0) {
+        impls_.resize(1);
+      } else {
+        impls_.resize(clamp(thread::hardware_concurrency(), 8u, 20u) * 5 / 4);
+        CHECK(impls_.size() * (1 + MultiImpl::ADDITIONAL_THREAD_COUNT + 1 /* IOCP */) < 128);
+      }
 
       net_query_stats_ = std::make_shared<NetQueryStats>();
     }
@@ -433,7 +508,7 @@ class MultiImplPool {
                                    [](auto &a, auto &b) { return a.lock().use_count() < b.lock().use_count(); });
     auto result = impl.lock();
     if (!result) {
-      result = std::make_shared<MultiImpl>(net_query_stats_);
+      result = std::make_shared<MultiImpl>(net_query_stats_, shared_thread_count_);
       impl = result;
     }
     return result;
@@ -461,6 +536,74 @@ class MultiImplPool {
   std::mutex mutex_;
   std::vector<std::weak_ptr<MultiImpl>> impls_;
   std::shared_ptr<NetQueryStats> net_query_stats_;
+  int32 shared_thread_count_ = 0;
+};
+
+// table of clients, which can be used from sender threads without locking
+// slots are indexed by ClientId and are never freed or reused until the table is destroyed
+class ClientTable {
+ public:
+  struct Slot {
+    // number of senders, which are using the slot, and flags
+    std::atomic<uint32> state{0};
+    MultiImpl *impl = nullptr;  // can be read only after IS_CREATED flag is seen
+  };
+
+  static constexpr uint32 IS_OWNED = 1u << 29;    // the client was created by the ClientManager
+  static constexpr uint32 IS_CREATED = 1u << 30;  // Td instance was created; impl can be used
+  static constexpr uint32 IS_CLOSED = 1u << 31;   // requests must be aborted
+  static constexpr uint32 SENDER_COUNT_MASK = IS_OWNED - 1;
+
+  ClientTable() = default;
+  ClientTable(const ClientTable &) = delete;
+  ClientTable &operator=(const ClientTable &) = delete;
+  ClientTable(ClientTable &&) = delete;
+  ClientTable &operator=(ClientTable &&) = delete;
+  ~ClientTable() {
+    for (auto &chunk : chunks_) {
+      delete[] chunk.load(std::memory_order_relaxed);
+    }
+  }
+
+  // returns nullptr if the slot doesn't exist
+  Slot *get_slot(ClientManager::ClientId client_id) const {
+    auto position = get_position(client_id);
+    auto *chunk = chunks_[position.first].load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+      return nullptr;
+    }
+    return &chunk[position.second];
+  }
+
+  // must not be called concurrently with itself
+  Slot &create_slot(ClientManager::ClientId client_id) {
+    auto position = get_position(client_id);
+    auto &chunk_ptr = chunks_[position.first];
+    auto *chunk = chunk_ptr.load(std::memory_order_relaxed);
+    if (chunk == nullptr) {
+      chunk = new Slot[get_chunk_size(position.first)];
+      chunk_ptr.store(chunk, std::memory_order_release);
+    }
+    return chunk[position.second];
+  }
+
+ private:
+  // chunk i contains (FIRST_CHUNK_SIZE << i) slots
+  static constexpr int32 FIRST_CHUNK_SIZE_LOG = 10;
+  static constexpr size_t CHUNK_COUNT = 32 - FIRST_CHUNK_SIZE_LOG;
+
+  std::array<std::atomic<Slot *>, CHUNK_COUNT> chunks_{};
+
+  static size_t get_chunk_size(size_t chunk_id) {
+    return static_cast<size_t>(1) << (FIRST_CHUNK_SIZE_LOG + chunk_id);
+  }
+
+  static std::pair<size_t, size_t> get_position(ClientManager::ClientId client_id) {
+    CHECK(client_id > 0);
+    auto index = static_cast<uint32>(client_id) - 1 + (1u << FIRST_CHUNK_SIZE_LOG);
+    auto chunk_id = static_cast<size_t>(31 - count_leading_zeroes_non_zero32(index) - FIRST_CHUNK_SIZE_LOG);
+    return {chunk_id, index - get_chunk_size(chunk_id)};
+  }
 };
 
 class ClientManager::Impl final {
@@ -468,40 +611,52 @@ class ClientManager::Impl final {
   ClientId create_client_id() {
     auto client_id = MultiImpl::create_id();
     {
-      auto lock = impls_mutex_.lock_write().move_as_ok();
+      std::lock_guard<std::mutex> lock(impls_mutex_);
       impls_[client_id];  // create empty MultiImplInfo
+      auto &slot = clients_.create_slot(client_id);
+      slot.state.fetch_or(ClientTable::IS_OWNED, std::memory_order_release);
     }
     return client_id;
   }
 
   void send(ClientId client_id, RequestId request_id, td_api::object_ptr<td_api::Function> &&request) {
-    auto lock = impls_mutex_.lock_read().move_as_ok();
     if (!MultiImpl::is_valid_client_id(client_id)) {
       receiver_.add_response(client_id, request_id,
                              td_api::make_object<td_api::error>(400, "Invalid TDLib instance specified"));
       return;
     }
 
-    auto it = impls_.find(client_id);
-    if (it != impls_.end() && it->second.impl == nullptr) {
-      lock.reset();
-
-      auto write_lock = impls_mutex_.lock_write().move_as_ok();
-      it = impls_.find(client_id);
-      if (it != impls_.end() && it->second.impl == nullptr) {
-        it->second.impl = pool_.get();
-        it->second.impl->create(client_id, receiver_.create_callback(client_id));
+    auto *slot = clients_.get_slot(client_id);
+    while (true) {
+      if (slot == nullptr) {
+        break;
+      }
+      auto state = slot->state.fetch_add(1, std::memory_order_acquire) + 1;
+      if ((state & ClientTable::IS_OWNED) == 0 || (state & ClientTable::IS_CLOSED) != 0) {
+        slot->state.fetch_sub(1, std::memory_order_release);
+        break;
+      }
+      if ((state & ClientTable::IS_CREATED) != 0) {
+        // the client can't be closed until the request is sent, because the sender count is positive
+        slot->impl->send(client_id, request_id, std::move(request));
+        slot->state.fetch_sub(1, std::memory_order_release);
+        return;
       }
-      write_lock.reset();
 
-      lock = impls_mutex_.lock_read().move_as_ok();
-      it = impls_.find(client_id);
-    }
-    if (it == impls_.end() || it->second.is_closed) {
-      receiver_.add_response(client_id, request_id, td_api::make_object<td_api::error>(500, "Request aborted"));
-      return;
+      // the first request to the client; Td instance must be created before any request is sent
+      slot->state.fetch_sub(1, std::memory_order_release);
+      {
+        std::lock_guard<std::mutex> lock(impls_mutex_);
+        auto it = impls_.find(client_id);
+        if (it != impls_.end() && it->second.impl == nullptr && !it->second.is_closed) {
+          it->second.impl = pool_.get();
+          it->second.impl->create(client_id, receiver_.create_callback(client_id));
+          slot->impl = it->second.impl.get();
+          slot->state.fetch_or(ClientTable::IS_CREATED, std::memory_order_release);
+        }
+      }
     }
-    it->second.impl->send(client_id, request_id, std::move(request));
+    receiver_.add_response(client_id, request_id, td_api::make_object<td_api::error>(500, "Request aborted"));
   }
 
   Response receive(double timeout) {
@@ -510,14 +665,13 @@ class ClientManager::Impl final {
         response.object->get_id() == td_api::updateAuthorizationState::ID &&
         static_cast<const td_api::updateAuthorizationState *>(response.object.get())->authorization_state_->get_id() ==
             td_api::authorizationStateClosed::ID) {
-      auto lock = impls_mutex_.lock_write().move_as_ok();
       close_impl(response.client_id);
 
       response.client_id = 0;
       response.object = nullptr;
     }
     if (response.object == nullptr && response.client_id != 0 && response.request_id == 0) {
-      auto lock = impls_mutex_.lock_write().move_as_ok();
+      std::lock_guard<std::mutex> lock(impls_mutex_);
       auto it = impls_.find(response.client_id);
       CHECK(it != impls_.end());
       CHECK(it->second.is_closed);
@@ -535,15 +689,33 @@ class ClientManager::Impl final {
   }
 
   void close_impl(ClientId client_id) {
-    auto it = impls_.find(client_id);
-    CHECK(it != impls_.end());
-    if (!it->second.is_closed) {
-      it->second.is_closed = true;
-      if (it->second.impl == nullptr) {
-        receiver_.add_response(client_id, 0, nullptr);
-      } else {
-        it->second.impl->close(client_id);
+    std::shared_ptr<MultiImpl> impl;
+    ClientTable::Slot *slot = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(impls_mutex_);
+      auto it = impls_.find(client_id);
+      CHECK(it != impls_.end());
+      if (it->second.is_closed) {
+        return;
       }
+      it->second.is_closed = true;
+      impl = it->second.impl;  // the table keeps owning the impl until the client is closed
+
+      slot = clients_.get_slot(client_id);
+      CHECK(slot != nullptr);
+      slot->state.fetch_or(ClientTable::IS_CLOSED, std::memory_order_acq_rel);
+    }
+
+    // wait for senders, which have already started to send a request to the client;
+    // the mutex isn't held, so requests to other clients aren't blocked meanwhile
+    while ((slot->state.load(std::memory_order_acquire) & ClientTable::SENDER_COUNT_MASK) != 0) {
+      td::this_thread::yield();
+    }
+
+    if (impl == nullptr) {
+      receiver_.add_response(client_id, 0, nullptr);
+    } else {
+      impl->close(client_id);
     }
   }
 
@@ -556,8 +728,15 @@ class ClientManager::Impl final {
     if (ExitGuard::is_exited()) {
       return;
     }
-    for (auto &it : impls_) {
-      close_impl(it.first);
+    vector<ClientId> client_ids;
+    {
+      std::lock_guard<std::mutex> lock(impls_mutex_);
+      for (auto &it : impls_) {
+        client_ids.push_back(it.first);
+      }
+    }
+    for (auto client_id : client_ids) {
+      close_impl(client_id);
     }
     while (!impls_.empty() && !ExitGuard::is_exited()) {
       receive(0.1);
@@ -566,12 +745,13 @@ class ClientManager::Impl final {
 
  private:
   MultiImplPool pool_;
-  RwMutex impls_mutex_;
+  std::mutex impls_mutex_;
   struct MultiImplInfo {
     std::shared_ptr<MultiImpl> impl;
     bool is_closed = false;
   };
   std::unordered_map<ClientId, MultiImplInfo> impls_;
+  ClientTable clients_;
   TdReceiver receiver_;
 };
 
@@ -661,6 +841,19 @@ ClientManager::Response ClientManager::receive(double timeout) {
   return impl_->receive(timeout);
 }
 
+std::vector<ClientManager::Response> ClientManager::receive_batch(std::size_t max_count, double timeout) {
+  std::vector<Response> responses;
+  while (responses.size() < max_count) {
+    // only the first response is waited for
+    auto response = impl_->receive(responses.empty() ? timeout : 0.0);
+    if (response.object == nullptr) {
+      break;
+    }
+    responses.push_back(std::move(response));
+  }
+  return responses;
+}
+
 td_api::object_ptr<td_api::Object> ClientManager::execute(td_api::object_ptr<td_api::Function> &&request) {
   return Td::static_request(std::move(request));
 }
@@ -684,6 +877,16 @@ void ClientManager::set_log_message_callback(int max_verbosity_level, LogMessage
   }
 }
 
+void ClientManager::enable_shared_scheduler_pool(int thread_count) {
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+  if (thread_count <= 0) {
+    thread_count = static_cast<int>(thread::hardware_concurrency());
+  }
+  // the total number of threads must be less than 128
+  shared_scheduler_pool_thread_count = clamp(thread_count, 1, 100);
+#endif
+}
+
 ClientManager::ClientManager(ClientManager &&other) noexcept = default;
 ClientManager &ClientManager::operator=(ClientManager &&other) noexcept = default;
 ClientManager::~ClientManager() = default;
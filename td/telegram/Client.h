@@ -11,8 +11,10 @@
 #include "td/telegram/td_api.h"
 #include "td/telegram/td_api.hpp"
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace td {
 
@@ -230,6 +232,16 @@ class ClientManager final {
    */
   Response receive(double timeout);
 
+  /**
+   * Receives up to max_count incoming updates and responses to requests from TDLib at once. May be called from any
+   * thread, but must not be called simultaneously from two different threads or simultaneously with receive.
+   * \param[in] max_count The maximum number of returned responses.
+   * \param[in] timeout The maximum number of seconds allowed for this function to wait for the first response.
+   * \return Incoming updates and responses to requests in the order they were received. The returned vector is empty
+   *         if the timeout expires. All returned responses have non-null objects.
+   */
+  std::vector<Response> receive_batch(std::size_t max_count, double timeout);
+
   /**
    * Synchronously executes a TDLib request.
    * A request can be executed synchronously, only if it is documented with "Can be called synchronously".
@@ -259,6 +271,16 @@ class ClientManager final {
    */
   static void set_log_message_callback(int max_verbosity_level, LogMessageCallbackPtr callback);
 
+  /**
+   * Makes all TDLib instances share a single pool of threads instead of using separate groups of threads.
+   * New TDLib instances are placed on the least loaded thread of the pool according to its measured load.
+   * The pool is recommended for applications running a lot of TDLib instances in the same process.
+   * Must be called before the first TDLib instance is created; has no effect if threads are unsupported.
+   *
+   * \param[in] thread_count The number of threads in the pool. Pass 0 to use the number of available CPU cores.
+   */
+  static void enable_shared_scheduler_pool(int thread_count);
+
   /**
    * Destroys the client manager and all TDLib client instances managed by it.
    */
@@ -13,7 +13,6 @@
 #include "td/utils/JsonBuilder.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/SliceBuilder.h"
-#include "td/utils/StackAllocator.h"
 #include "td/utils/StringBuilder.h"
 
 #include <utility>
@@ -54,9 +53,7 @@ static std::pair<td_api::object_ptr<td_api::Function>, string> to_request(Slice
   return std::make_pair(std::move(func), std::move(extra));
 }
 
-static string from_response(const td_api::Object &object, const string &extra, int client_id) {
-  auto buf = StackAllocator::alloc(1 << 18);
-  JsonBuilder jb(StringBuilder(buf.as_slice(), true), -1);
+static void store_response(JsonBuilder &jb, const td_api::Object &object, const string &extra, int client_id) {
   jb.enter_value() << ToJson(object);
   auto &sb = jb.string_builder();
   auto slice = sb.as_cslice();
@@ -69,15 +66,29 @@ static string from_response(const td_api::Object &object, const string &extra, i
     sb << ",\"@client_id\":" << client_id;
   }
   sb << '}';
-  return sb.as_cslice().str();
 }
 
-static TD_THREAD_LOCAL string *current_output;
+// responses are serialized directly into a per-thread buffer, which is reused by subsequent calls
+static TD_THREAD_LOCAL JsonBuilder *current_output;
 
-static const char *store_string(string str) {
-  init_thread_local<string>(current_output);
-  *current_output = std::move(str);
-  return current_output->c_str();
+// the buffer isn't kept after an unusually big response, so that a single response doesn't hold memory forever
+static constexpr size_t MAX_KEPT_OUTPUT_SIZE = 1 << 20;
+
+static JsonBuilder &get_output_builder() {
+  init_thread_local<JsonBuilder>(current_output);
+  auto &sb = current_output->string_builder();
+  if (sb.as_cslice().size() > MAX_KEPT_OUTPUT_SIZE) {
+    *current_output = JsonBuilder();
+  } else {
+    sb.clear();
+  }
+  return *current_output;
+}
+
+static const char *from_response(const td_api::Object &object, const string &extra, int client_id) {
+  auto &jb = get_output_builder();
+  store_response(jb, object, extra, client_id);
+  return jb.string_builder().as_cslice().c_str();
 }
 
 void ClientJson::send(Slice request) {
@@ -105,13 +116,13 @@ const char *ClientJson::receive(double timeout) {
       extra_.erase(it);
     }
   }
-  return store_string(from_response(*response.object, extra, 0));
+  return from_response(*response.object, extra, 0);
 }
 
 const char *ClientJson::execute(Slice request) {
   auto parsed_request = to_request(request);
-  return store_string(from_response(*Client::execute(Client::Request{0, std::move(parsed_request.first)}).object,
-                                    parsed_request.second, 0));
+  return from_response(*Client::execute(Client::Request{0, std::move(parsed_request.first)}).object,
+                       parsed_request.second, 0);
 }
 
 static ClientManager *get_manager() {
@@ -136,28 +147,54 @@ void json_send(int client_id, Slice request) {
   get_manager()->send(client_id, request_id, std::move(parsed_request.first));
 }
 
+static string get_extra(uint64 request_id) {
+  string extra_str;
+  if (request_id != 0) {
+    std::lock_guard<std::mutex> guard(extra_mutex);
+    auto it = extra.find(request_id);
+    if (it != extra.end()) {
+      extra_str = std::move(it->second);
+      extra.erase(it);
+    }
+  }
+  return extra_str;
+}
+
 const char *json_receive(double timeout) {
   auto response = get_manager()->receive(timeout);
   if (!response.object) {
     return nullptr;
   }
 
-  string extra_str;
-  if (response.request_id != 0) {
-    std::lock_guard<std::mutex> guard(extra_mutex);
-    auto it = extra.find(response.request_id);
-    if (it != extra.end()) {
-      extra_str = std::move(it->second);
-      extra.erase(it);
+  return from_response(*response.object, get_extra(response.request_id), response.client_id);
+}
+
+const char *json_receive_batch(int max_count, double timeout) {
+  if (max_count <= 0) {
+    return nullptr;
+  }
+  auto responses = get_manager()->receive_batch(static_cast<size_t>(max_count), timeout);
+  if (responses.empty()) {
+    return nullptr;
+  }
+
+  auto &jb = get_output_builder();
+  auto &sb = jb.string_builder();
+  sb << '[';
+  for (size_t i = 0; i < responses.size(); i++) {
+    if (i != 0) {
+      sb << ',';
     }
+    auto &response = responses[i];
+    store_response(jb, *response.object, get_extra(response.request_id), response.client_id);
   }
-  return store_string(from_response(*response.object, extra_str, response.client_id));
+  sb << ']';
+  return sb.as_cslice().c_str();
 }
 
 const char *json_execute(Slice request) {
   auto parsed_request = to_request(request);
-  return store_string(
-      from_response(*ClientManager::execute(std::move(parsed_request.first)), parsed_request.second, 0));
+  return from_response(*ClientManager::execute(std::move(parsed_request.first)), parsed_request.second, 0);
 }
 
 }  // namespace td
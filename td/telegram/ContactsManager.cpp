@@ -14461,6 +14461,8 @@ std::pair<int32, vector<DialogId>> ContactsManager::search_among_dialogs(const v
                                                                          const string &query, int32 limit) const {
   Hints hints;  // TODO cache Hints
 
+  vector<std::pair<int64, string>> names;
+  names.reserve(dialog_ids.size());
   for (auto dialog_id : dialog_ids) {
     int64 rating = 0;
     if (dialog_id.get_type() == DialogType::User) {
@@ -14470,9 +14472,9 @@ std::pair<int32, vector<DialogId>> ContactsManager::search_among_dialogs(const v
         continue;
       }
       if (query.empty()) {
-        hints.add(dialog_id.get(), Slice(" "));
+        names.emplace_back(dialog_id.get(), " ");
       } else {
-        hints.add(dialog_id.get(), PSLICE() << u->first_name << ' ' << u->last_name << ' ' << u->username);
+        names.emplace_back(dialog_id.get(), PSTRING() << u->first_name << ' ' << u->last_name << ' ' << u->username);
       }
       rating = -get_user_was_online(u, user_id);
     } else {
@@ -14480,13 +14482,14 @@ std::pair<int32, vector<DialogId>> ContactsManager::search_among_dialogs(const v
         continue;
       }
       if (query.empty()) {
-        hints.add(dialog_id.get(), Slice(" "));
+        names.emplace_back(dialog_id.get(), " ");
       } else {
-        hints.add(dialog_id.get(), td_->messages_manager_->get_dialog_title(dialog_id));
+        names.emplace_back(dialog_id.get(), td_->messages_manager_->get_dialog_title(dialog_id));
       }
     }
     hints.set_rating(dialog_id.get(), rating);
   }
+  hints.add_all(std::move(names));
 
   auto result = hints.search(query, limit, true);
   return {narrow_cast<int32>(result.first), transform(result.second, [](int64 key) { return DialogId(key); })};
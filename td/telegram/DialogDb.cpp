@@ -11,6 +11,7 @@
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteDb.h"
 #include "td/db/SqliteKeyValue.h"
+#include "td/db/SqliteReaderPool.h"
 #include "td/db/SqliteStatement.h"
 
 #include "td/actor/actor.h"
@@ -323,15 +324,23 @@ std::shared_ptr<DialogDbSyncSafeInterface> create_dialog_db_sync(
   class DialogDbSyncSafe final : public DialogDbSyncSafeInterface {
    public:
     explicit DialogDbSyncSafe(std::shared_ptr<SqliteConnectionSafe> sqlite_connection)
-        : lsls_db_([safe_connection = std::move(sqlite_connection)] {
+        : sqlite_connection_(sqlite_connection), lsls_db_([safe_connection = std::move(sqlite_connection)] {
           return make_unique<DialogDbImpl>(safe_connection->get().clone());
         }) {
     }
     DialogDbSyncInterface &get() final {
       return *lsls_db_.get();
     }
+    unique_ptr<DialogDbSyncInterface> create_read_only() final {
+      auto r_db = sqlite_connection_->open_read_only_connection();
+      if (r_db.is_error()) {
+        LOG(FATAL) << "Can't open database: " << r_db.error().message();
+      }
+      return make_unique<DialogDbImpl>(r_db.move_as_ok());
+    }
 
    private:
+    std::shared_ptr<SqliteConnectionSafe> sqlite_connection_;
     LazySchedulerLocalStorage<unique_ptr<DialogDbSyncInterface>> lsls_db_;
   };
   return std::make_shared<DialogDbSyncSafe>(std::move(sqlite_connection));
@@ -339,8 +348,10 @@ std::shared_ptr<DialogDbSyncSafeInterface> create_dialog_db_sync(
 
 class DialogDbAsync final : public DialogDbAsyncInterface {
  public:
-  DialogDbAsync(std::shared_ptr<DialogDbSyncSafeInterface> sync_db, int32 scheduler_id) {
-    impl_ = create_actor_on_scheduler<Impl>("DialogDbActor", scheduler_id, std::move(sync_db));
+  DialogDbAsync(std::shared_ptr<DialogDbSyncSafeInterface> sync_db, int32 scheduler_id,
+                vector<int32> reader_scheduler_ids) {
+    impl_ = create_actor_on_scheduler<Impl>("DialogDbActor", scheduler_id, std::move(sync_db),
+                                            std::move(reader_scheduler_ids));
   }
 
   void add_dialog(DialogId dialog_id, FolderId folder_id, int64 order, BufferSlice data,
@@ -379,7 +390,8 @@ class DialogDbAsync final : public DialogDbAsyncInterface {
  private:
   class Impl final : public Actor {
    public:
-    explicit Impl(std::shared_ptr<DialogDbSyncSafeInterface> sync_db_safe) : sync_db_safe_(std::move(sync_db_safe)) {
+    Impl(std::shared_ptr<DialogDbSyncSafeInterface> sync_db_safe, vector<int32> reader_scheduler_ids)
+        : sync_db_safe_(std::move(sync_db_safe)), reader_scheduler_ids_(std::move(reader_scheduler_ids)) {
     }
 
     void add_dialog(DialogId dialog_id, FolderId folder_id, int64 order, BufferSlice data,
@@ -421,6 +433,15 @@ class DialogDbAsync final : public DialogDbAsyncInterface {
     void get_dialogs(FolderId folder_id, int64 order, DialogId dialog_id, int32 limit,
                      Promise<DialogDbGetDialogsResult> promise) {
       add_read_query();
+      if (!readers_.empty()) {
+        return readers_.run(PromiseCreator::lambda([folder_id, order, dialog_id, limit, promise = std::move(promise)](
+                                                       Result<DialogDbSyncInterface *> r_db) mutable {
+          if (r_db.is_error()) {
+            return promise.set_error(r_db.move_as_error());
+          }
+          promise.set_result(r_db.ok()->get_dialogs(folder_id, order, dialog_id, limit));
+        }));
+      }
       promise.set_result(sync_db_->get_dialogs(folder_id, order, dialog_id, limit));
     }
 
@@ -428,7 +449,7 @@ class DialogDbAsync final : public DialogDbAsyncInterface {
       do_flush();
       sync_db_safe_.reset();
       sync_db_ = nullptr;
-      promise.set_value(Unit());
+      readers_.close(std::move(promise));
       stop();
     }
 
@@ -436,6 +457,9 @@ class DialogDbAsync final : public DialogDbAsyncInterface {
     std::shared_ptr<DialogDbSyncSafeInterface> sync_db_safe_;
     DialogDbSyncInterface *sync_db_ = nullptr;
 
+    vector<int32> reader_scheduler_ids_;
+    SqliteReaderPool<DialogDbSyncInterface> readers_;
+
     static constexpr size_t MAX_PENDING_QUERIES_COUNT{50};
     static constexpr double MAX_PENDING_QUERIES_DELAY{0.01};
 
@@ -485,14 +509,19 @@ class DialogDbAsync final : public DialogDbAsyncInterface {
 
     void start_up() final {
       sync_db_ = &sync_db_safe_->get();
+      if (!reader_scheduler_ids_.empty()) {
+        readers_ = SqliteReaderPool<DialogDbSyncInterface>(
+            reader_scheduler_ids_, [sync_db_safe = sync_db_safe_] { return sync_db_safe->create_read_only(); });
+      }
     }
   };
   ActorOwn<Impl> impl_;
 };
 
 std::shared_ptr<DialogDbAsyncInterface> create_dialog_db_async(std::shared_ptr<DialogDbSyncSafeInterface> sync_db,
-                                                               int32 scheduler_id) {
-  return std::make_shared<DialogDbAsync>(std::move(sync_db), scheduler_id);
+                                                               int32 scheduler_id,
+                                                               vector<int32> reader_scheduler_ids) {
+  return std::make_shared<DialogDbAsync>(std::move(sync_db), scheduler_id, std::move(reader_scheduler_ids));
 }
 
 }  // namespace td
@@ -68,6 +68,9 @@ class DialogDbSyncSafeInterface {
   virtual ~DialogDbSyncSafeInterface() = default;
 
   virtual DialogDbSyncInterface &get() = 0;
+
+  // returns a new instance with a separate read-only database connection; can be called from any thread
+  virtual unique_ptr<DialogDbSyncInterface> create_read_only() = 0;
 };
 
 class DialogDbAsyncInterface {
@@ -104,7 +107,9 @@ Status drop_dialog_db(SqliteDb &db, int version) TD_WARN_UNUSED_RESULT;
 std::shared_ptr<DialogDbSyncSafeInterface> create_dialog_db_sync(
     std::shared_ptr<SqliteConnectionSafe> sqlite_connection);
 
+// get_dialogs is run in parallel on reader_scheduler_ids
 std::shared_ptr<DialogDbAsyncInterface> create_dialog_db_async(std::shared_ptr<DialogDbSyncSafeInterface> sync_db,
-                                                               int32 scheduler_id);
+                                                               int32 scheduler_id,
+                                                               vector<int32> reader_scheduler_ids = {});
 
 }  // namespace td
@@ -88,8 +88,8 @@ struct ServerTimeDiff {
 Status Global::init(const TdParameters &parameters, ActorId<Td> td, unique_ptr<TdDb> td_db_ptr) {
   parameters_ = parameters;
 
-  gc_scheduler_id_ = min(Scheduler::instance()->sched_id() + 2, Scheduler::instance()->sched_count() - 1);
-  slow_net_scheduler_id_ = min(Scheduler::instance()->sched_id() + 3, Scheduler::instance()->sched_count() - 1);
+  gc_scheduler_id_ = get_helper_scheduler_id(2);
+  slow_net_scheduler_id_ = get_helper_scheduler_id(3);
 
   td_ = td;
   td_db_ = std::move(td_db_ptr);
@@ -222,6 +222,7 @@ bool Global::ignore_background_updates() const {
 }
 
 void Global::set_net_query_stats(std::shared_ptr<NetQueryStats> net_query_stats) {
+  net_query_stats_ = net_query_stats;
   net_query_creator_.set_create_func(
       [net_query_stats = std::move(net_query_stats)] { return td::make_unique<NetQueryCreator>(net_query_stats); });
 }
@@ -234,6 +235,17 @@ void Global::set_shared_config(unique_ptr<ConfigShared> shared_config) {
   shared_config_ = std::move(shared_config);
 }
 
+int32 Global::get_helper_scheduler_id(int32 helper_number) {
+  CHECK(helper_number > 0);
+  auto sched_id = Scheduler::instance()->sched_id();
+  auto sched_count = Scheduler::instance()->sched_count();
+  if (sched_count == 1) {
+    return sched_id;
+  }
+  // helper schedulers follow the current one, which isn't necessarily the first scheduler in a shared scheduler pool
+  return (sched_id + 1 + (helper_number - 1) % (sched_count - 1)) % sched_count;
+}
+
 int64 Global::get_location_key(double latitude, double longitude) {
   const double PI = 3.14159265358979323846;
   latitude *= PI / 180;
@@ -109,6 +109,10 @@ class Global final : public ActorContext {
 
   void set_net_query_stats(std::shared_ptr<NetQueryStats> net_query_stats);
 
+  NetQueryStats *get_net_query_stats() const {
+    return net_query_stats_.get();
+  }
+
   void set_net_query_dispatcher(unique_ptr<NetQueryDispatcher> net_query_dispatcher);
 
   NetQueryDispatcher &net_query_dispatcher() {
@@ -354,6 +358,10 @@ class Global final : public ActorContext {
     return slow_net_scheduler_id_;
   }
 
+  // returns identifier of the helper scheduler with the given positive number for the current scheduler;
+  // helper schedulers differ from the current scheduler, unless it is the only scheduler
+  static int32 get_helper_scheduler_id(int32 helper_number);
+
   DcId get_webfile_dc_id() const;
 
   std::shared_ptr<DhConfig> get_dh_config() {
@@ -474,6 +482,7 @@ class Global final : public ActorContext {
 
   ActorId<StateManager> state_manager_;
 
+  std::shared_ptr<NetQueryStats> net_query_stats_;
   LazySchedulerLocalStorage<unique_ptr<NetQueryCreator>> net_query_creator_;
   unique_ptr<NetQueryDispatcher> net_query_dispatcher_;
 
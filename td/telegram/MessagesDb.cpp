@@ -11,13 +11,17 @@
 
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteDb.h"
+#include "td/db/SqliteReaderPool.h"
 #include "td/db/SqliteStatement.h"
 
 #include "td/actor/actor.h"
+#include "td/actor/MultiPromise.h"
 #include "td/actor/PromiseFuture.h"
 #include "td/actor/SchedulerLocalStorage.h"
 
+#include "td/utils/as.h"
 #include "td/utils/format.h"
+#include "td/utils/Gzip.h"
 #include "td/utils/logging.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/Slice.h"
@@ -33,7 +37,9 @@
 #include <array>
 #include <iterator>
 #include <limits>
+#include <mutex>
 #include <tuple>
+#include <unordered_set>
 #include <utility>
 
 namespace td {
@@ -41,6 +47,72 @@ namespace td {
 static constexpr int32 MESSAGES_DB_INDEX_COUNT = 30;
 static constexpr int32 MESSAGES_DB_INDEX_COUNT_OLD = 9;
 
+// compressed message data begins with the magic and the size of uncompressed data, followed by a zlib stream
+// uncompressed message data begins with a positive version of the log event, so the formats are distinguishable
+static constexpr int32 COMPRESSED_MESSAGE_DATA_MAGIC = -0x4d445a31;
+static constexpr size_t COMPRESSED_MESSAGE_DATA_HEADER_SIZE = 8;
+static constexpr size_t MIN_COMPRESSED_MESSAGE_DATA_SIZE = 256;
+static constexpr size_t MAX_DEFLATE_COMPRESSION_RATIO = 1032;
+
+// the data is compressed only if this makes it at least 1/8 smaller
+static BufferSlice compress_message_data(BufferSlice data) {
+  auto size = data.size();
+  if (size < MIN_COMPRESSED_MESSAGE_DATA_SIZE || size > static_cast<size_t>(std::numeric_limits<int32>::max())) {
+    return data;
+  }
+
+  BufferSlice result(COMPRESSED_MESSAGE_DATA_HEADER_SIZE + size - size / 8);
+  Gzip gzip;
+  gzip.init_encode().ensure();
+  gzip.set_input(data.as_slice());
+  gzip.close_input();
+  gzip.set_output(result.as_slice().substr(COMPRESSED_MESSAGE_DATA_HEADER_SIZE));
+  auto r_state = gzip.run();
+  if (r_state.is_error() || r_state.ok() != Gzip::State::Done) {
+    return data;
+  }
+  result.truncate(COMPRESSED_MESSAGE_DATA_HEADER_SIZE + gzip.used_output());
+  as<int32>(result.as_slice().begin()) = COMPRESSED_MESSAGE_DATA_MAGIC;
+  as<int32>(result.as_slice().begin() + 4) = static_cast<int32>(size);
+  return result;
+}
+
+// returns at most max_size first bytes of the uncompressed message data
+static BufferSlice decompress_message_data(Slice data, size_t max_size = std::numeric_limits<size_t>::max()) {
+  if (data.size() < COMPRESSED_MESSAGE_DATA_HEADER_SIZE || as<int32>(data.begin()) != COMPRESSED_MESSAGE_DATA_MAGIC) {
+    return BufferSlice(data.truncate(max_size));
+  }
+
+  int32 stored_size = as<int32>(data.begin() + 4);
+  auto compressed_data = data.substr(COMPRESSED_MESSAGE_DATA_HEADER_SIZE);
+  if (stored_size < 0 || static_cast<size_t>(stored_size) > compressed_data.size() * MAX_DEFLATE_COMPRESSION_RATIO) {
+    LOG(ERROR) << "Receive wrong uncompressed size " << stored_size << " of message data of size " << data.size();
+    return BufferSlice();
+  }
+  auto full_size = static_cast<size_t>(stored_size);
+  auto size = min(full_size, max_size);
+  BufferSlice result(size);
+  Gzip gzip;
+  gzip.init_decode().ensure();
+  gzip.set_input(compressed_data);
+  gzip.close_input();
+  gzip.set_output(result.as_slice());
+  auto r_state = gzip.run();
+  // if the whole data is needed, then the zlib stream must end exactly after the stored number of bytes
+  if (r_state.is_error() || gzip.used_output() != size || (size == full_size && r_state.ok() != Gzip::State::Done)) {
+    LOG(ERROR) << "Failed to decompress message data of size " << data.size();
+    return BufferSlice();
+  }
+  return result;
+}
+
+int32 MessagesDbFtsResult::get_total_count(bool is_first_page, int32 limit) const {
+  if (!is_first_page || messages.size() >= static_cast<size_t>(limit) || max_unindexed_search_id != 0) {
+    return -1;
+  }
+  return static_cast<int32>(messages.size());
+}
+
 // NB: must happen inside a transaction
 Status init_messages_db(SqliteDb &db, int32 version) {
   LOG(INFO) << "Init message database " << tag("version", version);
@@ -63,7 +135,23 @@ Status init_messages_db(SqliteDb &db, int32 version) {
     return Status::OK();
   };
 
-  auto add_fts = [&db] {
+  // new messages are only queued for full-text indexing; they are added to messages_fts later in big batches
+  // a message must be deleted from messages_fts only if it has already been indexed, i.e. isn't in the queue;
+  // replaced messages are deleted through the same trigger, because recursive triggers are enabled in MessagesDbImpl
+  auto add_fts_queue = [&db] {
+    TRY_STATUS(db.exec("CREATE TABLE IF NOT EXISTS messages_fts_queue (search_id INTEGER PRIMARY KEY)"));
+    TRY_STATUS(db.exec(
+        "CREATE TRIGGER IF NOT EXISTS trigger_fts_queue_delete BEFORE DELETE ON messages WHEN OLD.search_id IS NOT "
+        "NULL BEGIN INSERT INTO messages_fts(messages_fts, rowid, text) SELECT \'delete\', OLD.search_id, OLD.text "
+        "WHERE NOT EXISTS (SELECT 1 FROM messages_fts_queue WHERE search_id = OLD.search_id); "
+        "DELETE FROM messages_fts_queue WHERE search_id = OLD.search_id; END"));
+    TRY_STATUS(db.exec(
+        "CREATE TRIGGER IF NOT EXISTS trigger_fts_queue_insert AFTER INSERT ON messages WHEN NEW.search_id IS NOT NULL"
+        " BEGIN INSERT OR IGNORE INTO messages_fts_queue VALUES(NEW.search_id); END"));
+    return Status::OK();
+  };
+
+  auto add_fts = [&db, &add_fts_queue] {
     TRY_STATUS(
         db.exec("CREATE INDEX IF NOT EXISTS message_by_search_id ON messages "
                 "(search_id) WHERE search_id IS NOT NULL"));
@@ -71,12 +159,7 @@ Status init_messages_db(SqliteDb &db, int32 version) {
     TRY_STATUS(
         db.exec("CREATE VIRTUAL TABLE IF NOT EXISTS messages_fts USING fts5(text, content='messages', "
                 "content_rowid='search_id', tokenize = \"unicode61 remove_diacritics 0 tokenchars '\a'\")"));
-    TRY_STATUS(db.exec(
-        "CREATE TRIGGER IF NOT EXISTS trigger_fts_delete BEFORE DELETE ON messages WHEN OLD.search_id IS NOT NULL"
-        " BEGIN INSERT INTO messages_fts(messages_fts, rowid, text) VALUES(\'delete\', OLD.search_id, OLD.text); END"));
-    TRY_STATUS(db.exec(
-        "CREATE TRIGGER IF NOT EXISTS trigger_fts_insert AFTER INSERT ON messages WHEN NEW.search_id IS NOT NULL"
-        " BEGIN INSERT INTO messages_fts(rowid, text) VALUES(NEW.search_id, NEW.text); END"));
+    TRY_STATUS(add_fts_queue());
     //TRY_STATUS(db.exec(
     //"CREATE TRIGGER IF NOT EXISTS trigger_fts_update AFTER UPDATE ON messages WHEN NEW.search_id IS NOT NULL OR "
     //"OLD.search_id IS NOT NULL"
@@ -167,6 +250,12 @@ Status init_messages_db(SqliteDb &db, int32 version) {
   if (version < static_cast<int32>(DbVersion::AddMessageThreadSupport)) {
     TRY_STATUS(db.exec("ALTER TABLE messages ADD COLUMN top_thread_message_id INT8"));
   }
+  if (version < static_cast<int32>(DbVersion::DeferMessagesFtsIndexing)) {
+    // all existing messages are already indexed
+    TRY_STATUS(db.exec("DROP TRIGGER IF EXISTS trigger_fts_delete"));
+    TRY_STATUS(db.exec("DROP TRIGGER IF EXISTS trigger_fts_insert"));
+    TRY_STATUS(add_fts_queue());
+  }
   return Status::OK();
 }
 
@@ -179,11 +268,15 @@ Status drop_messages_db(SqliteDb &db, int32 version) {
 
 class MessagesDbImpl final : public MessagesDbSyncInterface {
  public:
-  explicit MessagesDbImpl(SqliteDb db) : db_(std::move(db)) {
+  MessagesDbImpl(SqliteDb db, bool use_data_compression)
+      : db_(std::move(db)), use_data_compression_(use_data_compression) {
     init().ensure();
   }
 
   Status init() {
+    // INSERT OR REPLACE must fire trigger_fts_queue_delete for the replaced message,
+    // otherwise its already indexed text would never be deleted from messages_fts
+    TRY_STATUS(db_.exec("PRAGMA recursive_triggers = 1"));
     TRY_RESULT_ASSIGN(
         add_message_stmt_,
         db_.get_statement("INSERT OR REPLACE INTO messages VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12)"));
@@ -228,6 +321,21 @@ class MessagesDbImpl final : public MessagesDbSyncInterface {
                       db_.get_statement("SELECT dialog_id, message_id, data, search_id FROM messages WHERE search_id "
                                         "IN (SELECT rowid FROM messages_fts WHERE messages_fts MATCH ?1 AND rowid < ?2 "
                                         "ORDER BY rowid DESC LIMIT ?3) ORDER BY search_id DESC"));
+    TRY_RESULT_ASSIGN(get_max_unindexed_search_id_stmt_,
+                      db_.get_statement("SELECT search_id FROM messages_fts_queue WHERE search_id < ?1 ORDER BY "
+                                        "search_id DESC LIMIT 1"));
+    TRY_RESULT_ASSIGN(
+        get_unindexed_search_ids_stmt_,
+        db_.get_statement("SELECT search_id FROM messages_fts_queue ORDER BY search_id DESC LIMIT ?1"));
+    TRY_RESULT_ASSIGN(index_fts_message_stmt_,
+                      db_.get_statement("INSERT INTO messages_fts(rowid, text) SELECT search_id, text FROM messages "
+                                        "WHERE search_id = ?1"));
+    TRY_RESULT_ASSIGN(delete_unindexed_search_id_stmt_,
+                      db_.get_statement("DELETE FROM messages_fts_queue WHERE search_id = ?1"));
+    TRY_RESULT_ASSIGN(merge_fts_index_stmt_,
+                      db_.get_statement("INSERT INTO messages_fts(messages_fts, rank) VALUES('merge', ?1)"));
+    TRY_RESULT_ASSIGN(get_unindexed_fts_message_count_stmt_,
+                      db_.get_statement("SELECT COUNT(*) FROM messages_fts_queue"));
 
     for (int32 i = 0; i < MESSAGES_DB_INDEX_COUNT; i++) {
       TRY_RESULT_ASSIGN(
@@ -324,6 +432,9 @@ class MessagesDbImpl final : public MessagesDbSyncInterface {
       add_message_stmt_.bind_null(5).ensure();
     }
 
+    if (use_data_compression_) {
+      data = compress_message_data(std::move(data));
+    }
     add_message_stmt_.bind_blob(6, data.as_slice()).ensure();
 
     if (ttl_expires_at != 0) {
@@ -391,6 +502,9 @@ class MessagesDbImpl final : public MessagesDbSyncInterface {
       add_scheduled_message_stmt_.bind_null(3).ensure();
     }
 
+    if (use_data_compression_) {
+      data = compress_message_data(std::move(data));
+    }
     add_scheduled_message_stmt_.bind_blob(4, data.as_slice()).ensure();
 
     add_scheduled_message_stmt_.step().ensure();
@@ -475,16 +589,17 @@ class MessagesDbImpl final : public MessagesDbSyncInterface {
       return Status::Error("Not found");
     }
     MessageId received_message_id(stmt.view_int64(0));
-    Slice data = stmt.view_blob(1);
+    auto data = decompress_message_data(stmt.view_blob(1));
     if (is_scheduled_server) {
       CHECK(received_message_id.is_scheduled());
       CHECK(received_message_id.is_scheduled_server());
       CHECK(received_message_id.get_scheduled_server_message_id() == message_id.get_scheduled_server_message_id());
     } else {
       LOG_CHECK(received_message_id == message_id)
-          << received_message_id << ' ' << message_id << ' ' << get_message_info(received_message_id, data, true).first;
+          << received_message_id << ' ' << message_id << ' '
+          << get_message_info(received_message_id, data.as_slice(), true).first;
     }
-    return MessagesDbDialogMessage{received_message_id, BufferSlice(data)};
+    return MessagesDbDialogMessage{received_message_id, std::move(data)};
   }
 
   Result<MessagesDbMessage> get_message_by_unique_message_id(ServerMessageId unique_message_id) final {
@@ -501,7 +616,8 @@ class MessagesDbImpl final : public MessagesDbSyncInterface {
     }
     DialogId dialog_id(get_message_by_unique_message_id_stmt_.view_int64(0));
     MessageId message_id(get_message_by_unique_message_id_stmt_.view_int64(1));
-    return MessagesDbMessage{dialog_id, message_id, BufferSlice(get_message_by_unique_message_id_stmt_.view_blob(2))};
+    auto data = decompress_message_data(get_message_by_unique_message_id_stmt_.view_blob(2));
+    return MessagesDbMessage{dialog_id, message_id, std::move(data)};
   }
 
   Result<MessagesDbDialogMessage> get_message_by_random_id(DialogId dialog_id, int64 random_id) final {
@@ -515,7 +631,7 @@ class MessagesDbImpl final : public MessagesDbSyncInterface {
       return Status::Error("Not found");
     }
     MessageId message_id(get_message_by_random_id_stmt_.view_int64(0));
-    return MessagesDbDialogMessage{message_id, BufferSlice(get_message_by_random_id_stmt_.view_blob(1))};
+    return MessagesDbDialogMessage{message_id, decompress_message_data(get_message_by_random_id_stmt_.view_blob(1))};
   }
 
   Result<MessagesDbDialogMessage> get_dialog_message_by_date(DialogId dialog_id, MessageId first_message_id,
@@ -598,7 +714,7 @@ class MessagesDbImpl final : public MessagesDbSyncInterface {
       while (get_expiring_messages_stmt_.has_row()) {
         DialogId dialog_id(get_expiring_messages_stmt_.view_int64(0));
         MessageId message_id(get_expiring_messages_stmt_.view_int64(1));
-        BufferSlice data(get_expiring_messages_stmt_.view_blob(2));
+        auto data = decompress_message_data(get_expiring_messages_stmt_.view_blob(2));
         messages.push_back(MessagesDbMessage{dialog_id, message_id, std::move(data)});
         get_expiring_messages_stmt_.step().ensure();
       }
@@ -634,14 +750,16 @@ class MessagesDbImpl final : public MessagesDbSyncInterface {
     while (stmt.has_row()) {
       auto data_slice = stmt.view_blob(0);
       MessageId message_id(stmt.view_int64(1));
-      auto info = get_message_info(message_id, data_slice, false);
+      // only the beginning of the message data is needed to find out the date
+      auto info = get_message_info(message_id, decompress_message_data(data_slice, MESSAGE_INFO_MAX_SIZE).as_slice(),
+                                   false);
       auto day = (query.tz_offset + info.second) / 86400;
       if (day >= current_day) {
         CHECK(!total_counts.empty());
         total_counts.back()++;
       } else {
         current_day = day;
-        messages.push_back(MessagesDbDialogMessage{message_id, BufferSlice(data_slice)});
+        messages.push_back(MessagesDbDialogMessage{message_id, decompress_message_data(data_slice)});
         total_counts.push_back(1);
       }
       stmt.step().ensure();
@@ -707,7 +825,7 @@ class MessagesDbImpl final : public MessagesDbSyncInterface {
     while (stmt.has_row()) {
       auto data_slice = stmt.view_blob(0);
       MessageId message_id(stmt.view_int64(1));
-      result.push_back(MessagesDbDialogMessage{message_id, BufferSlice(data_slice)});
+      result.push_back(MessagesDbDialogMessage{message_id, decompress_message_data(data_slice)});
       LOG(INFO) << "Load " << message_id << " in " << dialog_id << " from database";
       stmt.step().ensure();
     }
@@ -800,12 +918,72 @@ class MessagesDbImpl final : public MessagesDbSyncInterface {
       auto data_slice = stmt.view_blob(2);
       auto search_id = stmt.view_int64(3);
       result.next_search_id = search_id;
-      result.messages.push_back(MessagesDbMessage{dialog_id, message_id, BufferSlice(data_slice)});
+      result.messages.push_back(MessagesDbMessage{dialog_id, message_id, decompress_message_data(data_slice)});
       stmt.step().ensure();
     }
+    stmt.reset();
+
+    // the messages may be not yet indexed, so the result is complete only for bigger search_id
+    auto &unindexed_stmt = get_max_unindexed_search_id_stmt_;
+    SCOPE_EXIT {
+      unindexed_stmt.reset();
+    };
+    unindexed_stmt.bind_int64(1, query.from_search_id).ensure();
+    unindexed_stmt.step().ensure();
+    if (unindexed_stmt.has_row()) {
+      result.max_unindexed_search_id = unindexed_stmt.view_int64(0);
+    }
     return std::move(result);
   }
 
+  Result<int32> index_fts_messages(int32 limit) final {
+    vector<int64> search_ids;
+    {
+      auto &stmt = get_unindexed_search_ids_stmt_;
+      SCOPE_EXIT {
+        stmt.reset();
+      };
+      stmt.bind_int32(1, limit).ensure();
+      TRY_STATUS(stmt.step());
+      while (stmt.has_row()) {
+        search_ids.push_back(stmt.view_int64(0));
+        TRY_STATUS(stmt.step());
+      }
+    }
+
+    for (auto search_id : search_ids) {
+      // the message could have been replaced by a message with a different search_id, then there is nothing to index
+      index_fts_message_stmt_.bind_int64(1, search_id).ensure();
+      auto status = index_fts_message_stmt_.step();
+      index_fts_message_stmt_.reset();
+      TRY_STATUS(std::move(status));
+
+      delete_unindexed_search_id_stmt_.bind_int64(1, search_id).ensure();
+      status = delete_unindexed_search_id_stmt_.step();
+      delete_unindexed_search_id_stmt_.reset();
+      TRY_STATUS(std::move(status));
+    }
+    return static_cast<int32>(search_ids.size());
+  }
+
+  Status merge_fts_index(int32 page_count) final {
+    SCOPE_EXIT {
+      merge_fts_index_stmt_.reset();
+    };
+    merge_fts_index_stmt_.bind_int32(1, page_count).ensure();
+    return merge_fts_index_stmt_.step();
+  }
+
+  Result<int32> get_unindexed_fts_message_count() final {
+    auto &stmt = get_unindexed_fts_message_count_stmt_;
+    SCOPE_EXIT {
+      stmt.reset();
+    };
+    TRY_STATUS(stmt.step());
+    CHECK(stmt.has_row());
+    return stmt.view_int32(0);
+  }
+
   Result<vector<MessagesDbDialogMessage>> get_messages_from_index(DialogId dialog_id, MessageId from_message_id,
                                                                   MessageSearchFilter filter, int32 offset,
                                                                   int32 limit) {
@@ -837,7 +1015,7 @@ class MessagesDbImpl final : public MessagesDbSyncInterface {
       DialogId dialog_id(stmt.view_int64(0));
       MessageId message_id(stmt.view_int64(1));
       auto data_slice = stmt.view_blob(2);
-      result.messages.push_back(MessagesDbMessage{dialog_id, message_id, BufferSlice(data_slice)});
+      result.messages.push_back(MessagesDbMessage{dialog_id, message_id, decompress_message_data(data_slice)});
       stmt.step().ensure();
     }
     return std::move(result);
@@ -852,6 +1030,7 @@ class MessagesDbImpl final : public MessagesDbSyncInterface {
 
  private:
   SqliteDb db_;
+  bool use_data_compression_;
 
   SqliteStatement add_message_stmt_;
 
@@ -878,6 +1057,13 @@ class MessagesDbImpl final : public MessagesDbSyncInterface {
   std::array<SqliteStatement, 2> get_calls_stmts_;
 
   SqliteStatement get_messages_fts_stmt_;
+  SqliteStatement get_max_unindexed_search_id_stmt_;
+
+  SqliteStatement get_unindexed_search_ids_stmt_;
+  SqliteStatement index_fts_message_stmt_;
+  SqliteStatement delete_unindexed_search_id_stmt_;
+  SqliteStatement merge_fts_index_stmt_;
+  SqliteStatement get_unindexed_fts_message_count_stmt_;
 
   SqliteStatement add_scheduled_message_stmt_;
   SqliteStatement get_scheduled_message_stmt_;
@@ -954,13 +1140,16 @@ class MessagesDbImpl final : public MessagesDbSyncInterface {
     while (stmt.has_row()) {
       auto data_slice = stmt.view_blob(0);
       MessageId message_id(stmt.view_int64(1));
-      result.push_back(MessagesDbDialogMessage{message_id, BufferSlice(data_slice)});
+      result.push_back(MessagesDbDialogMessage{message_id, decompress_message_data(data_slice)});
       LOG(INFO) << "Loaded " << message_id << " in " << dialog_id << " from database";
       stmt.step().ensure();
     }
     return std::move(result);
   }
 
+  // get_message_info needs at most this number of first bytes of the message data
+  static constexpr size_t MESSAGE_INFO_MAX_SIZE = 64;
+
   static std::pair<MessageId, int32> get_message_info(const MessagesDbDialogMessage &message, bool from_data = false) {
     return get_message_info(message.message_id, message.data.as_slice(), from_data);
   }
@@ -993,28 +1182,42 @@ class MessagesDbImpl final : public MessagesDbSyncInterface {
 };
 
 std::shared_ptr<MessagesDbSyncSafeInterface> create_messages_db_sync(
-    std::shared_ptr<SqliteConnectionSafe> sqlite_connection) {
+    std::shared_ptr<SqliteConnectionSafe> sqlite_connection, bool use_data_compression) {
   class MessagesDbSyncSafe final : public MessagesDbSyncSafeInterface {
    public:
-    explicit MessagesDbSyncSafe(std::shared_ptr<SqliteConnectionSafe> sqlite_connection)
-        : lsls_db_([safe_connection = std::move(sqlite_connection)] {
-          return make_unique<MessagesDbImpl>(safe_connection->get().clone());
+    MessagesDbSyncSafe(std::shared_ptr<SqliteConnectionSafe> sqlite_connection, bool use_data_compression)
+        : sqlite_connection_(sqlite_connection)
+        , use_data_compression_(use_data_compression)
+        , lsls_db_([safe_connection = std::move(sqlite_connection), use_data_compression] {
+          return make_unique<MessagesDbImpl>(safe_connection->get().clone(), use_data_compression);
         }) {
     }
     MessagesDbSyncInterface &get() final {
       return *lsls_db_.get();
     }
+    unique_ptr<MessagesDbSyncInterface> create_read_only() final {
+      auto r_db = sqlite_connection_->open_read_only_connection();
+      if (r_db.is_error()) {
+        LOG(FATAL) << "Can't open database: " << r_db.error().message();
+      }
+      return make_unique<MessagesDbImpl>(r_db.move_as_ok(), use_data_compression_);
+    }
 
    private:
+    std::shared_ptr<SqliteConnectionSafe> sqlite_connection_;
+    bool use_data_compression_;
     LazySchedulerLocalStorage<unique_ptr<MessagesDbSyncInterface>> lsls_db_;
   };
-  return std::make_shared<MessagesDbSyncSafe>(std::move(sqlite_connection));
+  return std::make_shared<MessagesDbSyncSafe>(std::move(sqlite_connection), use_data_compression);
 }
 
 class MessagesDbAsync final : public MessagesDbAsyncInterface {
  public:
-  MessagesDbAsync(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db, int32 scheduler_id) {
-    impl_ = create_actor_on_scheduler<Impl>("MessagesDbActor", scheduler_id, std::move(sync_db));
+  MessagesDbAsync(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db, int32 scheduler_id,
+                  vector<int32> reader_scheduler_ids)
+      : statistics_(std::make_shared<StatisticsData>()) {
+    impl_ = create_actor_on_scheduler<Impl>("MessagesDbActor", scheduler_id, std::move(sync_db), statistics_,
+                                            std::move(reader_scheduler_ids));
   }
 
   void add_message(FullMessageId full_message_id, ServerMessageId unique_message_id, UserId sender_user_id,
@@ -1093,34 +1296,164 @@ class MessagesDbAsync final : public MessagesDbAsyncInterface {
     send_closure_later(impl_, &Impl::force_flush);
   }
 
+  MessagesDbAsyncStatistics get_statistics() const final {
+    std::lock_guard<std::mutex> lock(statistics_->mutex);
+    auto result = statistics_->statistics;
+    result.fts_index = statistics_->fts_index_statistics;
+    return result;
+  }
+
  private:
+  struct StatisticsData {
+    std::mutex mutex;
+    MessagesDbAsyncStatistics statistics;
+    MessagesDbFtsIndexStatistics fts_index_statistics;
+  };
+
+  // Adds committed messages to the full-text index in big batches, so that message tokenization
+  // doesn't slow down transactions with new messages
+  // Shares the database connection with Impl, therefore must be run on the same scheduler
+  class FtsIndexer final : public Actor {
+   public:
+    FtsIndexer(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db_safe,
+               std::shared_ptr<StatisticsData> statistics_data)
+        : sync_db_safe_(std::move(sync_db_safe)), statistics_data_(std::move(statistics_data)) {
+    }
+
+    void on_messages_added(int32 message_count) {
+      unindexed_message_count_ += message_count;
+      if (is_indexing_) {
+        return;
+      }
+      if (unindexed_message_count_ >= BATCH_SIZE) {
+        is_indexing_ = true;
+        cancel_timeout();
+        yield();
+      } else if (!has_timeout()) {
+        set_timeout_in(INDEX_DELAY);
+      }
+    }
+
+    void close(Promise<> promise) {
+      sync_db_safe_.reset();
+      sync_db_ = nullptr;
+      stop();
+      promise.set_value(Unit());
+    }
+
+   private:
+    // the bigger the batches are, the fewer small segments need to be merged later
+    static constexpr int32 BATCH_SIZE = 1000;
+    static constexpr double INDEX_DELAY = 1.0;
+    static constexpr int32 MERGE_PAGE_COUNT = 500;
+    static constexpr uint64 MERGE_BATCH_PERIOD = 16;
+
+    std::shared_ptr<MessagesDbSyncSafeInterface> sync_db_safe_;
+    MessagesDbSyncInterface *sync_db_ = nullptr;
+
+    std::shared_ptr<StatisticsData> statistics_data_;
+    MessagesDbFtsIndexStatistics statistics_;
+
+    int32 unindexed_message_count_ = 0;
+    bool is_indexing_ = false;
+
+    void start_up() final {
+      sync_db_ = &sync_db_safe_->get();
+      unindexed_message_count_ = sync_db_->get_unindexed_fts_message_count().move_as_ok();
+      if (unindexed_message_count_ > 0) {
+        LOG(INFO) << "Have " << unindexed_message_count_ << " messages waiting for full-text indexing";
+        is_indexing_ = true;
+        yield();
+      }
+      publish_statistics();
+    }
+
+    void timeout_expired() final {
+      is_indexing_ = true;
+      loop();
+    }
+
+    // indexes one batch per event to not block message database queries for a long time
+    void loop() final {
+      if (sync_db_ == nullptr || !is_indexing_) {
+        return;
+      }
+      auto start_time = Time::now();
+      sync_db_->begin_write_transaction().ensure();
+      auto indexed_message_count = sync_db_->index_fts_messages(BATCH_SIZE).move_as_ok();
+      bool is_finished = indexed_message_count < BATCH_SIZE;
+      statistics_.batch_count++;
+      if (is_finished || statistics_.batch_count % MERGE_BATCH_PERIOD == 0) {
+        // merge the segments created by the last batches while they are still hot in the page cache
+        sync_db_->merge_fts_index(MERGE_PAGE_COUNT).ensure();
+        statistics_.merge_count++;
+      }
+      unindexed_message_count_ = sync_db_->get_unindexed_fts_message_count().move_as_ok();
+      sync_db_->commit_transaction().ensure();
+
+      auto batch_time = Time::now() - start_time;
+      LOG(DEBUG) << "Indexed " << indexed_message_count << " messages in " << format::as_time(batch_time) << ", "
+                 << unindexed_message_count_ << " messages are left";
+      statistics_.indexed_message_count += indexed_message_count;
+      statistics_.total_batch_time += batch_time;
+      statistics_.max_batch_time = max(statistics_.max_batch_time, batch_time);
+      publish_statistics();
+
+      if (is_finished) {
+        is_indexing_ = false;
+      } else {
+        yield();
+      }
+    }
+
+    void publish_statistics() {
+      statistics_.unindexed_message_count = unindexed_message_count_;
+      std::lock_guard<std::mutex> lock(statistics_data_->mutex);
+      statistics_data_->fts_index_statistics = statistics_;
+    }
+  };
+
   class Impl final : public Actor {
    public:
-    explicit Impl(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db_safe) : sync_db_safe_(std::move(sync_db_safe)) {
+    Impl(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db_safe, std::shared_ptr<StatisticsData> statistics_data,
+         vector<int32> reader_scheduler_ids)
+        : sync_db_safe_(std::move(sync_db_safe))
+        , statistics_data_(std::move(statistics_data))
+        , reader_scheduler_ids_(std::move(reader_scheduler_ids)) {
+      statistics_.max_pending_write_count = max_pending_write_count_;
+      statistics_.max_pending_write_delay = max_pending_write_delay_;
+      publish_statistics();
     }
     void add_message(FullMessageId full_message_id, ServerMessageId unique_message_id, UserId sender_user_id,
                      int64 random_id, int32 ttl_expires_at, int32 index_mask, int64 search_id, string text,
                      NotificationId notification_id, MessageId top_thread_message_id, BufferSlice data,
                      Promise<> promise) {
-      add_write_query([this, full_message_id, unique_message_id, sender_user_id, random_id, ttl_expires_at, index_mask,
+      if (search_id != 0) {
+        pending_fts_message_count_++;
+      }
+      add_write_query(full_message_id.get_dialog_id(),
+                      [this, full_message_id, unique_message_id, sender_user_id, random_id, ttl_expires_at, index_mask,
                        search_id, text = std::move(text), notification_id, top_thread_message_id,
                        data = std::move(data), promise = std::move(promise)](Unit) mutable {
-        on_write_result(std::move(promise),
-                        sync_db_->add_message(full_message_id, unique_message_id, sender_user_id, random_id,
-                                              ttl_expires_at, index_mask, search_id, std::move(text), notification_id,
-                                              top_thread_message_id, std::move(data)));
-      });
+                        on_write_result(std::move(promise),
+                                        sync_db_->add_message(full_message_id, unique_message_id, sender_user_id,
+                                                              random_id, ttl_expires_at, index_mask, search_id,
+                                                              std::move(text), notification_id, top_thread_message_id,
+                                                              std::move(data)));
+                      });
     }
     void add_scheduled_message(FullMessageId full_message_id, BufferSlice data, Promise<> promise) {
-      add_write_query([this, full_message_id, promise = std::move(promise), data = std::move(data)](Unit) mutable {
+      add_write_query(full_message_id.get_dialog_id(), [this, full_message_id, promise = std::move(promise),
+                                                        data = std::move(data)](Unit) mutable {
         on_write_result(std::move(promise), sync_db_->add_scheduled_message(full_message_id, std::move(data)));
       });
     }
 
     void delete_message(FullMessageId full_message_id, Promise<> promise) {
-      add_write_query([this, full_message_id, promise = std::move(promise)](Unit) mutable {
-        on_write_result(std::move(promise), sync_db_->delete_message(full_message_id));
-      });
+      add_write_query(full_message_id.get_dialog_id(),
+                      [this, full_message_id, promise = std::move(promise)](Unit) mutable {
+                        on_write_result(std::move(promise), sync_db_->delete_message(full_message_id));
+                      });
     }
     void on_write_result(Promise<> promise, Status status) {
       // We are inside a transaction and don't know how to handle the error
@@ -1128,140 +1461,284 @@ class MessagesDbAsync final : public MessagesDbAsyncInterface {
       pending_write_results_.emplace_back(std::move(promise), std::move(status));
     }
     void delete_all_dialog_messages(DialogId dialog_id, MessageId from_message_id, Promise<> promise) {
-      add_read_query();
+      add_read_query(dialog_id);
       promise.set_result(sync_db_->delete_all_dialog_messages(dialog_id, from_message_id));
     }
     void delete_dialog_messages_from_user(DialogId dialog_id, UserId sender_user_id, Promise<> promise) {
-      add_read_query();
+      add_read_query(dialog_id);
       promise.set_result(sync_db_->delete_dialog_messages_from_user(dialog_id, sender_user_id));
     }
 
     void get_message(FullMessageId full_message_id, Promise<MessagesDbDialogMessage> promise) {
-      add_read_query();
+      add_read_query(full_message_id.get_dialog_id());
       promise.set_result(sync_db_->get_message(full_message_id));
     }
     void get_message_by_unique_message_id(ServerMessageId unique_message_id, Promise<MessagesDbMessage> promise) {
-      add_read_query();
+      add_read_query(DialogId());
       promise.set_result(sync_db_->get_message_by_unique_message_id(unique_message_id));
     }
     void get_message_by_random_id(DialogId dialog_id, int64 random_id, Promise<MessagesDbDialogMessage> promise) {
-      add_read_query();
+      add_read_query(dialog_id);
       promise.set_result(sync_db_->get_message_by_random_id(dialog_id, random_id));
     }
     void get_dialog_message_by_date(DialogId dialog_id, MessageId first_message_id, MessageId last_message_id,
                                     int32 date, Promise<MessagesDbDialogMessage> promise) {
-      add_read_query();
+      add_read_query(dialog_id);
       promise.set_result(sync_db_->get_dialog_message_by_date(dialog_id, first_message_id, last_message_id, date));
     }
 
     void get_dialog_message_calendar(MessagesDbDialogCalendarQuery query, Promise<MessagesDbCalendar> promise) {
-      add_read_query();
+      add_read_query(query.dialog_id);
+      if (!readers_.empty()) {
+        return readers_.run(PromiseCreator::lambda([query = std::move(query), promise = std::move(promise)](
+                                                       Result<MessagesDbSyncInterface *> r_db) mutable {
+          if (r_db.is_error()) {
+            return promise.set_error(r_db.move_as_error());
+          }
+          promise.set_result(r_db.ok()->get_dialog_message_calendar(std::move(query)));
+        }));
+      }
       promise.set_result(sync_db_->get_dialog_message_calendar(std::move(query)));
     }
 
     void get_dialog_sparse_message_positions(MessagesDbGetDialogSparseMessagePositionsQuery query,
                                              Promise<MessagesDbMessagePositions> promise) {
-      add_read_query();
+      add_read_query(query.dialog_id);
       promise.set_result(sync_db_->get_dialog_sparse_message_positions(std::move(query)));
     }
 
     void get_messages(MessagesDbMessagesQuery query, Promise<vector<MessagesDbDialogMessage>> promise) {
-      add_read_query();
+      add_read_query(query.dialog_id);
+      if (!readers_.empty()) {
+        return readers_.run(PromiseCreator::lambda([query = std::move(query), promise = std::move(promise)](
+                                                       Result<MessagesDbSyncInterface *> r_db) mutable {
+          if (r_db.is_error()) {
+            return promise.set_error(r_db.move_as_error());
+          }
+          promise.set_result(r_db.ok()->get_messages(std::move(query)));
+        }));
+      }
       promise.set_result(sync_db_->get_messages(std::move(query)));
     }
     void get_scheduled_messages(DialogId dialog_id, int32 limit, Promise<vector<MessagesDbDialogMessage>> promise) {
-      add_read_query();
+      add_read_query(dialog_id);
       promise.set_result(sync_db_->get_scheduled_messages(dialog_id, limit));
     }
     void get_messages_from_notification_id(DialogId dialog_id, NotificationId from_notification_id, int32 limit,
                                            Promise<vector<MessagesDbDialogMessage>> promise) {
-      add_read_query();
+      add_read_query(dialog_id);
       promise.set_result(sync_db_->get_messages_from_notification_id(dialog_id, from_notification_id, limit));
     }
     void get_calls(MessagesDbCallsQuery query, Promise<MessagesDbCallsResult> promise) {
-      add_read_query();
+      add_read_query(DialogId());
       promise.set_result(sync_db_->get_calls(std::move(query)));
     }
     void get_messages_fts(MessagesDbFtsQuery query, Promise<MessagesDbFtsResult> promise) {
-      add_read_query();
+      add_read_query(query.dialog_id);
+      if (!readers_.empty()) {
+        return readers_.run(PromiseCreator::lambda([query = std::move(query), promise = std::move(promise)](
+                                                       Result<MessagesDbSyncInterface *> r_db) mutable {
+          if (r_db.is_error()) {
+            return promise.set_error(r_db.move_as_error());
+          }
+          promise.set_result(r_db.ok()->get_messages_fts(std::move(query)));
+        }));
+      }
       promise.set_result(sync_db_->get_messages_fts(std::move(query)));
     }
     void get_expiring_messages(int32 expires_from, int32 expires_till, int32 limit,
                                Promise<std::pair<vector<MessagesDbMessage>, int32>> promise) {
-      add_read_query();
+      add_read_query(DialogId());
       promise.set_result(sync_db_->get_expiring_messages(expires_from, expires_till, limit));
     }
 
     void close(Promise<> promise) {
-      do_flush();
+      do_flush(FlushReason::Force);
+
+      MultiPromiseActorSafe mpas{"MessagesDbCloseMultiPromiseActor"};
+      mpas.add_promise(std::move(promise));
+      auto lock = mpas.get_promise();
+      if (!fts_indexer_.empty()) {
+        send_closure(std::move(fts_indexer_), &FtsIndexer::close, mpas.get_promise());
+      }
       sync_db_safe_.reset();
       sync_db_ = nullptr;
-      promise.set_value(Unit());
+      readers_.close(mpas.get_promise());
+      lock.set_value(Unit());
       stop();
     }
 
     void force_flush() {
       LOG(INFO) << "MessagesDb flushed";
-      do_flush();
+      do_flush(FlushReason::Force);
     }
 
    private:
     std::shared_ptr<MessagesDbSyncSafeInterface> sync_db_safe_;
     MessagesDbSyncInterface *sync_db_ = nullptr;
 
-    static constexpr size_t MAX_PENDING_QUERIES_COUNT{50};
-    static constexpr double MAX_PENDING_QUERIES_DELAY{0.01};
+    std::shared_ptr<StatisticsData> statistics_data_;
+    MessagesDbAsyncStatistics statistics_;
+
+    vector<int32> reader_scheduler_ids_;
+    SqliteReaderPool<MessagesDbSyncInterface> readers_;
+
+    ActorOwn<FtsIndexer> fts_indexer_;
+    int32 pending_fts_message_count_ = 0;
+
+    // the limits grow under sustained write load to commit fewer bigger transactions and shrink back when load is low
+    static constexpr size_t MIN_PENDING_QUERIES_COUNT{50};
+    static constexpr size_t MAX_PENDING_QUERIES_COUNT{1000};
+    static constexpr double MIN_PENDING_QUERIES_DELAY{0.01};
+    static constexpr double MAX_PENDING_QUERIES_DELAY{0.1};
+    size_t max_pending_write_count_ = MIN_PENDING_QUERIES_COUNT;
+    double max_pending_write_delay_ = MIN_PENDING_QUERIES_DELAY;
+
+    enum class FlushReason : int32 { Full, Timeout, Read, Force };
 
     //NB: order is important, destructor of pending_writes_ will change pending_write_results_
     vector<std::pair<Promise<>, Status>> pending_write_results_;
     vector<Promise<>> pending_writes_;
+    std::unordered_set<DialogId, DialogIdHash> pending_write_dialog_ids_;
+    bool has_pending_write_without_dialog_ = false;
     double wakeup_at_ = 0;
     template <class F>
-    void add_write_query(F &&f) {
+    void add_write_query(DialogId dialog_id, F &&f) {
       pending_writes_.push_back(PromiseCreator::lambda(std::forward<F>(f), PromiseCreator::Ignore()));
-      if (pending_writes_.size() > MAX_PENDING_QUERIES_COUNT) {
-        do_flush();
+      if (dialog_id.is_valid()) {
+        pending_write_dialog_ids_.insert(dialog_id);
+      } else {
+        has_pending_write_without_dialog_ = true;
+      }
+      statistics_.write_count++;
+      if (pending_writes_.size() > max_pending_write_count_) {
+        do_flush(FlushReason::Full);
         wakeup_at_ = 0;
       } else if (wakeup_at_ == 0) {
-        wakeup_at_ = Time::now_cached() + MAX_PENDING_QUERIES_DELAY;
+        wakeup_at_ = Time::now_cached() + max_pending_write_delay_;
       }
       if (wakeup_at_ != 0) {
         set_timeout_at(wakeup_at_);
       }
     }
-    void add_read_query() {
-      do_flush();
+    // pending writes must be committed only if the query can see them; an invalid dialog_id means any dialog
+    void add_read_query(DialogId dialog_id) {
+      if (pending_writes_.empty()) {
+        return;
+      }
+      if (!dialog_id.is_valid() || has_pending_write_without_dialog_ ||
+          pending_write_dialog_ids_.count(dialog_id) > 0) {
+        return do_flush(FlushReason::Read);
+      }
+      statistics_.deferred_read_count++;
     }
-    void do_flush() {
+    void do_flush(FlushReason reason) {
       if (pending_writes_.empty()) {
         return;
       }
+      auto transaction_size = pending_writes_.size();
       sync_db_->begin_write_transaction().ensure();
       for (auto &query : pending_writes_) {
         query.set_value(Unit());
       }
       sync_db_->commit_transaction().ensure();
       pending_writes_.clear();
+      pending_write_dialog_ids_.clear();
+      has_pending_write_without_dialog_ = false;
       for (auto &p : pending_write_results_) {
         p.first.set_result(std::move(p.second));
       }
       pending_write_results_.clear();
       cancel_timeout();
+      wakeup_at_ = 0;
+
+      if (pending_fts_message_count_ > 0) {
+        send_closure(fts_indexer_, &FtsIndexer::on_messages_added, pending_fts_message_count_);
+        pending_fts_message_count_ = 0;
+      }
+
+      on_transaction_committed(reason, transaction_size);
+    }
+    void on_transaction_committed(FlushReason reason, size_t transaction_size) {
+      statistics_.transaction_count++;
+      statistics_.max_transaction_size = max(statistics_.max_transaction_size, transaction_size);
+      switch (reason) {
+        case FlushReason::Full:
+          // writes come faster than they are committed
+          statistics_.full_transaction_count++;
+          grow_limits(true);
+          break;
+        case FlushReason::Timeout:
+          statistics_.timeout_transaction_count++;
+          if (transaction_size * 2 >= max_pending_write_count_) {
+            // sustained moderate load; wait longer to commit bigger transactions
+            grow_limits(false);
+          } else if (transaction_size * 8 < max_pending_write_count_) {
+            shrink_limits();
+          }
+          break;
+        case FlushReason::Read:
+          statistics_.read_transaction_count++;
+          break;
+        case FlushReason::Force:
+          break;
+        default:
+          UNREACHABLE();
+      }
+      publish_statistics();
+    }
+    void grow_limits(bool grow_count) {
+      auto new_count = max_pending_write_count_;
+      if (grow_count) {
+        new_count = min(new_count * 2, MAX_PENDING_QUERIES_COUNT);
+      }
+      auto new_delay = min(max_pending_write_delay_ * 2, MAX_PENDING_QUERIES_DELAY);
+      if (new_count != max_pending_write_count_ || new_delay != max_pending_write_delay_) {
+        set_limits(new_count, new_delay);
+        statistics_.grow_count++;
+      }
+    }
+    void shrink_limits() {
+      auto new_count = max(max_pending_write_count_ / 2, MIN_PENDING_QUERIES_COUNT);
+      auto new_delay = max(max_pending_write_delay_ / 2, MIN_PENDING_QUERIES_DELAY);
+      if (new_count != max_pending_write_count_ || new_delay != max_pending_write_delay_) {
+        set_limits(new_count, new_delay);
+        statistics_.shrink_count++;
+      }
+    }
+    void set_limits(size_t max_pending_write_count, double max_pending_write_delay) {
+      LOG(DEBUG) << "Change MessagesDb transaction limits to " << max_pending_write_count << " writes and "
+                 << max_pending_write_delay << " seconds";
+      max_pending_write_count_ = max_pending_write_count;
+      max_pending_write_delay_ = max_pending_write_delay;
+      statistics_.max_pending_write_count = max_pending_write_count;
+      statistics_.max_pending_write_delay = max_pending_write_delay;
+    }
+    void publish_statistics() {
+      std::lock_guard<std::mutex> lock(statistics_data_->mutex);
+      statistics_data_->statistics = statistics_;
     }
     void timeout_expired() final {
-      do_flush();
+      do_flush(FlushReason::Timeout);
     }
 
     void start_up() final {
       sync_db_ = &sync_db_safe_->get();
+      fts_indexer_ = create_actor<FtsIndexer>("MessagesDbFtsIndexer", sync_db_safe_, statistics_data_);
+      if (!reader_scheduler_ids_.empty()) {
+        readers_ = SqliteReaderPool<MessagesDbSyncInterface>(
+            reader_scheduler_ids_, [sync_db_safe = sync_db_safe_] { return sync_db_safe->create_read_only(); });
+      }
     }
   };
+  std::shared_ptr<StatisticsData> statistics_;
   ActorOwn<Impl> impl_;
 };
 
 std::shared_ptr<MessagesDbAsyncInterface> create_messages_db_async(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db,
-                                                                   int32 scheduler_id) {
-  return std::make_shared<MessagesDbAsync>(std::move(sync_db), scheduler_id);
+                                                                   int32 scheduler_id,
+                                                                   vector<int32> reader_scheduler_ids) {
+  return std::make_shared<MessagesDbAsync>(std::move(sync_db), scheduler_id, std::move(reader_scheduler_ids));
 }
 
 }  // namespace td
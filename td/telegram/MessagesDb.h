@@ -86,6 +86,10 @@ struct MessagesDbFtsQuery {
 struct MessagesDbFtsResult {
   vector<MessagesDbMessage> messages;
   int64 next_search_id{1};
+  int64 max_unindexed_search_id{0};  // all messages with bigger search_id are already indexed
+
+  // returns -1 if the total count is unknown, because there are more results or some messages aren't indexed yet
+  int32 get_total_count(bool is_first_page, int32 limit) const;
 };
 
 struct MessagesDbCallsQuery {
@@ -137,6 +141,13 @@ class MessagesDbSyncInterface {
   virtual Result<MessagesDbCallsResult> get_calls(MessagesDbCallsQuery query) = 0;
   virtual Result<MessagesDbFtsResult> get_messages_fts(MessagesDbFtsQuery query) = 0;
 
+  // adds to the full-text index up to limit newest messages, which are waiting for indexing
+  // returns the number of processed messages
+  virtual Result<int32> index_fts_messages(int32 limit) = 0;
+  // incrementally merges segments of the full-text index, writing up to page_count pages
+  virtual Status merge_fts_index(int32 page_count) = 0;
+  virtual Result<int32> get_unindexed_fts_message_count() = 0;
+
   virtual Status begin_write_transaction() = 0;
   virtual Status commit_transaction() = 0;
 };
@@ -149,6 +160,33 @@ class MessagesDbSyncSafeInterface {
   virtual ~MessagesDbSyncSafeInterface() = default;
 
   virtual MessagesDbSyncInterface &get() = 0;
+
+  // returns a new instance with a separate read-only database connection; can be called from any thread
+  virtual unique_ptr<MessagesDbSyncInterface> create_read_only() = 0;
+};
+
+struct MessagesDbFtsIndexStatistics {
+  uint64 indexed_message_count = 0;
+  uint64 batch_count = 0;
+  uint64 merge_count = 0;
+  int32 unindexed_message_count = 0;
+  double total_batch_time = 0.0;
+  double max_batch_time = 0.0;
+};
+
+struct MessagesDbAsyncStatistics {
+  uint64 write_count = 0;
+  uint64 transaction_count = 0;
+  uint64 full_transaction_count = 0;     // transactions committed, because too many writes were pending
+  uint64 timeout_transaction_count = 0;  // transactions committed, because the oldest pending write was too old
+  uint64 read_transaction_count = 0;     // transactions committed before a read, which could see pending writes
+  uint64 deferred_read_count = 0;        // reads performed without committing unrelated pending writes
+  uint64 grow_count = 0;
+  uint64 shrink_count = 0;
+  size_t max_transaction_size = 0;
+  size_t max_pending_write_count = 0;
+  double max_pending_write_delay = 0.0;
+  MessagesDbFtsIndexStatistics fts_index;
 };
 
 class MessagesDbAsyncInterface {
@@ -196,15 +234,22 @@ class MessagesDbAsyncInterface {
 
   virtual void close(Promise<> promise) = 0;
   virtual void force_flush() = 0;
+
+  // can be called from any thread
+  virtual MessagesDbAsyncStatistics get_statistics() const = 0;
 };
 
 Status init_messages_db(SqliteDb &db, int version) TD_WARN_UNUSED_RESULT;
 Status drop_messages_db(SqliteDb &db, int version) TD_WARN_UNUSED_RESULT;
 
+// if use_data_compression is true, then new message data is stored compressed; compressed data is always readable
 std::shared_ptr<MessagesDbSyncSafeInterface> create_messages_db_sync(
-    std::shared_ptr<SqliteConnectionSafe> sqlite_connection);
+    std::shared_ptr<SqliteConnectionSafe> sqlite_connection, bool use_data_compression = false);
 
+// get_messages, get_messages_fts and get_dialog_message_calendar are run in parallel on reader_scheduler_ids
+// new messages are added to the full-text index in background batches after they are committed
 std::shared_ptr<MessagesDbAsyncInterface> create_messages_db_async(std::shared_ptr<MessagesDbSyncSafeInterface> sync_db,
-                                                                   int32 scheduler_id);
+                                                                   int32 scheduler_id,
+                                                                   vector<int32> reader_scheduler_ids = {});
 
 }  // namespace td
@@ -22052,9 +22052,7 @@ void MessagesManager::on_messages_db_fts_result(Result<MessagesDbFtsResult> resu
   }
 
   it->second.next_offset = fts_result.next_search_id <= 1 ? string() : to_string(fts_result.next_search_id);
-  it->second.total_count = offset.empty() && fts_result.messages.size() < static_cast<size_t>(limit)
-                               ? static_cast<int32>(fts_result.messages.size())
-                               : -1;
+  it->second.total_count = fts_result.get_total_count(offset.empty(), limit);
 
   promise.set_value(Unit());
 }
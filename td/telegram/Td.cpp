@@ -115,6 +115,8 @@
 #include "td/telegram/WebPagesManager.h"
 
 #include "td/db/binlog/BinlogEvent.h"
+#include "td/db/binlog/ConcurrentBinlog.h"
+#include "td/db/SqliteProfile.h"
 
 #include "td/mtproto/DhCallback.h"
 #include "td/mtproto/Handshake.h"
@@ -124,6 +126,7 @@
 #include "td/mtproto/TransportType.h"
 
 #include "td/actor/actor.h"
+#include "td/actor/ActorStats.h"
 #include "td/actor/PromiseFuture.h"
 
 #include "td/utils/algorithm.h"
@@ -2956,6 +2959,8 @@ bool Td::is_synchronous_request(int32 id) {
     case td_api::setLogTagVerbosityLevel::ID:
     case td_api::getLogTagVerbosityLevel::ID:
     case td_api::addLogMessage::ID:
+    case td_api::setActorStatisticsCollection::ID:
+    case td_api::getActorStatistics::ID:
     case td_api::testReturnError::ID:
       return true;
     default:
@@ -3380,6 +3385,10 @@ void Td::on_config_option_updated(const string &name) {
     return send_closure(stickers_manager_actor_, &StickersManager::on_update_dice_success_values);
   } else if (name == "emoji_sounds") {
     return send_closure(stickers_manager_actor_, &StickersManager::on_update_emoji_sounds);
+  } else if (name == "binlog_sync_delay" || name == "binlog_sync_event_count" || name == "use_binlog_data_sync") {
+    update_binlog_sync_policy();
+  } else if (name == "use_background_binlog_reindex") {
+    G()->td_db()->set_use_background_binlog_reindex(G()->shared_config().get_option_boolean(name));
   } else if (is_internal_config_option(name)) {
     return;
   }
@@ -3388,6 +3397,18 @@ void Td::on_config_option_updated(const string &name) {
   send_update(make_tl_object<td_api::updateOption>(name, G()->shared_config().get_option_value(name)));
 }
 
+void Td::update_binlog_sync_policy() {
+  BinlogSyncPolicy policy;
+  auto sync_delay_ms = G()->shared_config().get_option_integer("binlog_sync_delay");
+  if (sync_delay_ms > 0) {
+    policy.max_sync_delay = static_cast<double>(sync_delay_ms) * 1e-3;
+  }
+  policy.max_pending_sync_count =
+      static_cast<size_t>(G()->shared_config().get_option_integer("binlog_sync_event_count"));
+  policy.use_data_sync = G()->shared_config().get_option_boolean("use_binlog_data_sync");
+  G()->td_db()->set_binlog_sync_policy(policy);
+}
+
 void Td::on_connection_state_changed(ConnectionState new_state) {
   if (new_state == connection_state_) {
     LOG(ERROR) << "State manager sends update about unchanged state " << static_cast<int32>(new_state);
@@ -3801,12 +3822,9 @@ void Td::complete_pending_preauthentication_requests(const T &func) {
 }
 
 Status Td::init(DbKey key) {
-  auto current_scheduler_id = Scheduler::instance()->sched_id();
-  auto scheduler_count = Scheduler::instance()->sched_count();
-
   VLOG(td_init) << "Begin to init database";
   TdDb::Events events;
-  auto r_td_db = TdDb::open(min(current_scheduler_id + 1, scheduler_count - 1), parameters_, std::move(key), events);
+  auto r_td_db = TdDb::open(Global::get_helper_scheduler_id(1), parameters_, std::move(key), events);
   if (r_td_db.is_error()) {
     LOG(WARNING) << "Failed to open database: " << r_td_db.error();
     return Status::Error(400, r_td_db.error().message());
@@ -3862,7 +3880,7 @@ Status Td::init(DbKey key) {
   G()->set_my_id(G()->shared_config().get_option_integer("my_id"));
 
   storage_manager_ = create_actor<StorageManager>("StorageManager", create_reference(),
-                                                  min(current_scheduler_id + 2, scheduler_count - 1));
+                                                  Global::get_helper_scheduler_id(2));
   G()->set_storage_manager(storage_manager_.get());
 
   VLOG(td_init) << "Send binlog events";
@@ -7404,7 +7422,18 @@ void Td::on_request(uint64 id, td_api::setOption &request) {
         return;
       }
       break;
+    case 'b':
+      if (set_integer_option("binlog_sync_delay", 0, 3600000)) {
+        return;
+      }
+      if (set_integer_option("binlog_sync_event_count", 0, 1000000)) {
+        return;
+      }
+      break;
     case 'c':
+      if (set_boolean_option("compress_message_database")) {
+        return;
+      }
       if (!is_bot && set_string_option("connection_parameters", [](Slice value) {
             string value_copy = value.str();
             auto r_json_value = get_json_value(value_copy);
@@ -7417,6 +7446,10 @@ void Td::on_request(uint64 id, td_api::setOption &request) {
       }
       break;
     case 'd':
+      if (set_string_option("database_performance_profile",
+                            [](Slice value) { return get_sqlite_profile(value).is_ok(); })) {
+        return;
+      }
       if (!is_bot && set_boolean_option("disable_animated_emoji")) {
         return;
       }
@@ -7577,6 +7610,15 @@ void Td::on_request(uint64 id, td_api::setOption &request) {
       if (set_boolean_option("use_storage_optimizer")) {
         return;
       }
+      if (set_boolean_option("use_background_binlog_reindex")) {
+        return;
+      }
+      if (set_boolean_option("use_binlog_data_sync")) {
+        return;
+      }
+      if (set_boolean_option("use_crypto_worker_threads")) {
+        return;
+      }
       if (set_integer_option("utc_time_offset", -12 * 60 * 60, 14 * 60 * 60)) {
         return;
       }
@@ -8246,6 +8288,14 @@ void Td::on_request(uint64 id, const td_api::addLogMessage &request) {
   UNREACHABLE();
 }
 
+void Td::on_request(uint64 id, const td_api::setActorStatisticsCollection &request) {
+  UNREACHABLE();
+}
+
+void Td::on_request(uint64 id, const td_api::getActorStatistics &request) {
+  UNREACHABLE();
+}
+
 td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::getTextEntities &request) {
   if (!check_utf8(request.text_)) {
     return make_error(400, "Text must be encoded in UTF-8");
@@ -8453,6 +8503,26 @@ td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::addLogMes
   return td_api::make_object<td_api::ok>();
 }
 
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::setActorStatisticsCollection &request) {
+  if (request.log_period_ < 0) {
+    return make_error(400, "Log period must be non-negative");
+  }
+  ActorStats::set_enabled(request.is_enabled_, request.log_period_);
+  return td_api::make_object<td_api::ok>();
+}
+
+td_api::object_ptr<td_api::Object> Td::do_static_request(const td_api::getActorStatistics &request) {
+  auto entries = transform(ActorStats::get_all_data(), [](const ActorStats::Data &data) {
+    auto run_count = static_cast<double>(max(data.run_count, static_cast<uint64>(1)));
+    return td_api::make_object<td_api::actorStatisticsEntry>(
+        data.name, static_cast<int64>(data.run_count), static_cast<double>(data.total_mailbox_size) / run_count,
+        static_cast<int64>(data.max_mailbox_size), data.total_queue_delay / run_count, data.max_queue_delay,
+        static_cast<int64>(data.event_count), data.total_execution_time, data.max_execution_time,
+        transform(data.execution_time_histogram, [](uint64 count) { return static_cast<int64>(count); }));
+  });
+  return td_api::make_object<td_api::actorStatistics>(std::move(entries));
+}
+
 td_api::object_ptr<td_api::Object> Td::do_static_request(td_api::testReturnError &request) {
   if (request.error_ == nullptr) {
     return td_api::make_object<td_api::error>(404, "Not Found");
@@ -352,6 +352,8 @@ class Td final : public Actor {
 
   void on_config_option_updated(const string &name);
 
+  void update_binlog_sync_policy();
+
   class OnRequest;
 
   class DownloadFileCallback;
@@ -1282,6 +1284,10 @@ class Td final : public Actor {
 
   void on_request(uint64 id, const td_api::addLogMessage &request);
 
+  void on_request(uint64 id, const td_api::setActorStatisticsCollection &request);
+
+  void on_request(uint64 id, const td_api::getActorStatistics &request);
+
   // test
   void on_request(uint64 id, const td_api::testNetwork &request);
   void on_request(uint64 id, td_api::testProxy &request);
@@ -1322,6 +1328,8 @@ class Td final : public Actor {
   static td_api::object_ptr<td_api::Object> do_static_request(const td_api::setLogTagVerbosityLevel &request);
   static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getLogTagVerbosityLevel &request);
   static td_api::object_ptr<td_api::Object> do_static_request(const td_api::addLogMessage &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::setActorStatisticsCollection &request);
+  static td_api::object_ptr<td_api::Object> do_static_request(const td_api::getActorStatistics &request);
   static td_api::object_ptr<td_api::Object> do_static_request(td_api::testReturnError &request);
 
   static DbKey as_db_key(string key);
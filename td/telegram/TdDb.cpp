@@ -23,7 +23,9 @@
 #include "td/db/SqliteKeyValue.h"
 #include "td/db/SqliteKeyValueAsync.h"
 #include "td/db/SqliteKeyValueSafe.h"
+#include "td/db/SqliteProfile.h"
 
+#include "td/actor/actor.h"
 #include "td/actor/MultiPromise.h"
 
 #include "td/utils/common.h"
@@ -283,6 +285,7 @@ void TdDb::do_close(Promise<> on_finished, bool destroy_flag) {
 }
 
 Status TdDb::init_sqlite(int32 scheduler_id, const TdParameters &parameters, const DbKey &key, const DbKey &old_key,
+                         SqliteProfile profile, bool use_message_data_compression,
                          BinlogKeyValue<Binlog> &binlog_pmc) {
   CHECK(!parameters.use_message_db || parameters.use_chat_info_db);
   CHECK(!parameters.use_chat_info_db || parameters.use_file_db);
@@ -300,11 +303,11 @@ Status TdDb::init_sqlite(int32 scheduler_id, const TdParameters &parameters, con
 
   sqlite_path_ = sql_database_path;
   TRY_RESULT(db_instance, SqliteDb::change_key(sqlite_path_, true, key, old_key));
-  sql_connection_ = std::make_shared<SqliteConnectionSafe>(sql_database_path, key, db_instance.get_cipher_version());
+  sql_connection_ =
+      std::make_shared<SqliteConnectionSafe>(sql_database_path, key, db_instance.get_cipher_version(), profile);
   sql_connection_->set(std::move(db_instance));
   auto &db = sql_connection_->get();
-  TRY_STATUS(db.exec("PRAGMA journal_mode=WAL"));
-  TRY_STATUS(db.exec("PRAGMA secure_delete=1"));
+  TRY_STATUS(init_sqlite_connection(db, profile));
 
   // Init databases
   // Do initialization once and before everything else to avoid "database is locked" error.
@@ -364,19 +367,35 @@ Status TdDb::init_sqlite(int32 scheduler_id, const TdParameters &parameters, con
 
   TRY_STATUS(db.exec("COMMIT TRANSACTION"));
 
+  static constexpr double CHECKPOINT_PERIOD = 1.0;
+  sql_connection_->start_background_checkpoints(CHECKPOINT_PERIOD);
+
   file_db_ = create_file_db(sql_connection_, scheduler_id);
 
   common_kv_safe_ = std::make_shared<SqliteKeyValueSafe>("common", sql_connection_);
   common_kv_async_ = create_sqlite_key_value_async(common_kv_safe_, scheduler_id);
 
+  // heavy read queries are run in parallel with read-only connections on the helper schedulers
+  // except the current scheduler and the scheduler, which performs database writes
+  static constexpr size_t MAX_DATABASE_READER_COUNT = 2;
+  vector<int32> reader_scheduler_ids;
+  auto current_scheduler_id = Scheduler::instance()->sched_id();
+  auto scheduler_count = Scheduler::instance()->sched_count();
+  for (int32 i = 1; i < scheduler_count && reader_scheduler_ids.size() < MAX_DATABASE_READER_COUNT; i++) {
+    auto reader_scheduler_id = (scheduler_id + i) % scheduler_count;
+    if (reader_scheduler_id != current_scheduler_id) {
+      reader_scheduler_ids.push_back(reader_scheduler_id);
+    }
+  }
+
   if (use_dialog_db) {
     dialog_db_sync_safe_ = create_dialog_db_sync(sql_connection_);
-    dialog_db_async_ = create_dialog_db_async(dialog_db_sync_safe_, scheduler_id);
+    dialog_db_async_ = create_dialog_db_async(dialog_db_sync_safe_, scheduler_id, reader_scheduler_ids);
   }
 
   if (use_message_db) {
-    messages_db_sync_safe_ = create_messages_db_sync(sql_connection_);
-    messages_db_async_ = create_messages_db_async(messages_db_sync_safe_, scheduler_id);
+    messages_db_sync_safe_ = create_messages_db_sync(sql_connection_, use_message_data_compression);
+    messages_db_async_ = create_messages_db_async(messages_db_sync_safe_, scheduler_id, reader_scheduler_ids);
   }
 
   return Status::OK();
@@ -421,8 +440,22 @@ Status TdDb::init(int32 scheduler_id, const TdParameters &parameters, DbKey key,
       drop_sqlite_key = true;
     }
   }
+  // the options are stored by ConfigShared with the type prefix and are applied only on restart
+  auto sqlite_profile = SqliteProfile::Durable;
+  auto sqlite_profile_option = config_pmc->get("database_performance_profile");
+  if (!sqlite_profile_option.empty()) {
+    auto r_sqlite_profile = get_sqlite_profile(Slice(sqlite_profile_option).substr(1));
+    if (r_sqlite_profile.is_ok()) {
+      sqlite_profile = r_sqlite_profile.ok();
+    } else {
+      LOG(ERROR) << r_sqlite_profile.error();
+    }
+  }
+  bool use_message_data_compression = config_pmc->get("compress_message_database") == "Btrue";
+  bool use_background_binlog_reindex = config_pmc->get("use_background_binlog_reindex") == "Btrue";
   VLOG(td_init) << "Start to init database";
-  auto init_sqlite_status = init_sqlite(scheduler_id, parameters, new_sqlite_key, old_sqlite_key, *binlog_pmc);
+  auto init_sqlite_status = init_sqlite(scheduler_id, parameters, new_sqlite_key, old_sqlite_key, sqlite_profile,
+                                        use_message_data_compression, *binlog_pmc);
   VLOG(td_init) << "Finish to init database";
   if (init_sqlite_status.is_error()) {
     LOG(ERROR) << "Destroy bad SQLite database because of " << init_sqlite_status;
@@ -430,7 +463,8 @@ Status TdDb::init(int32 scheduler_id, const TdParameters &parameters, DbKey key,
       sql_connection_->get().close();
     }
     SqliteDb::destroy(get_sqlite_path(parameters)).ignore();
-    TRY_STATUS(init_sqlite(scheduler_id, parameters, new_sqlite_key, old_sqlite_key, *binlog_pmc));
+    TRY_STATUS(init_sqlite(scheduler_id, parameters, new_sqlite_key, old_sqlite_key, sqlite_profile,
+                           use_message_data_compression, *binlog_pmc));
   }
   if (drop_sqlite_key) {
     binlog_pmc->erase("sqlite_key");
@@ -454,6 +488,9 @@ Status TdDb::init(int32 scheduler_id, const TdParameters &parameters, DbKey key,
   CHECK(binlog_ptr != nullptr);
   VLOG(td_init) << "Create concurrent_binlog";
   auto concurrent_binlog = std::make_shared<ConcurrentBinlog>(unique_ptr<Binlog>(binlog_ptr), scheduler_id);
+  if (use_background_binlog_reindex) {
+    concurrent_binlog->set_use_background_reindex(true);
+  }
 
   VLOG(td_init) << "Init concurrent_binlog_pmc";
   concurrent_binlog_pmc->external_init_finish(concurrent_binlog);
@@ -484,6 +521,16 @@ void TdDb::change_key(DbKey key, Promise<> promise) {
   get_binlog()->change_key(std::move(key), std::move(promise));
 }
 
+void TdDb::set_binlog_sync_policy(const BinlogSyncPolicy &policy) {
+  CHECK(binlog_ != nullptr);
+  binlog_->set_sync_policy(policy);
+}
+
+void TdDb::set_use_background_binlog_reindex(bool use_background_binlog_reindex) {
+  CHECK(binlog_ != nullptr);
+  binlog_->set_use_background_reindex(use_background_binlog_reindex);
+}
+
 Status TdDb::destroy(const TdParameters &parameters) {
   SqliteDb::destroy(get_sqlite_path(parameters)).ignore();
   Binlog::destroy(get_binlog_path(parameters)).ignore();
@@ -567,7 +614,72 @@ Result<string> TdDb::get_stats() {
   }
   sb << "Max file database depth out of " << prev.size() << '/' << count
      << " elements: " << *std::max_element(prev.begin(), prev.end()) << "\n";
-  sb << "Have " << bad_count << " forward references with maximum reference to " << max_bad_to;
+  sb << "Have " << bad_count << " forward references with maximum reference to " << max_bad_to << "\n";
+
+  auto sync_statistics = binlog_->get_sync_statistics();
+  sb << "Binlog syncs: " << sync_statistics.sync_count << ", synced events with promises: "
+     << sync_statistics.synced_promise_count;
+  if (sync_statistics.sync_count != 0) {
+    sb << ", average events per sync: "
+       << static_cast<double>(sync_statistics.synced_promise_count) / static_cast<double>(sync_statistics.sync_count)
+       << ", average sync time: "
+       << format::as_time(sync_statistics.total_sync_time / static_cast<double>(sync_statistics.sync_count))
+       << ", max sync time: " << format::as_time(sync_statistics.max_sync_time);
+  }
+
+  auto reindex_statistics = binlog_->get_reindex_statistics();
+  sb << "\nBinlog regenerations: " << reindex_statistics.reindex_count
+     << ", in background: " << reindex_statistics.background_reindex_count;
+  if (reindex_statistics.reindex_count != 0) {
+    sb << ", total time: " << format::as_time(reindex_statistics.total_reindex_time)
+       << ", max blocking time: " << format::as_time(reindex_statistics.max_blocking_time)
+       << ", last size: " << format::as_size(reindex_statistics.last_size_before) << " -> "
+       << format::as_size(reindex_statistics.last_size_after) << ", last ratio: "
+       << static_cast<double>(reindex_statistics.last_size_before) /
+              static_cast<double>(reindex_statistics.last_size_after + 1);
+  }
+
+  auto checkpoint_statistics = sql_connection_->get_checkpoint_statistics();
+  sb << "\nDatabase profile: " << get_sqlite_profile_name(sql_connection_->get_profile())
+     << ", background checkpoints: " << checkpoint_statistics.checkpoint_count;
+  if (checkpoint_statistics.checkpoint_count != 0) {
+    sb << ", incomplete: " << checkpoint_statistics.incomplete_checkpoint_count << ", average checkpoint time: "
+       << format::as_time(checkpoint_statistics.total_checkpoint_time /
+                          static_cast<double>(checkpoint_statistics.checkpoint_count))
+       << ", max checkpoint time: " << format::as_time(checkpoint_statistics.max_checkpoint_time)
+       << ", last WAL size: " << checkpoint_statistics.last_wal_frame_count
+       << " pages, max WAL size: " << checkpoint_statistics.max_wal_frame_count << " pages";
+  }
+
+  if (common_kv_async_ != nullptr) {
+    auto kv_statistics = common_kv_async_->get_statistics();
+    sb << "\nKey-value writes: " << kv_statistics.set_count + kv_statistics.erase_count
+       << ", overwritten before flush: " << kv_statistics.overwritten_count
+       << ", flushes: " << kv_statistics.flush_count << ", flushed keys: " << kv_statistics.flushed_key_count;
+    sb << "\nKey-value reads: " << kv_statistics.get_count
+       << ", from pending writes: " << kv_statistics.pending_hit_count
+       << ", cache hits: " << kv_statistics.cache_hit_count << ", cache misses: " << kv_statistics.cache_miss_count;
+  }
+
+  if (messages_db_async_ != nullptr) {
+    auto messages_db_statistics = messages_db_async_->get_statistics();
+    sb << "\nMessage database writes: " << messages_db_statistics.write_count
+       << ", transactions: " << messages_db_statistics.transaction_count
+       << ", full: " << messages_db_statistics.full_transaction_count
+       << ", by timeout: " << messages_db_statistics.timeout_transaction_count
+       << ", before reads: " << messages_db_statistics.read_transaction_count
+       << ", deferred reads: " << messages_db_statistics.deferred_read_count
+       << ", max transaction size: " << messages_db_statistics.max_transaction_size
+       << ", current limits: " << messages_db_statistics.max_pending_write_count << " writes and "
+       << format::as_time(messages_db_statistics.max_pending_write_delay) << ", grown "
+       << messages_db_statistics.grow_count << " times, shrunk " << messages_db_statistics.shrink_count << " times";
+    auto &fts_index_statistics = messages_db_statistics.fts_index;
+    sb << "\nMessage full-text index: indexed " << fts_index_statistics.indexed_message_count << " messages in "
+       << fts_index_statistics.batch_count << " batches, merges: " << fts_index_statistics.merge_count
+       << ", waiting for indexing: " << fts_index_statistics.unindexed_message_count
+       << ", indexing time: " << format::as_time(fts_index_statistics.total_batch_time)
+       << ", max batch time: " << format::as_time(fts_index_statistics.max_batch_time);
+  }
 
   return sb.as_cslice().str();
 }
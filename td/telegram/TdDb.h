@@ -24,6 +24,7 @@
 namespace td {
 
 class Binlog;
+struct BinlogSyncPolicy;
 template <class BinlogT>
 class BinlogKeyValue;
 class ConcurrentBinlog;
@@ -38,6 +39,7 @@ class SqliteConnectionSafe;
 class SqliteKeyValueSafe;
 class SqliteKeyValueAsyncInterface;
 class SqliteKeyValue;
+enum class SqliteProfile : int32;
 
 class TdDb {
  public:
@@ -97,6 +99,9 @@ class TdDb {
 
   void change_key(DbKey key, Promise<> promise);
 
+  void set_binlog_sync_policy(const BinlogSyncPolicy &policy);
+  void set_use_background_binlog_reindex(bool use_background_binlog_reindex);
+
   void with_db_path(const std::function<void(CSlice)> &callback);
 
   Result<string> get_stats();
@@ -122,7 +127,7 @@ class TdDb {
 
   Status init(int32 scheduler_id, const TdParameters &parameters, DbKey key, Events &events);
   Status init_sqlite(int32 scheduler_id, const TdParameters &parameters, const DbKey &key, const DbKey &old_key,
-                     BinlogKeyValue<Binlog> &binlog_pmc);
+                     SqliteProfile profile, bool use_message_data_compression, BinlogKeyValue<Binlog> &binlog_pmc);
 
   void do_close(Promise<> on_finished, bool destroy_flag);
 };
@@ -63,6 +63,7 @@ enum class DbVersion : int32 {
   AddScheduledMessages,
   StorePinnedDialogsInBinlog,
   AddMessageThreadSupport,
+  DeferMessagesFtsIndexing,
   Next
 };
 
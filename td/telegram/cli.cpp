@@ -4426,6 +4426,13 @@ class CliClient final : public Actor {
       } else {
         execute(std::move(request));
       }
+    } else if (op == "sasc") {
+      bool is_enabled;
+      int32 log_period;
+      get_args(args, is_enabled, log_period);
+      execute(td_api::make_object<td_api::setActorStatisticsCollection>(is_enabled, log_period));
+    } else if (op == "gas") {
+      execute(td_api::make_object<td_api::getActorStatistics>());
     } else if (op == "q" || op == "Quit") {
       quit();
     } else if (op == "dnq") {
@@ -996,6 +996,7 @@ void ConnectionCreator::client_create_raw_connection(Result<ConnectionData> r_co
       mtproto::RawConnection::create(connection_data.ip_address, std::move(connection_data.buffered_socket_fd),
                                      std::move(transport_type), std::move(connection_data.stats_callback));
   raw_connection->set_connection_token(std::move(connection_data.connection_token));
+  raw_connection->set_use_crypto_workers(G()->shared_config().get_option_boolean("use_crypto_worker_threads"));
 
   raw_connection->extra().extra = network_generation;
   raw_connection->extra().debug_str = debug_str;
@@ -0,0 +1,104 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2021
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/telegram/net/GzipWorker.h"
+
+#include "td/utils/format.h"
+#include "td/utils/Gzip.h"
+#include "td/utils/SliceBuilder.h"
+#include "td/utils/Time.h"
+
+#include <atomic>
+
+namespace td {
+
+namespace {
+
+struct AtomicGzipStatistics {
+  std::atomic<uint64> count{0};
+  std::atomic<uint64> async_count{0};
+  std::atomic<uint64> input_size{0};
+  std::atomic<uint64> output_size{0};
+  std::atomic<uint64> time_ns{0};
+
+  void add(size_t input, size_t output, double time, bool is_async) {
+    count.fetch_add(1, std::memory_order_relaxed);
+    if (is_async) {
+      async_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    input_size.fetch_add(input, std::memory_order_relaxed);
+    output_size.fetch_add(output, std::memory_order_relaxed);
+    time_ns.fetch_add(static_cast<uint64>(time * 1e9), std::memory_order_relaxed);
+  }
+
+  GzipStatistics::Direction get() const {
+    GzipStatistics::Direction result;
+    result.count = count.load(std::memory_order_relaxed);
+    result.async_count = async_count.load(std::memory_order_relaxed);
+    result.input_size = input_size.load(std::memory_order_relaxed);
+    result.output_size = output_size.load(std::memory_order_relaxed);
+    result.time = static_cast<double>(time_ns.load(std::memory_order_relaxed)) * 1e-9;
+    return result;
+  }
+};
+
+AtomicGzipStatistics encode_statistics;
+AtomicGzipStatistics decode_statistics;
+
+BufferSlice do_encode(Slice data, double max_compression_ratio, bool is_async) {
+  auto start_time = Time::now();
+  auto result = gzencode(data, max_compression_ratio);
+  encode_statistics.add(data.size(), result.size(), Time::now() - start_time, is_async);
+  return result;
+}
+
+Result<BufferSlice> do_decode(Slice data, bool is_async) {
+  auto start_time = Time::now();
+  auto result = gzdecode(data);
+  decode_statistics.add(data.size(), result.size(), Time::now() - start_time, is_async);
+  if (result.empty()) {
+    return Status::Error(PSLICE() << "Failed to decompress " << data.size() << " bytes");
+  }
+  return std::move(result);
+}
+
+StringBuilder &operator<<(StringBuilder &string_builder, const GzipStatistics::Direction &statistics) {
+  return string_builder << tag("count", statistics.count) << tag("async", statistics.async_count)
+                        << tag("input", format::as_size(statistics.input_size))
+                        << tag("output", format::as_size(statistics.output_size))
+                        << tag("time", format::as_time(statistics.time));
+}
+
+}  // namespace
+
+StringBuilder &operator<<(StringBuilder &string_builder, const GzipStatistics &statistics) {
+  return string_builder << "Gzip encode " << statistics.encode << ", decode " << statistics.decode;
+}
+
+BufferSlice GzipWorker::encode(Slice data, double max_compression_ratio) {
+  return do_encode(data, max_compression_ratio, false);
+}
+
+Result<BufferSlice> GzipWorker::decode(Slice data) {
+  return do_decode(data, false);
+}
+
+GzipStatistics GzipWorker::get_statistics() {
+  GzipStatistics result;
+  result.encode = encode_statistics.get();
+  result.decode = decode_statistics.get();
+  return result;
+}
+
+void GzipWorker::encode_async(BufferSlice data, double max_compression_ratio, Promise<BufferSlice> promise) {
+  promise.set_value(do_encode(data.as_slice(), max_compression_ratio, true));
+}
+
+void GzipWorker::decode_async(BufferSlice data, Promise<BufferSlice> promise) {
+  promise.set_result(do_decode(data.as_slice(), true));
+}
+
+}  // namespace td
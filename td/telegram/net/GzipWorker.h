@@ -0,0 +1,52 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2021
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/actor/actor.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/utils/buffer.h"
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+#include "td/utils/StringBuilder.h"
+
+namespace td {
+
+struct GzipStatistics {
+  struct Direction {
+    uint64 count = 0;
+    uint64 async_count = 0;
+    uint64 input_size = 0;
+    uint64 output_size = 0;
+    double time = 0;
+  };
+  Direction encode;
+  Direction decode;
+};
+
+StringBuilder &operator<<(StringBuilder &string_builder, const GzipStatistics &statistics);
+
+// compresses queries and decompresses their results outside of the thread of the Session, which owns the worker
+class GzipWorker final : public Actor {
+ public:
+  // smaller payloads are processed synchronously, because it is faster than sending them to another thread
+  static constexpr size_t MIN_ASYNC_SIZE = 16 << 10;
+
+  // returns an empty BufferSlice if the data can't be compressed with the given ratio
+  static BufferSlice encode(Slice data, double max_compression_ratio);
+
+  static Result<BufferSlice> decode(Slice data);
+
+  static GzipStatistics get_statistics();
+
+  void encode_async(BufferSlice data, double max_compression_ratio, Promise<BufferSlice> promise);
+
+  void decode_async(BufferSlice data, Promise<BufferSlice> promise);
+};
+
+}  // namespace td
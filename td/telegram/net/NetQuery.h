@@ -50,7 +50,7 @@ class NetQuery final : public TsListNode<NetQueryDebug> {
   enum class State : int8 { Empty, Query, OK, Error };
   enum class Type : int8 { Common, Upload, Download, DownloadSmall };
   enum class AuthFlag : int8 { Off, On };
-  enum class GzipFlag : int8 { Off, On };
+  enum class GzipFlag : int8 { Off, On, Postponed };
   enum Error : int32 { Resend = 202, Canceled = 203, ResendInvokeAfter = 204 };
 
   uint64 id() const {
@@ -96,6 +96,17 @@ class NetQuery final : public TsListNode<NetQueryDebug> {
     return query_;
   }
 
+  // the query with GzipFlag::Postponed is compressed by the Session just before sending
+  void set_compressed_query(BufferSlice compressed_query) {
+    CHECK(gzip_flag_ == GzipFlag::Postponed);
+    if (compressed_query.empty()) {
+      gzip_flag_ = GzipFlag::Off;
+    } else {
+      query_ = std::move(compressed_query);
+      gzip_flag_ = GzipFlag::On;
+    }
+  }
+
   BufferSlice &ok() {
     CHECK(state_ == State::OK);
     return answer_;
@@ -340,6 +351,8 @@ class NetQuery final : public TsListNode<NetQueryDebug> {
   Slot cancel_slot_;                 // for Session and to be set by caller
   Promise<> quick_ack_promise_;      // for Session and to be set by caller
   int32 file_type_ = -1;             // to be set by caller
+  double send_time_ = 0;             // for SessionMultiProxy
+  size_t send_size_ = 0;             // for SessionMultiProxy
 
   NetQuery(State state, uint64 id, BufferSlice &&query, BufferSlice &&answer, DcId dc_id, Type type, AuthFlag auth_flag,
            GzipFlag gzip_flag, int32 tl_constructor, double total_timeout_limit, NetQueryStats *stats)
@@ -8,12 +8,12 @@
 
 #include "td/telegram/AuthManager.h"
 #include "td/telegram/Global.h"
+#include "td/telegram/net/GzipWorker.h"
 #include "td/telegram/Td.h"
 #include "td/telegram/telegram_api.h"
 
 #include "td/utils/buffer.h"
 #include "td/utils/format.h"
-#include "td/utils/Gzip.h"
 #include "td/utils/logging.h"
 #include "td/utils/Slice.h"
 #include "td/utils/Storer.h"
@@ -46,13 +46,18 @@ NetQueryPtr NetQueryCreator::create(uint64 id, const telegram_api::Function &fun
     // test compression ratio for the middle part
     // if it is less than 0.9, then try to compress the whole request
     size_t TESTED_SIZE = 1024;
-    BufferSlice compressed_part = gzencode(slice.as_slice().substr((slice.size() - TESTED_SIZE) / 2, TESTED_SIZE), 0.9);
+    BufferSlice compressed_part =
+        GzipWorker::encode(slice.as_slice().substr((slice.size() - TESTED_SIZE) / 2, TESTED_SIZE), 0.9);
     if (compressed_part.empty()) {
       gzip_flag = NetQuery::GzipFlag::Off;
     }
   }
+  if (gzip_flag == NetQuery::GzipFlag::On && slice.size() >= GzipWorker::MIN_ASYNC_SIZE) {
+    // big queries are compressed by the Session in background
+    gzip_flag = NetQuery::GzipFlag::Postponed;
+  }
   if (gzip_flag == NetQuery::GzipFlag::On) {
-    BufferSlice compressed = gzencode(slice.as_slice(), 0.9);
+    BufferSlice compressed = GzipWorker::encode(slice.as_slice(), 0.9);
     if (compressed.empty()) {
       gzip_flag = NetQuery::GzipFlag::Off;
     } else {
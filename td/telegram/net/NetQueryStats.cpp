@@ -6,6 +6,7 @@
 //
 #include "td/telegram/net/NetQueryStats.h"
 
+#include "td/telegram/net/GzipWorker.h"
 #include "td/telegram/net/NetQuery.h"
 
 #include "td/utils/format.h"
@@ -14,6 +15,8 @@
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Time.h"
 
+#include <utility>
+
 namespace td {
 
 uint64 NetQueryStats::get_count() const {
@@ -23,6 +26,13 @@ uint64 NetQueryStats::get_count() const {
 void NetQueryStats::dump_pending_network_queries() {
   auto n = get_count();
   LOG(WARNING) << tag("pending net queries", n);
+  LOG(WARNING) << GzipWorker::get_statistics();
+  {
+    std::lock_guard<std::mutex> lock(session_statistics_mutex_);
+    for (auto &it : session_statistics_) {
+      LOG(WARNING) << it.second;
+    }
+  }
 
   if (!use_list_) {
     return;
@@ -53,4 +63,13 @@ void NetQueryStats::dump_pending_network_queries() {
     }
   }
 }
+
+void NetQueryStats::set_session_statistics(const void *owner, string statistics) {
+  std::lock_guard<std::mutex> lock(session_statistics_mutex_);
+  if (statistics.empty()) {
+    session_statistics_.erase(owner);
+  } else {
+    session_statistics_[owner] = std::move(statistics);
+  }
+}
 }  // namespace td
@@ -12,6 +12,8 @@
 #include "td/utils/TsList.h"
 
 #include <atomic>
+#include <map>
+#include <mutex>
 
 namespace td {
 
@@ -40,10 +42,16 @@ class NetQueryStats {
 
   void dump_pending_network_queries();
 
+  // statistics of sessions of a SessionMultiProxy; empty statistics are removed
+  void set_session_statistics(const void *owner, string statistics);
+
  private:
   NetQueryCounter::Counter count_{0};
   std::atomic<bool> use_list_{true};
   TsList<NetQueryDebug> list_;
+
+  std::mutex session_statistics_mutex_;
+  std::map<const void *, string> session_statistics_;
 };
 
 }  // namespace td
@@ -261,6 +261,10 @@ void Session::send(NetQueryPtr &&query) {
     return_query(std::move(query));
     return;
   }
+  if (query->gzip_flag() == NetQuery::GzipFlag::Postponed || !gzip_queries_.empty()) {
+    add_gzip_query(std::move(query));
+    return;
+  }
   add_query(std::move(query));
   loop();
 }
@@ -379,6 +383,16 @@ void Session::close() {
   connection_close(&main_connection_);
   connection_close(&long_poll_connection_);
 
+  // results of the queries are already received, so the queries must not be resent
+  pending_results_.finish_all([this](PendingResult result) {
+    if (result.is_compressed) {
+      set_query_result(result.query, GzipWorker::decode(result.packet.as_slice()));
+      result.packet = BufferSlice();
+      result.is_compressed = false;
+    }
+    on_pending_result(std::move(result));
+  });
+
   for (auto &it : sent_queries_) {
     auto &query = it.second.query;
     query->set_message_id(0);
@@ -388,6 +402,8 @@ void Session::close() {
   sent_queries_.clear();
   sent_containers_.clear();
 
+  gzip_queries_.finish_all([this](NetQueryPtr query) { pending_queries_.push(std::move(query)); });
+
   flush_pending_invoke_after_queries();
   CHECK(sent_queries_.empty());
   while (!pending_queries_.empty()) {
@@ -574,7 +590,9 @@ void Session::on_session_created(uint64 unique_id, uint64 first_id) {
     BufferSlice packet(4);
     as<int32>(packet.as_slice().begin()) = telegram_api::updatesTooLong::ID;
     last_activity_timestamp_ = Time::now();
-    callback_->on_update(std::move(packet));
+    PendingResult result;
+    result.packet = std::move(packet);
+    add_pending_result(std::move(result));
   }
 
   for (auto it = sent_queries_.begin(); it != sent_queries_.end();) {
@@ -722,59 +740,142 @@ Status Session::on_update(BufferSlice packet) {
 
   last_success_timestamp_ = Time::now();
   last_activity_timestamp_ = Time::now();
-  callback_->on_update(std::move(packet));
+
+  // the update must be delivered after the previously received results
+  PendingResult result;
+  result.packet = std::move(packet);
+  add_pending_result(std::move(result));
+  return Status::OK();
+}
+
+Status Session::on_message_result_dropped(size_t original_size) {
+  if (original_size > 16 * 1024) {
+    dropped_size_ += original_size;
+    if (dropped_size_ > (256 * 1024)) {
+      auto dropped_size = dropped_size_;
+      dropped_size_ = 0;
+      return Status::Error(
+          2, PSLICE() << "Too much dropped packets " << tag("total_size", format::as_size(dropped_size)));
+    }
+  }
   return Status::OK();
 }
 
 Status Session::on_message_result_ok(uint64 id, BufferSlice packet, size_t original_size) {
   last_success_timestamp_ = Time::now();
 
-  TlParser parser(packet.as_slice());
-  int32 ID = parser.fetch_int();
-
   auto it = sent_queries_.find(id);
   if (it == sent_queries_.end()) {
+    TlParser parser(packet.as_slice());
+    int32 ID = parser.fetch_int();
     LOG(DEBUG) << "Drop result to " << tag("request_id", format::as_hex(id)) << tag("original_size", original_size)
                << tag("tl", format::as_hex(ID));
+    return on_message_result_dropped(original_size);
+  }
 
-    if (original_size > 16 * 1024) {
-      dropped_size_ += original_size;
-      if (dropped_size_ > (256 * 1024)) {
-        auto dropped_size = dropped_size_;
-        dropped_size_ = 0;
-        return Status::Error(
-            2, PSLICE() << "Too much dropped packets " << tag("total_size", format::as_size(dropped_size)));
-      }
-    }
-    return Status::OK();
+  auth_data_.on_api_response();
+  VLOG(net_query) << "Return query result " << it->second.query;
+
+  PendingResult result;
+  result.query = extract_sent_query(it);
+  result.query->on_net_read(original_size);
+  set_query_result(result.query, std::move(packet));
+  add_pending_result(std::move(result));
+  return Status::OK();
+}
+
+Status Session::on_message_result_gzip(uint64 id, BufferSlice packed_data, size_t original_size) {
+  last_success_timestamp_ = Time::now();
+
+  auto it = sent_queries_.find(id);
+  if (it == sent_queries_.end()) {
+    LOG(DEBUG) << "Drop compressed result to " << tag("request_id", format::as_hex(id))
+               << tag("original_size", original_size);
+    return on_message_result_dropped(original_size);
   }
 
   auth_data_.on_api_response();
-  Query *query_ptr = &it->second;
-  VLOG(net_query) << "Return query result " << query_ptr->query;
+  VLOG(net_query) << "Return compressed query result " << it->second.query;
+
+  PendingResult result;
+  result.query = extract_sent_query(it);
+  result.query->on_net_read(original_size);
+  if (packed_data.size() < GzipWorker::MIN_ASYNC_SIZE) {
+    set_query_result(result.query, GzipWorker::decode(packed_data.as_slice()));
+    add_pending_result(std::move(result));
+    return Status::OK();
+  }
+
+  // the compressed data is kept to decompress it synchronously if the session is closed
+  result.packet = packed_data.clone();
+  result.is_compressed = true;
+  auto token = pending_results_.add(std::move(result));
+  send_closure(get_gzip_worker(), &GzipWorker::decode_async, std::move(packed_data),
+               PromiseCreator::lambda([actor_id = actor_id(this), token](Result<BufferSlice> r_packet) {
+                 send_closure(actor_id, &Session::on_message_result_decompressed, token, std::move(r_packet));
+               }));
+  return Status::OK();
+}
+
+void Session::on_message_result_decompressed(ChangesProcessor<PendingResult>::Id token,
+                                             Result<BufferSlice> r_packet) {
+  auto &result = pending_results_.get(token);
+  CHECK(result.is_compressed);
+  set_query_result(result.query, std::move(r_packet));
+  result.packet = BufferSlice();
+  result.is_compressed = false;
+
+  pending_results_.finish(token, [this](PendingResult result) { on_pending_result(std::move(result)); });
+  loop();
+}
+
+NetQueryPtr Session::extract_sent_query(std::map<uint64, Query>::iterator it) {
+  cleanup_container(it->first, &it->second);
+  mark_as_known(it->first, &it->second);
+
+  auto query = std::move(it->second.query);
+  query->set_message_id(0);
+  query->cancel_slot_.clear_event();
+  sent_queries_.erase(it);
+  return query;
+}
+
+void Session::set_query_result(NetQueryPtr &query, Result<BufferSlice> r_packet) {
+  if (r_packet.is_error()) {
+    LOG(ERROR) << "Receive invalid result for " << query << ": " << r_packet.error();
+    query->set_error(Status::Error(502, PSLICE() << "Failed to decompress the result: " << r_packet.error().message()));
+    return;
+  }
 
+  auto packet = r_packet.move_as_ok();
+  TlParser parser(packet.as_slice());
+  int32 ID = parser.fetch_int();
   if (!parser.get_error()) {
     // Steal authorization information.
     // It is a dirty hack, yep.
     if (ID == telegram_api::auth_authorization::ID || ID == telegram_api::auth_loginTokenSuccess::ID) {
-      if (query_ptr->query->tl_constructor() != telegram_api::auth_importAuthorization::ID) {
+      if (query->tl_constructor() != telegram_api::auth_importAuthorization::ID) {
         G()->net_query_dispatcher().set_main_dc_id(raw_dc_id_);
       }
       auth_data_.set_auth_flag(true);
       shared_auth_data_->set_auth_key(auth_data_.get_main_auth_key());
     }
   }
+  query->set_ok(std::move(packet));
+}
 
-  cleanup_container(id, query_ptr);
-  mark_as_known(id, query_ptr);
-  query_ptr->query->on_net_read(original_size);
-  query_ptr->query->set_ok(std::move(packet));
-  query_ptr->query->set_message_id(0);
-  query_ptr->query->cancel_slot_.clear_event();
-  return_query(std::move(query_ptr->query));
+void Session::add_pending_result(PendingResult result) {
+  auto token = pending_results_.add(std::move(result));
+  pending_results_.finish(token, [this](PendingResult result) { on_pending_result(std::move(result)); });
+}
 
-  sent_queries_.erase(it);
-  return Status::OK();
+void Session::on_pending_result(PendingResult result) {
+  CHECK(!result.is_compressed);
+  if (result.query.empty()) {
+    callback_->on_update(std::move(result.packet));
+  } else {
+    return_query(std::move(result.query));
+  }
 }
 
 void Session::on_message_result_error(uint64 id, int error_code, string message) {
@@ -841,17 +942,12 @@ void Session::on_message_result_error(uint64 id, int error_code, string message)
     return;
   }
 
-  Query *query_ptr = &it->second;
-  VLOG(net_query) << "Return query error " << query_ptr->query;
-
-  cleanup_container(id, query_ptr);
-  mark_as_known(id, query_ptr);
-  query_ptr->query->set_error(Status::Error(error_code, message), current_info_->connection_->get_name().str());
-  query_ptr->query->set_message_id(0);
-  query_ptr->query->cancel_slot_.clear_event();
-  return_query(std::move(query_ptr->query));
+  VLOG(net_query) << "Return query error " << it->second.query;
 
-  sent_queries_.erase(it);
+  PendingResult result;
+  result.query = extract_sent_query(it);
+  result.query->set_error(Status::Error(error_code, message), current_info_->connection_->get_name().str());
+  add_pending_result(std::move(result));
 }
 
 void Session::on_message_failed_inner(uint64 id, bool in_container) {
@@ -949,7 +1045,8 @@ Status Session::on_destroy_auth_key() {
 }
 
 bool Session::has_queries() const {
-  return !pending_invoke_after_queries_.empty() || !pending_queries_.empty() || !sent_queries_.empty();
+  return !pending_invoke_after_queries_.empty() || !pending_queries_.empty() || !sent_queries_.empty() ||
+         !gzip_queries_.empty() || !pending_results_.empty();
 }
 
 void Session::resend_query(NetQueryPtr query) {
@@ -968,6 +1065,40 @@ void Session::add_query(NetQueryPtr &&net_query) {
   pending_queries_.push(std::move(net_query));
 }
 
+void Session::add_gzip_query(NetQueryPtr &&net_query) {
+  net_query->debug("Session: pending compression");
+  if (net_query->gzip_flag() != NetQuery::GzipFlag::Postponed) {
+    // the query must be sent after the previous queries, which are still compressed
+    auto token = gzip_queries_.add(std::move(net_query));
+    gzip_queries_.finish(token, [this](NetQueryPtr query) { add_query(std::move(query)); });
+    return;
+  }
+
+  auto query_data = net_query->query().clone();
+  auto token = gzip_queries_.add(std::move(net_query));
+  send_closure(get_gzip_worker(), &GzipWorker::encode_async, std::move(query_data), 0.9,
+               PromiseCreator::lambda([actor_id = actor_id(this), token](Result<BufferSlice> r_compressed_query) {
+                 send_closure(actor_id, &Session::on_query_compressed, token, std::move(r_compressed_query));
+               }));
+}
+
+void Session::on_query_compressed(ChangesProcessor<NetQueryPtr>::Id token, Result<BufferSlice> r_compressed_query) {
+  // the query is sent uncompressed if it can't be compressed
+  auto compressed_query = r_compressed_query.is_ok() ? r_compressed_query.move_as_ok() : BufferSlice();
+  gzip_queries_.get(token)->set_compressed_query(std::move(compressed_query));
+
+  gzip_queries_.finish(token, [this](NetQueryPtr query) { add_query(std::move(query)); });
+  loop();
+}
+
+ActorId<GzipWorker> Session::get_gzip_worker() {
+  if (gzip_worker_.empty()) {
+    // the scheduler is used mostly for destruction of big objects, so it has a lot of free time
+    gzip_worker_ = create_actor_on_scheduler<GzipWorker>("GzipWorker", G()->get_gc_scheduler_id());
+  }
+  return gzip_worker_.get();
+}
+
 void Session::connection_send_query(ConnectionInfo *info, NetQueryPtr &&net_query, uint64 message_id) {
   net_query->debug("Session: trying to send to mtproto::connection");
   CHECK(info->state_ == ConnectionInfo::State::Ready);
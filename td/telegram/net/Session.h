@@ -7,6 +7,7 @@
 #pragma once
 
 #include "td/telegram/net/AuthDataShared.h"
+#include "td/telegram/net/GzipWorker.h"
 #include "td/telegram/net/NetQuery.h"
 #include "td/telegram/net/TempAuthKeyWatchdog.h"
 
@@ -21,6 +22,7 @@
 
 #include "td/utils/buffer.h"
 #include "td/utils/CancellationToken.h"
+#include "td/utils/ChangesProcessor.h"
 #include "td/utils/common.h"
 #include "td/utils/List.h"
 #include "td/utils/Status.h"
@@ -139,6 +141,21 @@ class Session final
   std::deque<NetQueryPtr> pending_invoke_after_queries_;
   ListNode sent_queries_list_;
 
+  // Big queries are compressed and big results are decompressed by gzip_worker_ on another thread.
+  // Both queries and results are processed strictly in the order in which they were received.
+  ActorOwn<GzipWorker> gzip_worker_;
+
+  ChangesProcessor<NetQueryPtr> gzip_queries_;
+
+  // A query is removed from sent_queries_ as soon as its result is received, so it can't be resent or failed
+  // while the result is decompressed. Updates are delivered in order with the results.
+  struct PendingResult {
+    NetQueryPtr query;   // the query with its result or null for an update
+    BufferSlice packet;  // the update or the result, which isn't decompressed yet
+    bool is_compressed = false;
+  };
+  ChangesProcessor<PendingResult> pending_results_;
+
   struct ConnectionInfo {
     int8 connection_id_ = 0;
     Mode mode_ = Mode::Tcp;
@@ -209,7 +226,15 @@ class Session final
 
   void on_message_ack(uint64 id) final;
   Status on_message_result_ok(uint64 id, BufferSlice packet, size_t original_size) final;
+  Status on_message_result_gzip(uint64 id, BufferSlice packed_data, size_t original_size) final;
   void on_message_result_error(uint64 id, int error_code, string message) final;
+
+  Status on_message_result_dropped(size_t original_size);
+  NetQueryPtr extract_sent_query(std::map<uint64, Query>::iterator it);
+  void set_query_result(NetQueryPtr &query, Result<BufferSlice> r_packet);
+  void on_message_result_decompressed(ChangesProcessor<PendingResult>::Id token, Result<BufferSlice> r_packet);
+  void add_pending_result(PendingResult result);
+  void on_pending_result(PendingResult result);
   void on_message_failed(uint64 id, Status status) final;
 
   void on_message_info(uint64 id, int32 state, uint64 answer_id, int32 answer_size) final;
@@ -231,6 +256,9 @@ class Session final
   // send NetQueryPtr to parent
   void return_query(NetQueryPtr &&query);
   void add_query(NetQueryPtr &&net_query);
+  void add_gzip_query(NetQueryPtr &&net_query);
+  void on_query_compressed(ChangesProcessor<NetQueryPtr>::Id token, Result<BufferSlice> r_compressed_query);
+  ActorId<GzipWorker> get_gzip_worker();
   void resend_query(NetQueryPtr query);
 
   void connection_open(ConnectionInfo *info, bool ask_info = false);
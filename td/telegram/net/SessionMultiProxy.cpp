@@ -6,6 +6,8 @@
 //
 #include "td/telegram/net/SessionMultiProxy.h"
 
+#include "td/telegram/Global.h"
+#include "td/telegram/net/NetQueryStats.h"
 #include "td/telegram/net/SessionProxy.h"
 
 #include "td/utils/common.h"
@@ -13,8 +15,9 @@
 #include "td/utils/logging.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
+#include "td/utils/Time.h"
 
-#include <algorithm>
+#include <utility>
 
 namespace td {
 
@@ -37,34 +40,88 @@ SessionMultiProxy::SessionMultiProxy(int32 session_count, std::shared_ptr<AuthDa
   }
 }
 
+StringBuilder &operator<<(StringBuilder &string_builder, const SessionMultiProxy::SessionStatistics &statistics) {
+  return string_builder << tag("queries", statistics.queries_count)
+                        << tag("size", format::as_size(statistics.queries_size))
+                        << tag("finished", statistics.finished_queries_count)
+                        << tag("time", format::as_time(statistics.query_time))
+                        << tag("failure_rate", statistics.failure_rate);
+}
+
+void SessionMultiProxy::SessionStatistics::on_query_sent(size_t query_size) {
+  queries_count++;
+  queries_size += query_size;
+}
+
+void SessionMultiProxy::SessionStatistics::on_query_finished(double new_query_time, size_t query_size,
+                                                             bool is_failed) {
+  queries_count--;
+  CHECK(queries_count >= 0);
+  CHECK(queries_size >= query_size);
+  queries_size -= query_size;
+
+  constexpr double ALPHA = 0.2;
+  if (finished_queries_count == 0) {
+    query_time = new_query_time;
+  } else {
+    query_time += ALPHA * (new_query_time - query_time);
+  }
+  failure_rate += ALPHA * ((is_failed ? 1.0 : 0.0) - failure_rate);
+  finished_queries_count++;
+}
+
+double SessionMultiProxy::SessionStatistics::get_load() const {
+  constexpr double DEFAULT_QUERY_TIME = 0.5;
+  constexpr double BYTES_PER_SECOND = 1 << 20;
+  constexpr double FAILURE_PENALTY = 10.0;
+  auto expected_query_time = finished_queries_count == 0 ? DEFAULT_QUERY_TIME : query_time;
+  auto load = (queries_count + 1) * expected_query_time + static_cast<double>(queries_size) / BYTES_PER_SECOND;
+  return load * (1.0 + FAILURE_PENALTY * failure_rate);
+}
+
+size_t SessionMultiProxy::choose_session(const vector<SessionStatistics> &sessions) {
+  CHECK(!sessions.empty());
+  size_t result = 0;
+  double min_load = 0;
+  for (size_t i = 0; i < sessions.size(); i++) {
+    auto load = sessions[i].get_load();
+    if (i == 0 || load < min_load) {
+      result = i;
+      min_load = load;
+    }
+  }
+  return result;
+}
+
 void SessionMultiProxy::send(NetQueryPtr query) {
   size_t pos = 0;
-  // TODO temporary hack with total_timeout_limit
-  if (query->auth_flag() == NetQuery::AuthFlag::On && query->total_timeout_limit_ > 7) {
+  // queries, which don't need authorization, are sent mostly before authorization, when only the first session is used
+  if (query->auth_flag() == NetQuery::AuthFlag::On) {
     if (query->session_rand()) {
+      // queries from the same sequence must be sent to the same session, because they are chained with invokeAfterMsg
       pos = query->session_rand() % sessions_.size();
     } else {
-      pos = std::min_element(sessions_.begin(), sessions_.end(),
-                             [](const auto &a, const auto &b) { return a.queries_count < b.queries_count; }) -
-            sessions_.begin();
+      pos = choose_session(session_statistics_);
     }
   }
   // query->debug(PSTRING() << get_name() << ": send to proxy #" << pos);
-  sessions_[pos].queries_count++;
-  send_closure(sessions_[pos].proxy, &SessionProxy::send, std::move(query));
+  query->send_time_ = Time::now();
+  query->send_size_ = query->query().size();
+  session_statistics_[pos].on_query_sent(query->send_size_);
+  send_closure(sessions_[pos], &SessionProxy::send, std::move(query));
 }
 
 void SessionMultiProxy::update_main_flag(bool is_main) {
   LOG(INFO) << "Update " << get_name() << " is_main to " << is_main;
   is_main_ = is_main;
   for (auto &session : sessions_) {
-    send_closure(session.proxy, &SessionProxy::update_main_flag, is_main);
+    send_closure(session, &SessionProxy::update_main_flag, is_main);
   }
 }
 
 void SessionMultiProxy::update_destroy_auth_key(bool need_destroy_auth_key) {
   need_destroy_auth_key_ = need_destroy_auth_key;
-  send_closure(sessions_[0].proxy, &SessionProxy::update_destroy, need_destroy_auth_key_);
+  send_closure(sessions_[0], &SessionProxy::update_destroy, need_destroy_auth_key_);
 }
 void SessionMultiProxy::update_session_count(int32 session_count) {
   update_options(session_count, use_pfs_);
@@ -103,7 +160,7 @@ void SessionMultiProxy::update_options(int32 session_count, bool use_pfs) {
 
 void SessionMultiProxy::update_mtproto_header() {
   for (auto &session : sessions_) {
-    send_closure_later(session.proxy, &SessionProxy::update_mtproto_header);
+    send_closure_later(session, &SessionProxy::update_mtproto_header);
   }
 }
 
@@ -111,6 +168,13 @@ void SessionMultiProxy::start_up() {
   init();
 }
 
+void SessionMultiProxy::tear_down() {
+  auto net_query_stats = G()->get_net_query_stats();
+  if (net_query_stats != nullptr) {
+    net_query_stats->set_session_statistics(this, string());
+  }
+}
+
 bool SessionMultiProxy::get_pfs_flag() const {
   return use_pfs_ && !is_cdn_;
 }
@@ -118,6 +182,7 @@ bool SessionMultiProxy::get_pfs_flag() const {
 void SessionMultiProxy::init() {
   sessions_generation_++;
   sessions_.clear();
+  session_statistics_.clear();
   if (is_main_ && session_count_ > 1) {
     LOG(WARNING) << tag("session_count", session_count_);
   }
@@ -125,14 +190,14 @@ void SessionMultiProxy::init() {
     string name = PSTRING() << "Session" << get_name().substr(Slice("SessionMulti").size())
                             << format::cond(session_count_ > 1, format::concat("#", i));
 
-    SessionInfo info;
     class Callback final : public SessionProxy::Callback {
      public:
       Callback(ActorId<SessionMultiProxy> parent, uint32 generation, int32 session_id)
           : parent_(parent), generation_(generation), session_id_(session_id) {
       }
-      void on_query_finished() final {
-        send_closure(parent_, &SessionMultiProxy::on_query_finished, generation_, session_id_);
+      void on_query_finished(double query_time, size_t query_size, bool is_failed) final {
+        send_closure(parent_, &SessionMultiProxy::on_query_finished, generation_, session_id_, query_time, query_size,
+                     is_failed);
       }
 
      private:
@@ -140,19 +205,38 @@ void SessionMultiProxy::init() {
       uint32 generation_;
       int32 session_id_;
     };
-    info.proxy = create_actor<SessionProxy>(name, make_unique<Callback>(actor_id(this), sessions_generation_, i),
-                                            auth_data_, is_main_, allow_media_only_, is_media_, get_pfs_flag(), is_cdn_,
-                                            need_destroy_auth_key_ && i == 0);
-    sessions_.push_back(std::move(info));
+    sessions_.push_back(create_actor<SessionProxy>(
+        name, make_unique<Callback>(actor_id(this), sessions_generation_, i), auth_data_, is_main_, allow_media_only_,
+        is_media_, get_pfs_flag(), is_cdn_, need_destroy_auth_key_ && i == 0));
+    session_statistics_.emplace_back();
+  }
+  update_statistics(true);
+}
+
+void SessionMultiProxy::update_statistics(bool force) {
+  if (!force && Time::now() < next_statistics_update_time_) {
+    return;
+  }
+  next_statistics_update_time_ = Time::now() + 1;
+
+  auto net_query_stats = G()->get_net_query_stats();
+  if (net_query_stats == nullptr) {
+    return;
+  }
+  string statistics = PSTRING() << get_name();
+  for (size_t i = 0; i < session_statistics_.size(); i++) {
+    statistics += PSTRING() << "\n  session #" << i << ": " << session_statistics_[i];
   }
+  net_query_stats->set_session_statistics(this, std::move(statistics));
 }
 
-void SessionMultiProxy::on_query_finished(uint32 generation, int session_id) {
+void SessionMultiProxy::on_query_finished(uint32 generation, int session_id, double query_time, size_t query_size,
+                                          bool is_failed) {
   if (generation != sessions_generation_) {
     return;
   }
-  sessions_.at(session_id).queries_count--;
-  CHECK(sessions_.at(session_id).queries_count >= 0);
+  session_statistics_.at(session_id).on_query_finished(query_time, query_size, is_failed);
+  update_statistics(false);
 }
 
 }  // namespace td
@@ -11,6 +11,9 @@
 
 #include "td/actor/actor.h"
 
+#include "td/utils/common.h"
+#include "td/utils/StringBuilder.h"
+
 #include <memory>
 
 namespace td {
@@ -36,6 +39,24 @@ class SessionMultiProxy final : public Actor {
 
   void update_destroy_auth_key(bool need_destroy_auth_key);
 
+  struct SessionStatistics {
+    int queries_count{0};
+    size_t queries_size{0};  // total size of sent, but not finished queries
+    uint64 finished_queries_count{0};
+    double query_time{0};    // exponentially weighted moving average of time needed to get a query result
+    double failure_rate{0};  // exponentially weighted moving average of share of failed queries
+
+    void on_query_sent(size_t query_size);
+
+    void on_query_finished(double query_time, size_t query_size, bool is_failed);
+
+    // returns expected time needed to get result of a new query, if it is sent to the session
+    double get_load() const;
+  };
+
+  // returns the session with the smallest load
+  static size_t choose_session(const vector<SessionStatistics> &sessions);
+
  private:
   int32 session_count_ = 0;
   std::shared_ptr<AuthDataShared> auth_data_;
@@ -45,19 +66,22 @@ class SessionMultiProxy final : public Actor {
   bool is_media_ = false;
   bool is_cdn_ = false;
   bool need_destroy_auth_key_ = false;
-  struct SessionInfo {
-    ActorOwn<SessionProxy> proxy;
-    int queries_count{0};
-  };
   uint32 sessions_generation_{0};
-  std::vector<SessionInfo> sessions_;
+  std::vector<ActorOwn<SessionProxy>> sessions_;
+  std::vector<SessionStatistics> session_statistics_;
+  double next_statistics_update_time_{0};
 
   void start_up() final;
+  void tear_down() final;
   void init();
 
   bool get_pfs_flag() const;
 
-  void on_query_finished(uint32 generation, int session_id);
+  void update_statistics(bool force);
+
+  void on_query_finished(uint32 generation, int session_id, double query_time, size_t query_size, bool is_failed);
 };
 
+StringBuilder &operator<<(StringBuilder &string_builder, const SessionMultiProxy::SessionStatistics &statistics);
+
 }  // namespace td
@@ -21,6 +21,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/Slice.h"
 #include "td/utils/SliceBuilder.h"
+#include "td/utils/Time.h"
 
 #include <functional>
 
@@ -66,7 +67,8 @@ class SessionCallback final : public Session::Callback {
 
   void on_result(NetQueryPtr query) final {
     if (UniqueId::extract_type(query->id()) != UniqueId::BindKey) {
-      send_closure(parent_, &SessionProxy::on_query_finished);
+      send_closure(parent_, &SessionProxy::on_query_finished, Time::now() - query->send_time_, query->send_size_,
+                   is_failed(query));
     }
     G()->net_query_dispatcher().dispatch(std::move(query));
   }
@@ -77,6 +79,15 @@ class SessionCallback final : public Session::Callback {
   bool allow_media_only_ = false;
   bool is_media_ = false;
   size_t hash_ = 0;
+
+  // returns true if the query has failed because of the session or the server, but not because of the query itself
+  static bool is_failed(const NetQueryPtr &query) {
+    if (!query->is_error()) {
+      return false;
+    }
+    auto code = query->error().code();
+    return code == NetQuery::Error::Resend || code >= 500 || code < 0;
+  }
 };
 
 SessionProxy::SessionProxy(unique_ptr<Callback> callback, std::shared_ptr<AuthDataShared> shared_auth_data,
@@ -116,7 +127,7 @@ void SessionProxy::start_up() {
 void SessionProxy::tear_down() {
   for (auto &query : pending_queries_) {
     query->resend();
-    callback_->on_query_finished();
+    callback_->on_query_finished(Time::now() - query->send_time_, query->send_size_, true);
     G()->net_query_dispatcher().dispatch(std::move(query));
   }
   pending_queries_.clear();
@@ -250,8 +261,8 @@ void SessionProxy::on_server_salt_updated(std::vector<mtproto::ServerSalt> serve
   server_salts_ = std::move(server_salts);
 }
 
-void SessionProxy::on_query_finished() {
-  callback_->on_query_finished();
+void SessionProxy::on_query_finished(double query_time, size_t query_size, bool is_failed) {
+  callback_->on_query_finished(query_time, query_size, is_failed);
 }
 
 }  // namespace td
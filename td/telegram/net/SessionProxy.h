@@ -26,7 +26,7 @@ class SessionProxy final : public Actor {
   class Callback {
    public:
     virtual ~Callback() = default;
-    virtual void on_query_finished() = 0;
+    virtual void on_query_finished(double query_time, size_t query_size, bool is_failed) = 0;
   };
 
   SessionProxy(unique_ptr<Callback> callback, std::shared_ptr<AuthDataShared> shared_auth_data, bool is_main,
@@ -62,7 +62,7 @@ class SessionProxy final : public Actor {
   void on_tmp_auth_key_updated(mtproto::AuthKey auth_key);
   void on_server_salt_updated(std::vector<mtproto::ServerSalt> server_salts);
 
-  void on_query_finished();
+  void on_query_finished(double query_time, size_t query_size, bool is_failed);
 
   void start_up() final;
   void tear_down() final;
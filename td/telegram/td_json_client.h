@@ -151,6 +151,17 @@ TDJSON_EXPORT void td_send(int client_id, const char *request);
  */
 TDJSON_EXPORT const char *td_receive(double timeout);
 
+/**
+ * Receives up to max_count incoming updates and request responses at once. Must not be called simultaneously from two
+ * different threads or simultaneously with td_receive.
+ * The returned pointer can be used until the next call to td_receive, td_receive_batch or td_execute, after which it will be deallocated by TDLib.
+ * \param[in] max_count The maximum number of returned objects.
+ * \param[in] timeout The maximum number of seconds allowed for this function to wait for new data.
+ * \return JSON-serialized null-terminated array of incoming updates and request responses in the order they were received.
+ *         May be NULL if the timeout expires.
+ */
+TDJSON_EXPORT const char *td_receive_batch(int max_count, double timeout);
+
 /**
  * Synchronously executes a TDLib request.
  * A request can be executed synchronously, only if it is documented with "Can be called synchronously".
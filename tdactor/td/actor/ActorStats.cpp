@@ -0,0 +1,224 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2021
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/actor/ActorStats.h"
+
+#include "td/utils/format.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/SliceBuilder.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+namespace td {
+
+std::atomic<bool> ActorStats::is_enabled_{false};
+
+namespace {
+
+struct ActorStatsRegistry {
+  std::mutex mutex;
+  std::unordered_map<string, unique_ptr<ActorStats>> stats;
+
+  std::atomic<int64> log_period_ns{0};
+  std::atomic<int64> next_log_time_ns{0};
+};
+
+ActorStatsRegistry &get_registry() {
+  // never destroyed, because actors can be run during static destruction
+  static auto *registry = new ActorStatsRegistry();
+  return *registry;
+}
+
+uint64 to_nanoseconds(double seconds) {
+  if (seconds <= 0) {
+    return 0;
+  }
+  return static_cast<uint64>(seconds * 1e9);
+}
+
+double to_seconds(uint64 nanoseconds) {
+  return static_cast<double>(nanoseconds) * 1e-9;
+}
+
+void update_max(std::atomic<uint64> &max_value, uint64 value) {
+  auto old_value = max_value.load(std::memory_order_relaxed);
+  while (old_value < value && !max_value.compare_exchange_weak(old_value, value, std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+ActorStats::ActorStats(string name) : name_(std::move(name)) {
+  clear();
+}
+
+void ActorStats::on_run(size_t mailbox_size, double queue_delay) {
+  run_count_.fetch_add(1, std::memory_order_relaxed);
+  total_mailbox_size_.fetch_add(mailbox_size, std::memory_order_relaxed);
+  update_max(max_mailbox_size_, mailbox_size);
+  auto queue_delay_ns = to_nanoseconds(queue_delay);
+  total_queue_delay_ns_.fetch_add(queue_delay_ns, std::memory_order_relaxed);
+  update_max(max_queue_delay_ns_, queue_delay_ns);
+}
+
+void ActorStats::on_event(double execution_time) {
+  event_count_.fetch_add(1, std::memory_order_relaxed);
+  auto execution_time_ns = to_nanoseconds(execution_time);
+  total_execution_time_ns_.fetch_add(execution_time_ns, std::memory_order_relaxed);
+  update_max(max_execution_time_ns_, execution_time_ns);
+
+  size_t bucket = 0;
+  uint64 bucket_limit_ns = 10000;
+  while (bucket + 1 < EXECUTION_TIME_HISTOGRAM_SIZE && execution_time_ns >= bucket_limit_ns) {
+    bucket++;
+    bucket_limit_ns *= 10;
+  }
+  execution_time_histogram_[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+ActorStats::Data ActorStats::get_data() const {
+  Data result;
+  result.name = name_;
+  result.run_count = run_count_.load(std::memory_order_relaxed);
+  result.total_mailbox_size = total_mailbox_size_.load(std::memory_order_relaxed);
+  result.max_mailbox_size = max_mailbox_size_.load(std::memory_order_relaxed);
+  result.total_queue_delay = to_seconds(total_queue_delay_ns_.load(std::memory_order_relaxed));
+  result.max_queue_delay = to_seconds(max_queue_delay_ns_.load(std::memory_order_relaxed));
+  result.event_count = event_count_.load(std::memory_order_relaxed);
+  result.total_execution_time = to_seconds(total_execution_time_ns_.load(std::memory_order_relaxed));
+  result.max_execution_time = to_seconds(max_execution_time_ns_.load(std::memory_order_relaxed));
+  for (size_t i = 0; i < EXECUTION_TIME_HISTOGRAM_SIZE; i++) {
+    result.execution_time_histogram[i] = execution_time_histogram_[i].load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
+void ActorStats::clear() {
+  run_count_.store(0, std::memory_order_relaxed);
+  total_mailbox_size_.store(0, std::memory_order_relaxed);
+  max_mailbox_size_.store(0, std::memory_order_relaxed);
+  total_queue_delay_ns_.store(0, std::memory_order_relaxed);
+  max_queue_delay_ns_.store(0, std::memory_order_relaxed);
+  event_count_.store(0, std::memory_order_relaxed);
+  total_execution_time_ns_.store(0, std::memory_order_relaxed);
+  max_execution_time_ns_.store(0, std::memory_order_relaxed);
+  for (auto &count : execution_time_histogram_) {
+    count.store(0, std::memory_order_relaxed);
+  }
+}
+
+ActorStats *ActorStats::get(Slice name) {
+  auto &registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto &stats = registry.stats[name.str()];
+  if (stats == nullptr) {
+    stats = td::make_unique<ActorStats>(name.str());
+  }
+  return stats.get();
+}
+
+string ActorStats::get_type_name(Slice signature) {
+  string name = signature.str();
+  // GCC and Clang: "static td::ActorStats* td::ActorStats::get_by_type() [with T = td::Td]"
+  auto pos = name.find("T = ");
+  if (pos != string::npos) {
+    name = name.substr(pos + 4);
+    auto end_pos = name.find(';');
+    if (end_pos == string::npos) {
+      end_pos = name.rfind(']');
+    }
+    return name.substr(0, end_pos);
+  }
+  // MSVC: "class td::ActorStats *__cdecl td::ActorStats::get_by_type<class td::Td>(void)"
+  pos = name.find("get_by_type<");
+  if (pos != string::npos) {
+    name = name.substr(pos + 12);
+    name = name.substr(0, name.rfind('>'));
+    for (Slice prefix : {Slice("class "), Slice("struct ")}) {
+      if (begins_with(name, prefix)) {
+        name = name.substr(prefix.size());
+      }
+    }
+  }
+  return name;
+}
+
+void ActorStats::set_enabled(bool is_enabled, double log_period) {
+  auto &registry = get_registry();
+  if (is_enabled && !is_enabled_.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (auto &it : registry.stats) {
+      it.second->clear();
+    }
+  }
+  auto log_period_ns = is_enabled ? static_cast<int64>(to_nanoseconds(log_period)) : 0;
+  registry.log_period_ns.store(log_period_ns, std::memory_order_relaxed);
+  registry.next_log_time_ns.store(0, std::memory_order_relaxed);
+  is_enabled_.store(is_enabled, std::memory_order_relaxed);
+}
+
+vector<ActorStats::Data> ActorStats::get_all_data() {
+  auto &registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  vector<Data> result;
+  for (auto &it : registry.stats) {
+    auto data = it.second->get_data();
+    if (data.run_count != 0 || data.event_count != 0) {
+      result.push_back(std::move(data));
+    }
+  }
+  std::sort(result.begin(), result.end(),
+            [](const Data &lhs, const Data &rhs) { return lhs.total_execution_time > rhs.total_execution_time; });
+  return result;
+}
+
+void ActorStats::log_if_needed(double now) {
+  auto &registry = get_registry();
+  auto log_period_ns = registry.log_period_ns.load(std::memory_order_relaxed);
+  if (log_period_ns <= 0) {
+    return;
+  }
+  auto now_ns = static_cast<int64>(to_nanoseconds(now));
+  auto next_log_time_ns = registry.next_log_time_ns.load(std::memory_order_relaxed);
+  if (now_ns < next_log_time_ns) {
+    return;
+  }
+  // only one scheduler writes the statistics
+  if (!registry.next_log_time_ns.compare_exchange_strong(next_log_time_ns, now_ns + log_period_ns,
+                                                         std::memory_order_relaxed)) {
+    return;
+  }
+  if (next_log_time_ns == 0) {
+    // statistics has just been enabled
+    return;
+  }
+
+  auto all_data = get_all_data();
+  const size_t MAX_LOGGED_ACTORS = 20;
+  if (all_data.size() > MAX_LOGGED_ACTORS) {
+    all_data.resize(MAX_LOGGED_ACTORS);
+  }
+  auto sb = StringBuilder(MutableSlice(), true);
+  sb << "Actor statistics:";
+  for (auto &data : all_data) {
+    sb << "\n  " << data.name << ": runs = " << data.run_count;
+    if (data.run_count != 0) {
+      sb << ", average mailbox = " << static_cast<double>(data.total_mailbox_size) / static_cast<double>(data.run_count)
+         << ", max mailbox = " << data.max_mailbox_size << ", average queue delay = "
+         << format::as_time(data.total_queue_delay / static_cast<double>(data.run_count))
+         << ", max queue delay = " << format::as_time(data.max_queue_delay);
+    }
+    sb << ", events = " << data.event_count << ", execution time = " << format::as_time(data.total_execution_time)
+       << ", max execution time = " << format::as_time(data.max_execution_time) << ", histogram = "
+       << format::as_array(data.execution_time_histogram);
+  }
+  LOG(WARNING) << sb.as_cslice();
+}
+
+}  // namespace td
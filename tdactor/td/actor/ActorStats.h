@@ -0,0 +1,100 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2021
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/port/platform.h"
+#include "td/utils/Slice.h"
+
+#include <array>
+#include <atomic>
+
+namespace td {
+
+// Statistics of event processing by all actors of the same class
+// Actors are attributed by class instead of name, because many actors have names with per-instance identifiers
+// Time spent by a scheduler in poll is stored as an event of a pseudo-actor named "<poll N>"
+class ActorStats {
+ public:
+  // events processed in less than 10us, 100us, 1ms, 10ms, 100ms, 1s and in at least 1s
+  static constexpr size_t EXECUTION_TIME_HISTOGRAM_SIZE = 7;
+
+  struct Data {
+    string name;
+    uint64 run_count = 0;
+    uint64 total_mailbox_size = 0;
+    uint64 max_mailbox_size = 0;
+    double total_queue_delay = 0.0;
+    double max_queue_delay = 0.0;
+    uint64 event_count = 0;
+    double total_execution_time = 0.0;
+    double max_execution_time = 0.0;
+    std::array<uint64, EXECUTION_TIME_HISTOGRAM_SIZE> execution_time_histogram{};
+  };
+
+  explicit ActorStats(string name);
+
+  CSlice get_name() const {
+    return name_;
+  }
+
+  // the actor is run with mailbox_size events in its mailbox, the first of which was waiting for queue_delay seconds
+  void on_run(size_t mailbox_size, double queue_delay);
+
+  // an event was processed in execution_time seconds
+  void on_event(double execution_time);
+
+  Data get_data() const;
+
+  void clear();
+
+  // returns statistics with the given name, the object is never destroyed
+  static ActorStats *get(Slice name);
+
+  // returns statistics for actors of the class T
+  template <class T>
+  static ActorStats *get_by_type() {
+#if TD_MSVC
+    static ActorStats *stats = get(get_type_name(__FUNCSIG__));
+#else
+    static ActorStats *stats = get(get_type_name(__PRETTY_FUNCTION__));
+#endif
+    return stats;
+  }
+
+  static bool is_enabled() {
+    return is_enabled_.load(std::memory_order_relaxed);
+  }
+
+  // enabling of statistics collection clears all previously collected statistics
+  // if log_period is positive, then statistics is written to the log every log_period seconds
+  static void set_enabled(bool is_enabled, double log_period);
+
+  static vector<Data> get_all_data();
+
+  static void log_if_needed(double now);
+
+ private:
+  string name_;
+
+  std::atomic<uint64> run_count_{0};
+  std::atomic<uint64> total_mailbox_size_{0};
+  std::atomic<uint64> max_mailbox_size_{0};
+  std::atomic<uint64> total_queue_delay_ns_{0};
+  std::atomic<uint64> max_queue_delay_ns_{0};
+  std::atomic<uint64> event_count_{0};
+  std::atomic<uint64> total_execution_time_ns_{0};
+  std::atomic<uint64> max_execution_time_ns_{0};
+  std::array<std::atomic<uint64>, EXECUTION_TIME_HISTOGRAM_SIZE> execution_time_histogram_;
+
+  static std::atomic<bool> is_enabled_;
+
+  // extracts name of the type T from the signature of get_by_type<T>
+  static string get_type_name(Slice signature);
+};
+
+}  // namespace td
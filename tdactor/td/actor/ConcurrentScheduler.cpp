@@ -15,7 +15,7 @@
 
 namespace td {
 
-void ConcurrentScheduler::init(int32 threads_n) {
+void ConcurrentScheduler::init(int32 threads_n, bool use_work_stealing) {
 #if TD_THREAD_UNSUPPORTED || TD_EVENTFD_UNSUPPORTED
   threads_n = 0;
 #endif
@@ -53,6 +53,19 @@ void ConcurrentScheduler::init(int32 threads_n) {
     sched->init(i, outbound, static_cast<Scheduler::Callback *>(this));
   }
 
+#if !TD_THREAD_UNSUPPORTED && !TD_EVENTFD_UNSUPPORTED
+  // the extra scheduler isn't run, so it can't take part in work stealing
+  if (use_work_stealing && threads_n > 1) {
+    std::vector<std::shared_ptr<Scheduler::WorkStealingQueue>> stealing_queues(threads_n);
+    for (auto &queue : stealing_queues) {
+      queue = std::make_shared<Scheduler::WorkStealingQueue>();
+    }
+    for (int32 i = 0; i < threads_n; i++) {
+      schedulers_[i]->init_work_stealing(stealing_queues);
+    }
+  }
+#endif
+
 #if TD_PORT_WINDOWS
   iocp_ = make_unique<detail::Iocp>();
   iocp_->init();
@@ -113,6 +126,23 @@ bool ConcurrentScheduler::run_main(Timestamp timeout) {
   return !is_finished();
 }
 
+double ConcurrentScheduler::get_average_event_batch_size(int32 from_sched_id, int32 to_sched_id) const {
+  CHECK(0 <= from_sched_id && from_sched_id < static_cast<int32>(schedulers_.size()));
+  return schedulers_[from_sched_id]->get_average_outbound_batch_size(to_sched_id);
+}
+
+double ConcurrentScheduler::get_busy_time(int32 sched_id) const {
+  CHECK(0 <= sched_id && sched_id < static_cast<int32>(schedulers_.size()));
+  return schedulers_[sched_id]->get_busy_time();
+}
+
+void ConcurrentScheduler::set_collect_busy_time(bool collect_busy_time) {
+  CHECK(state_ == State::Start);
+  for (auto &scheduler : schedulers_) {
+    scheduler->set_collect_busy_time(collect_busy_time);
+  }
+}
+
 Timestamp ConcurrentScheduler::get_main_timeout() {
   CHECK(state_ == State::Run);
   return schedulers_[0]->get_timeout();
@@ -26,7 +26,9 @@ namespace td {
 
 class ConcurrentScheduler final : private Scheduler::Callback {
  public:
-  void init(int32 threads_n);
+  // if use_work_stealing is true, then idle schedulers take ready to run actors, which allowed stealing,
+  // from busy schedulers
+  void init(int32 threads_n, bool use_work_stealing = false);
 
   void finish_async() {
     schedulers_[0]->finish();
@@ -55,6 +57,15 @@ class ConcurrentScheduler final : private Scheduler::Callback {
   }
   bool run_main(Timestamp timeout);
 
+  // returns average number of events sent at once from one scheduler to another
+  double get_average_event_batch_size(int32 from_sched_id, int32 to_sched_id) const;
+
+  // returns total time spent by the scheduler in processing of events, in seconds
+  double get_busy_time(int32 sched_id) const;
+
+  // busy time of schedulers is collected only if enabled; must be called before start
+  void set_collect_busy_time(bool collect_busy_time);
+
   Timestamp get_main_timeout();
   static double emscripten_get_main_timeout();
   static void emscripten_clear_main_timeout();
@@ -81,6 +81,10 @@ class Actor : public ObserverBase {
 
   void always_wait_for_mailbox();
 
+  // allows idle schedulers to take the actor, when its scheduler is busy
+  // the actor must not own file descriptors, scheduler-local data or pending timeouts
+  void allow_stealing();
+
   // for ActorInfo mostly
   void init(ObjectPool<ActorInfo>::OwnerPtr &&info);
   ActorInfo *get_info();
@@ -168,4 +168,8 @@ inline void Actor::always_wait_for_mailbox() {
   info_->always_wait_for_mailbox();
 }
 
+inline void Actor::allow_stealing() {
+  info_->allow_stealing();
+}
+
 }  // namespace td
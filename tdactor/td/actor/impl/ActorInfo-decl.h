@@ -23,6 +23,7 @@
 namespace td {
 
 class Actor;
+class ActorStats;
 
 class ActorContext {
  public:
@@ -63,7 +64,7 @@ class ActorInfo final
   ActorInfo &operator=(const ActorInfo &) = delete;
 
   void init(int32 sched_id, Slice name, ObjectPool<ActorInfo>::OwnerPtr &&this_ptr, Actor *actor_ptr, Deleter deleter,
-            bool need_context, bool need_start_up);
+            bool need_context, bool need_start_up, ActorStats *(*get_stats)());
   void on_actor_moved(Actor *actor_new_ptr);
 
   template <class ActorT>
@@ -104,6 +105,9 @@ class ActorInfo final
   void finish_run();
 
   vector<Event> mailbox_;
+  // events sent by the destination scheduler while the actor is migrating to it;
+  // both vectors are kept with the pooled ActorInfo, so their memory is reused by subsequent actors
+  vector<Event> pending_mailbox_;
 
   bool need_context() const;
   bool need_start_up() const;
@@ -112,16 +116,30 @@ class ActorInfo final
   bool must_wait(uint32 wait_generation) const;
   void always_wait_for_mailbox();
 
+  void allow_stealing();
+  bool is_stealing_allowed() const;
+
+  // must be called only if statistics collection is enabled
+  ActorStats *get_stats();
+
+  double get_mailbox_since() const;
+  void set_mailbox_since(double mailbox_since);
+
  private:
   Deleter deleter_ = Deleter::None;
   bool need_context_ = true;
   bool need_start_up_ = true;
   bool is_running_ = false;
   bool always_wait_for_mailbox_{false};
+  bool is_stealing_allowed_{false};
   uint32 wait_generation_{0};
 
   std::atomic<int32> sched_id_{0};
   Actor *actor_ = nullptr;
+  ActorStats *(*get_stats_)() = nullptr;
+  ActorStats *stats_ = nullptr;
+  // time when the first event was added to the empty mailbox, or 0 if unknown
+  double mailbox_since_ = 0;
 
 #ifdef TD_DEBUG
   string name_;
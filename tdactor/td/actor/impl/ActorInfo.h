@@ -31,7 +31,7 @@ inline StringBuilder &operator<<(StringBuilder &sb, const ActorInfo &info) {
 }
 
 inline void ActorInfo::init(int32 sched_id, Slice name, ObjectPool<ActorInfo>::OwnerPtr &&this_ptr, Actor *actor_ptr,
-                            Deleter deleter, bool need_context, bool need_start_up) {
+                            Deleter deleter, bool need_context, bool need_start_up, ActorStats *(*get_stats)()) {
   CHECK(!is_running());
   CHECK(!is_migrating());
   sched_id_.store(sched_id, std::memory_order_relaxed);
@@ -50,7 +50,11 @@ inline void ActorInfo::init(int32 sched_id, Slice name, ObjectPool<ActorInfo>::O
   need_context_ = need_context;
   need_start_up_ = need_start_up;
   is_running_ = false;
+  is_stealing_allowed_ = false;
   wait_generation_ = 0;
+  get_stats_ = get_stats;
+  stats_ = nullptr;
+  mailbox_since_ = 0;
 }
 
 inline bool ActorInfo::need_context() const {
@@ -73,6 +77,14 @@ inline void ActorInfo::always_wait_for_mailbox() {
   always_wait_for_mailbox_ = true;
 }
 
+inline void ActorInfo::allow_stealing() {
+  is_stealing_allowed_ = true;
+}
+
+inline bool ActorInfo::is_stealing_allowed() const {
+  return is_stealing_allowed_;
+}
+
 inline void ActorInfo::on_actor_moved(Actor *actor_new_ptr) {
   actor_ = actor_new_ptr;
 }
@@ -102,6 +114,7 @@ inline void ActorInfo::destroy_actor() {
   }
   actor_ = nullptr;
   mailbox_.clear();
+  pending_mailbox_.clear();
 }
 
 template <class ActorT>
@@ -184,6 +197,21 @@ inline CSlice ActorInfo::get_name() const {
 #endif
 }
 
+inline ActorStats *ActorInfo::get_stats() {
+  if (stats_ == nullptr) {
+    stats_ = get_stats_();
+  }
+  return stats_;
+}
+
+inline double ActorInfo::get_mailbox_since() const {
+  return mailbox_since_;
+}
+
+inline void ActorInfo::set_mailbox_since(double mailbox_since) {
+  mailbox_since_ = mailbox_since;
+}
+
 inline void ActorInfo::start_run() {
   VLOG(actor) << "Start run actor: " << *this;
   LOG_CHECK(!is_running_) << "Recursive call of actor " << get_name();
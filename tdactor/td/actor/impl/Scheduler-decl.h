@@ -22,9 +22,11 @@
 #include "td/utils/port/PollFlags.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/Slice.h"
+#include "td/utils/StealingQueue.h"
 #include "td/utils/Time.h"
 #include "td/utils/type_traits.h"
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <type_traits>
@@ -36,6 +38,7 @@ namespace td {
 extern int VERBOSITY_NAME(actor);
 
 class ActorInfo;
+class ActorStats;
 
 enum class ActorSendType { Immediate, Later, LaterWeak };
 
@@ -69,6 +72,14 @@ class Scheduler {
     virtual void on_finish() = 0;
     virtual void register_at_finish(std::function<void()>) = 0;
   };
+
+  // actors, which allowed stealing and are ready to run, are offered to idle schedulers through this queue
+  struct WorkStealingQueue {
+    StealingQueue<ActorInfo *> actors;
+    std::atomic<int32> request_count{0};
+    std::atomic<bool> is_sleeping{false};
+  };
+
   Scheduler() = default;
   Scheduler(const Scheduler &) = delete;
   Scheduler &operator=(const Scheduler &) = delete;
@@ -77,7 +88,14 @@ class Scheduler {
   ~Scheduler();
 
   void init();
+  // numbers of event batches and events sent to another scheduler, can be read from any thread
+  struct OutboundStatistics {
+    std::atomic<uint64> batch_count{0};
+    std::atomic<uint64> event_count{0};
+  };
+
   void init(int32 id, std::vector<std::shared_ptr<MpscPollableQueue<EventFull>>> outbound, Callback *callback);
+  void init_work_stealing(std::vector<std::shared_ptr<WorkStealingQueue>> stealing_queues);
   void clear();
 
   int32 sched_id() const;
@@ -109,6 +127,17 @@ class Scheduler {
 
   void before_tail_send(const ActorId<> &actor_id);
 
+  double get_average_outbound_batch_size(int32 sched_id) const;
+
+  // returns total time spent by the scheduler not waiting for new events, in seconds; can be called from any thread
+  // the time is collected only if enabled by set_collect_busy_time or while actor statistics are enabled
+  double get_busy_time() const;
+
+  // must be called before the scheduler is run in a thread
+  void set_collect_busy_time(bool collect_busy_time) {
+    collect_busy_time_ = collect_busy_time;
+  }
+
   static void subscribe(PollableFd fd, PollFlags flags = PollFlags::ReadWrite());
   static void unsubscribe(PollableFdRef fd);
   static void unsubscribe_before_close(PollableFdRef fd);
@@ -188,12 +217,21 @@ class Scheduler {
   template <ActorSendType send_type, class RunFuncT, class EventFuncT>
   void send_impl(const ActorId<> &actor_id, const RunFuncT &run_func, const EventFuncT &event_func);
 
+  void flush_outbound_events();
+  void flush_outbound_events(int32 sched_id);
+
+  void offer_actors(ListNode &actors_list);
+  void try_steal_actors();
+  void request_actor(ActorInfo *actor_info);
+  void on_actor_requested(ActorInfo *actor_info, int32 dest_sched_id);
+
   void inc_wait_generation();
 
   Timestamp run_timeout();
   void run_mailbox();
   Timestamp run_events(Timestamp timeout);
   void run_poll(Timestamp timeout);
+  void add_busy_time(double busy_time);
 
   template <class ActorT>
   ActorOwn<ActorT> register_actor_impl(Slice name, ActorT *actor_ptr, Actor::Deleter deleter, int32 sched_id);
@@ -210,8 +248,6 @@ class Scheduler {
   ListNode ready_actors_list_;
   KHeap<double> timeout_queue_;
 
-  std::unordered_map<ActorInfo *, std::vector<Event>> pending_events_;
-
   ServiceActor service_actor_;
   Poll poll_;
 
@@ -225,6 +261,21 @@ class Scheduler {
   std::shared_ptr<MpscPollableQueue<EventFull>> inbound_queue_;
   std::vector<std::shared_ptr<MpscPollableQueue<EventFull>>> outbound_queues_;
 
+  // events to other schedulers are sent in batches after each pass over ready actors
+  bool is_batching_outbound_events_ = false;
+  bool has_outbound_events_ = false;
+  std::vector<std::vector<EventFull>> outbound_events_;
+  std::vector<OutboundStatistics> outbound_statistics_;
+
+  std::atomic<uint64> busy_time_ns_{0};
+  bool collect_busy_time_ = false;
+
+  std::shared_ptr<WorkStealingQueue> stealing_queue_;
+  std::vector<std::shared_ptr<WorkStealingQueue>> stealing_queues_;
+  size_t next_victim_pos_ = 0;
+
+  ActorStats *poll_stats_ = nullptr;
+
   std::shared_ptr<ActorContext> save_context_;
 
   struct EventContext {
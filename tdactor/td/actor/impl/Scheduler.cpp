@@ -6,6 +6,7 @@
 //
 #include "td/actor/impl/Scheduler.h"
 
+#include "td/actor/ActorStats.h"
 #include "td/actor/impl/Actor.h"
 #include "td/actor/impl/ActorId.h"
 #include "td/actor/impl/ActorInfo.h"
@@ -22,11 +23,13 @@
 #include "td/utils/ObjectPool.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/ScopeGuard.h"
+#include "td/utils/SliceBuilder.h"
 #include "td/utils/Time.h"
 
 #include <functional>
 #include <iterator>
 #include <memory>
+#include <tuple>
 #include <utility>
 
 namespace td {
@@ -87,13 +90,20 @@ void Scheduler::ServiceActor::loop() {
     if (event.actor_id().empty()) {
       if (event.data().empty()) {
         yield_scheduler();
+      } else if (event.data().type == Event::Type::Custom) {
+        event.data().data.custom_event->run(nullptr);
       } else {
         Scheduler::instance()->register_migrated_actor(static_cast<ActorInfo *>(event.data().data.ptr));
       }
     } else {
       VLOG(actor) << "Receive " << event.data();
       finish_migrate(event.data());
-      event.try_emit();
+      if (Scheduler::instance()->stealing_queue_ != nullptr) {
+        // the event must be added to the mailbox, so the actor can be offered to idle schedulers
+        event.try_emit_later();
+      } else {
+        event.try_emit();
+      }
     }
   }
   queue->reader_flush();
@@ -226,10 +236,20 @@ void Scheduler::init(int32 id, std::vector<std::shared_ptr<MpscPollableQueue<Eve
   outbound_queues_ = std::move(outbound);
   sched_id_ = id;
   sched_n_ = static_cast<int32>(outbound_queues_.size());
+  outbound_events_.resize(sched_n_);
+  outbound_statistics_ = std::vector<OutboundStatistics>(sched_n_);
+  poll_stats_ = ActorStats::get(PSLICE() << "<poll " << sched_id_ << '>');
   service_actor_.set_queue(inbound_queue_);
   register_actor("ServiceActor", &service_actor_).release();
 }
 
+void Scheduler::init_work_stealing(std::vector<std::shared_ptr<WorkStealingQueue>> stealing_queues) {
+  CHECK(0 <= sched_id_ && sched_id_ < static_cast<int32>(stealing_queues.size()));
+  stealing_queue_ = stealing_queues[sched_id_];
+  stealing_queues_ = std::move(stealing_queues);
+  next_victim_pos_ = static_cast<size_t>(sched_id_ + 1) % stealing_queues_.size();
+}
+
 void Scheduler::clear() {
   if (service_actor_.empty()) {
     return;
@@ -310,11 +330,11 @@ void Scheduler::register_migrated_actor(ActorInfo *actor_info) {
   for (auto &event : actor_info->mailbox_) {
     finish_migrate(event);
   }
-  auto it = pending_events_.find(actor_info);
-  if (it != pending_events_.end()) {
-    actor_info->mailbox_.insert(actor_info->mailbox_.end(), std::make_move_iterator(it->second.begin()),
-                                std::make_move_iterator(it->second.end()));
-    pending_events_.erase(it);
+  auto &pending_mailbox = actor_info->pending_mailbox_;
+  if (!pending_mailbox.empty()) {
+    actor_info->mailbox_.insert(actor_info->mailbox_.end(), std::make_move_iterator(pending_mailbox.begin()),
+                                std::make_move_iterator(pending_mailbox.end()));
+    pending_mailbox.clear();
   }
   if (actor_info->mailbox_.empty()) {
     pending_actors_list_.put(actor_info->get_list_node());
@@ -333,9 +353,51 @@ void Scheduler::send_to_other_scheduler(int32 sched_id, const ActorId<> &actor_i
       VLOG(actor) << "Send to scheduler " << sched_id << ": " << event;
     }
     start_migrate(event, sched_id);
+    if (is_batching_outbound_events_) {
+      outbound_events_[sched_id].push_back(EventCreator::event_unsafe(actor_id, std::move(event)));
+      has_outbound_events_ = true;
+      return;
+    }
     outbound_queues_[sched_id]->writer_put(EventCreator::event_unsafe(actor_id, std::move(event)));
     outbound_queues_[sched_id]->writer_flush();
+    auto &statistics = outbound_statistics_[sched_id];
+    statistics.batch_count.fetch_add(1, std::memory_order_relaxed);
+    statistics.event_count.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Scheduler::flush_outbound_events() {
+  if (!has_outbound_events_) {
+    return;
+  }
+  has_outbound_events_ = false;
+  for (int32 sched_id = 0; sched_id < sched_n_; sched_id++) {
+    flush_outbound_events(sched_id);
+  }
+}
+
+void Scheduler::flush_outbound_events(int32 sched_id) {
+  auto &events = outbound_events_[sched_id];
+  if (events.empty()) {
+    return;
   }
+  VLOG(actor) << "Send " << events.size() << " events to scheduler " << sched_id;
+  auto &statistics = outbound_statistics_[sched_id];
+  statistics.batch_count.fetch_add(1, std::memory_order_relaxed);
+  statistics.event_count.fetch_add(events.size(), std::memory_order_relaxed);
+  outbound_queues_[sched_id]->writer_put_batch(events);
+  outbound_queues_[sched_id]->writer_flush();
+}
+
+double Scheduler::get_average_outbound_batch_size(int32 sched_id) const {
+  CHECK(0 <= sched_id && sched_id < sched_n_);
+  auto &statistics = outbound_statistics_[sched_id];
+  auto batch_count = statistics.batch_count.load(std::memory_order_relaxed);
+  if (batch_count == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(statistics.event_count.load(std::memory_order_relaxed)) /
+         static_cast<double>(batch_count);
 }
 
 void Scheduler::add_to_mailbox(ActorInfo *actor_info, Event &&event) {
@@ -345,6 +407,9 @@ void Scheduler::add_to_mailbox(ActorInfo *actor_info, Event &&event) {
     ready_actors_list_.put(node);
   }
   VLOG(actor) << "Add to mailbox: " << *actor_info << " " << event;
+  if (actor_info->mailbox_.empty() && ActorStats::is_enabled()) {
+    actor_info->set_mailbox_since(Time::now());
+  }
   actor_info->mailbox_.push_back(std::move(event));
 }
 
@@ -442,6 +507,8 @@ void Scheduler::set_actor_timeout_at(ActorInfo *actor_info, double timeout_at) {
 void Scheduler::run_poll(Timestamp timeout) {
   // we can't wait for less than 1ms
   auto timeout_ms = static_cast<int>(clamp(timeout.in(), 0.0, 1000000.0) * 1000 + 1);
+  auto *stats = ActorStats::is_enabled() ? poll_stats_ : nullptr;
+  double poll_start_time = stats != nullptr ? Time::now() : 0.0;
 #if TD_PORT_WINDOWS
   CHECK(inbound_queue_);
   inbound_queue_->reader_get_event_fd().wait(timeout_ms);
@@ -449,17 +516,114 @@ void Scheduler::run_poll(Timestamp timeout) {
 #elif TD_PORT_POSIX
   poll_.run(timeout_ms);
 #endif
+  if (stats != nullptr) {
+    stats->on_event(Time::now() - poll_start_time);
+  }
+}
+
+void Scheduler::offer_actors(ListNode &actors_list) {
+  // offers from the previous run are outdated, but the queue can also contain actors stolen from other schedulers
+  ActorInfo *actor_info;
+  while (stealing_queue_->actors.local_pop(actor_info)) {
+    request_actor(actor_info);
+  }
+
+  // actors are run starting from the list end, so the actor, which will be run first, isn't offered
+  bool has_offers = false;
+  for (ListNode *it = actors_list.begin(); it != actors_list.get_prev(); it = it->get_next()) {
+    actor_info = ActorInfo::from_list_node(it);
+    if (actor_info->is_stealing_allowed()) {
+      stealing_queue_->actors.local_push(actor_info, [](ActorInfo *) {});
+      has_offers = true;
+    }
+  }
+  if (!has_offers) {
+    return;
+  }
+
+  for (size_t i = 0; i < stealing_queues_.size(); i++) {
+    bool is_sleeping = true;
+    if (stealing_queues_[i] != stealing_queue_ &&
+        stealing_queues_[i]->is_sleeping.compare_exchange_strong(is_sleeping, false, std::memory_order_relaxed)) {
+      VLOG(actor) << "Wake up scheduler " << i << " to steal actors";
+      outbound_queues_[i]->writer_put({});
+      break;
+    }
+  }
+}
+
+void Scheduler::try_steal_actors() {
+  ActorInfo *actor_info;
+  while (stealing_queue_->actors.local_pop(actor_info)) {
+    request_actor(actor_info);
+  }
+
+  for (size_t i = 0; i < stealing_queues_.size(); i++) {
+    auto &victim_queue = stealing_queues_[next_victim_pos_];
+    next_victim_pos_ = (next_victim_pos_ + 1) % stealing_queues_.size();
+    if (victim_queue == stealing_queue_) {
+      continue;
+    }
+    if (stealing_queue_->actors.steal(actor_info, victim_queue->actors)) {
+      do {
+        request_actor(actor_info);
+      } while (stealing_queue_->actors.local_pop(actor_info));
+      return;
+    }
+  }
+}
+
+void Scheduler::request_actor(ActorInfo *actor_info) {
+  // ActorInfo is never freed before scheduler destruction, but can belong to any scheduler at this point,
+  // so the owner scheduler checks whether the actor still can be stolen
+  int32 actor_sched_id;
+  bool is_migrating;
+  std::tie(actor_sched_id, is_migrating) = actor_info->migrate_dest_flag_atomic();
+  if (is_migrating || actor_sched_id == sched_id_ || actor_sched_id >= static_cast<int32>(stealing_queues_.size())) {
+    return;
+  }
+
+  VLOG(actor) << "Request actor " << actor_info << " from scheduler " << actor_sched_id;
+  send_to_other_scheduler(actor_sched_id, ActorId<>(), Event::lambda([actor_info, dest_sched_id = sched_id_] {
+                            Scheduler::instance()->on_actor_requested(actor_info, dest_sched_id);
+                          }));
+  stealing_queues_[actor_sched_id]->request_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Scheduler::on_actor_requested(ActorInfo *actor_info, int32 dest_sched_id) {
+  stealing_queue_->request_count.fetch_sub(1, std::memory_order_relaxed);
+
+  int32 actor_sched_id;
+  bool is_migrating;
+  std::tie(actor_sched_id, is_migrating) = actor_info->migrate_dest_flag_atomic();
+  if (is_migrating || actor_sched_id != sched_id_ || close_flag_ || actor_info->empty() ||
+      !actor_info->is_stealing_allowed() || actor_info->is_running() || actor_info->mailbox_.empty() ||
+      actor_info->get_heap_node()->in_heap()) {
+    // the actor has already been run, or it can't be moved now
+    return;
+  }
+
+  VLOG(actor) << "Actor " << *actor_info << " is stolen by scheduler " << dest_sched_id;
+  do_migrate_actor(actor_info, dest_sched_id);
+  flush_outbound_events(dest_sched_id);
 }
 
 void Scheduler::run_mailbox() {
   VLOG(actor) << "Run mailbox : begin";
   ListNode actors_list = std::move(ready_actors_list_);
+  if (stealing_queue_ != nullptr) {
+    offer_actors(actors_list);
+  }
   while (!actors_list.empty()) {
     ListNode *node = actors_list.get();
     CHECK(node);
     auto actor_info = ActorInfo::from_list_node(node);
     inc_wait_generation();
     flush_mailbox(actor_info, static_cast<void (*)(ActorInfo *)>(nullptr), static_cast<Event (*)()>(nullptr));
+    if (stealing_queue_ != nullptr && stealing_queue_->request_count.load(std::memory_order_relaxed) > 0) {
+      // give the requested actors away before they are run by this scheduler
+      send<ActorSendType::Immediate>(service_actor_.actor_id(), Event::yield());
+    }
   }
   VLOG(actor) << "Run mailbox : finish " << actor_count_;
 
@@ -495,12 +659,14 @@ Timestamp Scheduler::run_timeout() {
 
 Timestamp Scheduler::run_events(Timestamp timeout) {
   Timestamp res;
-  VLOG(actor) << "Run events " << sched_id_ << " " << tag("pending", pending_events_.size())
-              << tag("actors", actor_count_);
+  VLOG(actor) << "Run events " << sched_id_ << " " << tag("actors", actor_count_);
+  is_batching_outbound_events_ = true;
   do {
     run_mailbox();
     res = run_timeout();
+    flush_outbound_events();
   } while (!ready_actors_list_.empty() && !timeout.is_in_past());
+  is_batching_outbound_events_ = false;
   return res;
 }
 
@@ -510,12 +676,48 @@ void Scheduler::run_no_guard(Timestamp timeout) {
     yield_flag_ = false;
   };
 
+  // the current time is requested only if busy time is needed, because the loop is run very often
+  bool need_busy_time = collect_busy_time_ || ActorStats::is_enabled();
+  double run_start_time = need_busy_time ? Time::now() : 0.0;
   timeout.relax(run_events(timeout));
   if (yield_flag_) {
+    if (need_busy_time) {
+      add_busy_time(Time::now() - run_start_time);
+    }
     return;
   }
+  if (stealing_queue_ != nullptr && ready_actors_list_.empty()) {
+    try_steal_actors();
+    stealing_queue_->is_sleeping.store(true, std::memory_order_relaxed);
+  }
+  if (need_busy_time) {
+    add_busy_time(Time::now() - run_start_time);
+  }
   run_poll(timeout);
+  if (stealing_queue_ != nullptr) {
+    stealing_queue_->is_sleeping.store(false, std::memory_order_relaxed);
+  }
+  double poll_finish_time = need_busy_time ? Time::now() : 0.0;
   run_events(timeout);
+  if (need_busy_time) {
+    auto run_finish_time = Time::now();
+    add_busy_time(run_finish_time - poll_finish_time);
+    if (ActorStats::is_enabled()) {
+      ActorStats::log_if_needed(run_finish_time);
+    }
+  }
+}
+
+void Scheduler::add_busy_time(double busy_time) {
+  if (busy_time > 0) {
+    // the value is changed only by the scheduler thread
+    busy_time_ns_.store(busy_time_ns_.load(std::memory_order_relaxed) + static_cast<uint64>(busy_time * 1e9),
+                        std::memory_order_relaxed);
+  }
+}
+
+double Scheduler::get_busy_time() const {
+  return static_cast<double>(busy_time_ns_.load(std::memory_order_relaxed)) * 1e-9;
 }
 
 Timestamp Scheduler::get_timeout() {
@@ -6,6 +6,7 @@
 //
 #pragma once
 
+#include "td/actor/ActorStats.h"
 #include "td/actor/impl/ActorInfo-decl.h"
 #include "td/actor/impl/Scheduler-decl.h"
 
@@ -104,7 +105,8 @@ ActorOwn<ActorT> Scheduler::register_actor_impl(Slice name, ActorT *actor_ptr, A
   auto weak_info = info.get_weak();
   auto actor_info = info.get();
   actor_info->init(sched_id_, name, std::move(info), static_cast<Actor *>(actor_ptr), deleter,
-                   ActorTraits<ActorT>::need_context, ActorTraits<ActorT>::need_start_up);
+                   ActorTraits<ActorT>::need_context, ActorTraits<ActorT>::need_start_up,
+                   &ActorStats::get_by_type<ActorT>);
   VLOG(actor) << "Create actor " << *actor_info << " (actor_count = " << actor_count_ << ')';
 
   ActorId<ActorT> actor_id = weak_info->actor_id(actor_ptr);
@@ -146,25 +148,43 @@ void Scheduler::flush_mailbox(ActorInfo *actor_info, const RunFuncT &run_func, c
   auto &mailbox = actor_info->mailbox_;
   size_t mailbox_size = mailbox.size();
   CHECK(mailbox_size != 0);
+  auto *stats = ActorStats::is_enabled() ? actor_info->get_stats() : nullptr;
+  double event_start_time = 0.0;
+  if (stats != nullptr) {
+    event_start_time = Time::now();
+    auto mailbox_since = actor_info->get_mailbox_since();
+    stats->on_run(mailbox_size, mailbox_since == 0 ? 0.0 : event_start_time - mailbox_since);
+  }
   EventGuard guard(this, actor_info);
   size_t i = 0;
   for (; i < mailbox_size && guard.can_run(); i++) {
     do_event(actor_info, std::move(mailbox[i]));
+    if (stats != nullptr) {
+      auto event_finish_time = Time::now();
+      stats->on_event(event_finish_time - event_start_time);
+      event_start_time = event_finish_time;
+    }
   }
   if (run_func) {
     if (guard.can_run()) {
       (*run_func)(actor_info);
+      if (stats != nullptr) {
+        stats->on_event(Time::now() - event_start_time);
+      }
     } else {
       mailbox.insert(mailbox.begin() + i, (*event_func)());
     }
   }
   mailbox.erase(mailbox.begin(), mailbox.begin() + i);
+  // the remaining events are waiting since now
+  actor_info->set_mailbox_since(stats != nullptr && !mailbox.empty() ? event_start_time : 0.0);
 }
 
 inline void Scheduler::send_to_scheduler(int32 sched_id, const ActorId<> &actor_id, Event &&event) {
   if (sched_id == sched_id_) {
+    // the actor is migrating to the current scheduler; the events will be moved to its mailbox after registration
     ActorInfo *actor_info = actor_id.get_actor_info();
-    pending_events_[actor_info].push_back(std::move(event));
+    actor_info->pending_mailbox_.push_back(std::move(event));
   } else {
     send_to_other_scheduler(sched_id, actor_id, std::move(event));
   }
@@ -195,8 +215,13 @@ void Scheduler::send_impl(const ActorId<> &actor_id, const RunFuncT &run_func, c
   if (likely(send_type == ActorSendType::Immediate && on_current_sched && !actor_info->is_running() &&
              !actor_info->must_wait(wait_generation_))) {  // run immediately
     if (likely(actor_info->mailbox_.empty())) {
+      auto *stats = ActorStats::is_enabled() ? actor_info->get_stats() : nullptr;
+      double event_start_time = stats != nullptr ? Time::now() : 0.0;
       EventGuard guard(this, actor_info);
       run_func(actor_info);
+      if (stats != nullptr) {
+        stats->on_event(Time::now() - event_start_time);
+      }
     } else {
       flush_mailbox(actor_info, &run_func, &event_func);
     }
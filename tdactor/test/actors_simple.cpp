@@ -5,6 +5,7 @@
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
 #include "td/actor/actor.h"
+#include "td/actor/ActorStats.h"
 #include "td/actor/ConcurrentScheduler.h"
 #include "td/actor/MultiPromise.h"
 #include "td/actor/PromiseFuture.h"
@@ -648,6 +649,126 @@ TEST(Actors, send_from_other_threads) {
   }
   scheduler.finish();
 }
+
+class BatchReceiver final : public td::Actor {
+ public:
+  BatchReceiver(td::ConcurrentScheduler *scheduler, int event_count)
+      : scheduler_(scheduler), event_count_(event_count) {
+  }
+  void on_event(int id) {
+    ASSERT_EQ(received_count_, id);
+    if (++received_count_ == event_count_) {
+      ASSERT_TRUE(scheduler_->get_average_event_batch_size(1, 2) > event_count_ - 1);
+      td::Scheduler::instance()->finish();
+      stop();
+    }
+  }
+
+ private:
+  td::ConcurrentScheduler *scheduler_;
+  int event_count_;
+  int received_count_ = 0;
+};
+
+class BatchSender final : public td::Actor {
+ public:
+  BatchSender(td::ActorId<BatchReceiver> receiver, int event_count) : receiver_(receiver), event_count_(event_count) {
+  }
+  void start_up() final {
+    for (int i = 0; i < event_count_; i++) {
+      td::send_closure(receiver_, &BatchReceiver::on_event, i);
+    }
+    stop();
+  }
+
+ private:
+  td::ActorId<BatchReceiver> receiver_;
+  int event_count_;
+};
+
+TEST(Actors, send_to_other_scheduler_batch) {
+  td::ConcurrentScheduler scheduler;
+  scheduler.init(2);
+  int event_count = 100;
+  auto receiver = scheduler.create_actor_unsafe<BatchReceiver>(2, "BatchReceiver", &scheduler, event_count).release();
+  scheduler.create_actor_unsafe<BatchSender>(1, "BatchSender", receiver, event_count).release();
+  scheduler.start();
+  while (scheduler.run_main(10)) {
+  }
+  scheduler.finish();
+}
+
+class BusyActor final : public td::Actor {
+ public:
+  void work(double duration) {
+    auto end_time = td::Time::now() + duration;
+    while (td::Time::now() < end_time) {
+      // busy wait
+    }
+  }
+};
+
+class StealingController;
+
+class StealableWorker final : public td::Actor {
+ public:
+  void start_up() final {
+    allow_stealing();
+  }
+  void run(td::ActorId<StealingController> controller);
+};
+
+class StealingController final : public td::Actor {
+ public:
+  StealingController(td::ActorId<BusyActor> busy_actor, td::vector<td::ActorId<StealableWorker>> workers)
+      : busy_actor_(busy_actor), workers_(std::move(workers)) {
+  }
+  void start_up() final {
+    // wait until other schedulers become idle
+    set_timeout_in(0.1);
+  }
+  void timeout_expired() final {
+    td::send_closure(busy_actor_, &BusyActor::work, 0.2);
+    for (auto &worker : workers_) {
+      td::send_closure(worker, &StealableWorker::run, actor_id(this));
+    }
+  }
+  void on_result(td::int32 sched_id) {
+    if (sched_id != 2) {
+      stolen_count_++;
+    }
+    if (++result_count_ == workers_.size()) {
+      ASSERT_TRUE(stolen_count_ > 0);
+      td::Scheduler::instance()->finish();
+      stop();
+    }
+  }
+
+ private:
+  td::ActorId<BusyActor> busy_actor_;
+  td::vector<td::ActorId<StealableWorker>> workers_;
+  size_t result_count_ = 0;
+  size_t stolen_count_ = 0;
+};
+
+void StealableWorker::run(td::ActorId<StealingController> controller) {
+  td::send_closure(controller, &StealingController::on_result, td::Scheduler::instance()->sched_id());
+}
+
+TEST(Actors, work_stealing) {
+  td::ConcurrentScheduler scheduler;
+  scheduler.init(3, true);
+  auto busy_actor = scheduler.create_actor_unsafe<BusyActor>(2, "BusyActor").release();
+  td::vector<td::ActorId<StealableWorker>> workers;
+  for (int i = 0; i < 10; i++) {
+    workers.push_back(scheduler.create_actor_unsafe<StealableWorker>(2, "StealableWorker").release());
+  }
+  scheduler.create_actor_unsafe<StealingController>(1, "StealingController", busy_actor, std::move(workers)).release();
+  scheduler.start();
+  while (scheduler.run_main(10)) {
+  }
+  scheduler.finish();
+}
 #endif
 
 class DelayedCall final : public td::Actor {
@@ -691,3 +812,74 @@ TEST(Actors, MultiPromiseSendClosureLater) {
   }
   scheduler.finish();
 }
+
+class StatsTestActor final : public td::Actor {
+ public:
+  void start_up() final {
+    for (int i = 0; i < 10; i++) {
+      td::send_closure_later(actor_id(this), &StatsTestActor::on_event);
+    }
+  }
+
+  void on_event() {
+    if (++event_count_ == 10) {
+      td::Scheduler::instance()->finish();
+    }
+  }
+
+ private:
+  int event_count_ = 0;
+};
+
+TEST(Actors, actor_stats) {
+  td::ActorStats::set_enabled(true, 0);
+  td::ConcurrentScheduler scheduler;
+  scheduler.init(0);
+  // statistics is attributed to the actor class instead of the actor name
+  scheduler.create_actor_unsafe<StatsTestActor>(0, "StatsTestActor 12345").release();
+  scheduler.start();
+  while (scheduler.run_main(10)) {
+  }
+  scheduler.finish();
+  td::ActorStats::set_enabled(false, 0);
+
+  bool is_found = false;
+  for (auto &data : td::ActorStats::get_all_data()) {
+    ASSERT_TRUE(data.name != "StatsTestActor 12345");
+    if (data.name == "StatsTestActor") {
+      is_found = true;
+      ASSERT_TRUE(data.run_count >= 1);
+      ASSERT_TRUE(data.max_mailbox_size >= 10);
+      ASSERT_EQ(11u, data.event_count);
+      td::uint64 histogram_event_count = 0;
+      for (auto count : data.execution_time_histogram) {
+        histogram_event_count += count;
+      }
+      ASSERT_EQ(data.event_count, histogram_event_count);
+    }
+  }
+  ASSERT_TRUE(is_found);
+}
+
+class SpinningActor final : public td::Actor {
+ public:
+  void start_up() final {
+    auto end_time = td::Time::now() + 0.05;
+    while (td::Time::now() < end_time) {
+      // spin
+    }
+    td::Scheduler::instance()->finish();
+  }
+};
+
+TEST(Actors, scheduler_busy_time) {
+  td::ConcurrentScheduler scheduler;
+  scheduler.init(0);
+  scheduler.set_collect_busy_time(true);
+  scheduler.create_actor_unsafe<SpinningActor>(0, "SpinningActor").release();
+  scheduler.start();
+  while (scheduler.run_main(10)) {
+  }
+  ASSERT_TRUE(scheduler.get_busy_time(0) >= 0.05);
+  scheduler.finish();
+}
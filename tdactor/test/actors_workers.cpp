@@ -24,6 +24,9 @@ class PowerWorker final : public td::Actor {
     virtual void on_ready(int query, int res) = 0;
     virtual void on_closed() = 0;
   };
+  void start_up() final {
+    allow_stealing();
+  }
   void set_callback(td::unique_ptr<Callback> callback) {
     callback_ = std::move(callback);
   }
@@ -105,13 +108,14 @@ class Manager final : public td::Actor {
   int query_size_;
 };
 
-static void test_workers(int threads_n, int workers_n, int queries_n, int query_size) {
+static void test_workers(int threads_n, int workers_n, int queries_n, int query_size, bool use_work_stealing = false) {
   td::ConcurrentScheduler sched;
-  sched.init(threads_n);
+  sched.init(threads_n, use_work_stealing);
 
   td::vector<td::ActorId<PowerWorker>> workers;
   for (int i = 0; i < workers_n; i++) {
-    int thread_id = threads_n ? i % (threads_n - 1) + 2 : 0;
+    // with work stealing all workers are created on the same scheduler and other schedulers must steal them
+    int thread_id = threads_n ? (use_work_stealing ? 2 : i % (threads_n - 1) + 2) : 0;
     workers.push_back(sched.create_actor_unsafe<PowerWorker>(thread_id, PSLICE() << "worker" << i).release());
   }
   sched.create_actor_unsafe<Manager>(threads_n ? 1 : 0, "Manager", queries_n, query_size, std::move(workers)).release();
@@ -148,3 +152,11 @@ TEST(Actors, workers_small_query_two_threads) {
 TEST(Actors, workers_small_query_nine_threads) {
   test_workers(9, 10, 1000000, 1);
 }
+
+TEST(Actors, workers_big_query_work_stealing) {
+  test_workers(3, 10, 1000, 300000, true);
+}
+
+TEST(Actors, workers_small_query_work_stealing) {
+  test_workers(3, 10, 100000, 1, true);
+}
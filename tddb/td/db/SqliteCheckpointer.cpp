@@ -0,0 +1,93 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2021
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/db/SqliteCheckpointer.h"
+
+#include "td/db/SqliteDb.h"
+#include "td/db/SqliteStatement.h"
+
+#include "td/utils/format.h"
+#include "td/utils/logging.h"
+#include "td/utils/Time.h"
+
+#include <chrono>
+
+namespace td {
+
+SqliteCheckpointer::SqliteCheckpointer(string path, DbKey key, optional<int32> cipher_version, double period)
+    : path_(std::move(path)), key_(std::move(key)), cipher_version_(std::move(cipher_version)), period_(period) {
+  thread_ = thread([this] { run(); });
+}
+
+SqliteCheckpointer::~SqliteCheckpointer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopped_ = true;
+  }
+  stop_condition_.notify_all();
+  thread_.join();
+}
+
+SqliteCheckpointStatistics SqliteCheckpointer::get_statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statistics_;
+}
+
+void SqliteCheckpointer::run() {
+  auto r_db = SqliteDb::open_with_key(path_, false, key_, cipher_version_.copy());
+  if (r_db.is_error()) {
+    LOG(ERROR) << "Can't open database " << tag("path", path_) << " for checkpoints: " << r_db.error();
+    return;
+  }
+  auto db = r_db.move_as_ok();
+  auto r_stmt = db.get_statement("PRAGMA wal_checkpoint(PASSIVE)");
+  if (r_stmt.is_error()) {
+    LOG(ERROR) << "Can't prepare checkpoint statement: " << r_stmt.error();
+    return;
+  }
+  auto stmt = r_stmt.move_as_ok();
+
+  auto period = std::chrono::microseconds(static_cast<int64>(period_ * 1e6));
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (stop_condition_.wait_for(lock, period, [&] { return is_stopped_; })) {
+        break;
+      }
+    }
+
+    auto start_time = Time::now();
+    auto status = stmt.step();
+    int32 wal_frame_count = 0;
+    int32 checkpointed_frame_count = 0;
+    if (status.is_ok() && stmt.has_row()) {
+      wal_frame_count = stmt.view_int32(1);
+      checkpointed_frame_count = stmt.view_int32(2);
+    }
+    stmt.reset();
+    auto checkpoint_time = Time::now() - start_time;
+    if (status.is_error()) {
+      LOG(WARNING) << "Failed to checkpoint database " << tag("path", path_) << ": " << status;
+      continue;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    statistics_.checkpoint_count++;
+    if (checkpointed_frame_count < wal_frame_count) {
+      statistics_.incomplete_checkpoint_count++;
+    }
+    statistics_.last_wal_frame_count = wal_frame_count;
+    if (wal_frame_count > statistics_.max_wal_frame_count) {
+      statistics_.max_wal_frame_count = wal_frame_count;
+    }
+    statistics_.total_checkpoint_time += checkpoint_time;
+    if (checkpoint_time > statistics_.max_checkpoint_time) {
+      statistics_.max_checkpoint_time = checkpoint_time;
+    }
+  }
+}
+
+}  // namespace td
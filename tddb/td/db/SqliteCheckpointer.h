@@ -0,0 +1,62 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2021
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/db/DbKey.h"
+
+#include "td/utils/common.h"
+#include "td/utils/optional.h"
+#include "td/utils/port/thread.h"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace td {
+
+struct SqliteCheckpointStatistics {
+  uint64 checkpoint_count{0};
+  // checkpoints, which couldn't copy all WAL frames to the database because of concurrent readers or writers
+  uint64 incomplete_checkpoint_count{0};
+  int32 last_wal_frame_count{0};
+  int32 max_wal_frame_count{0};
+  double total_checkpoint_time{0.0};
+  double max_checkpoint_time{0.0};
+};
+
+// Periodically checkpoints WAL of a database in a separate thread through its own connection,
+// so connections with disabled automatic checkpoints never wait for them while committing a transaction
+// Checkpoints are passive, so they never block readers and writers
+class SqliteCheckpointer {
+ public:
+  // the database must already exist
+  SqliteCheckpointer(string path, DbKey key, optional<int32> cipher_version, double period);
+  SqliteCheckpointer(const SqliteCheckpointer &) = delete;
+  SqliteCheckpointer &operator=(const SqliteCheckpointer &) = delete;
+  SqliteCheckpointer(SqliteCheckpointer &&) = delete;
+  SqliteCheckpointer &operator=(SqliteCheckpointer &&) = delete;
+  ~SqliteCheckpointer();
+
+  // can be called from any thread
+  SqliteCheckpointStatistics get_statistics() const;
+
+ private:
+  string path_;
+  DbKey key_;
+  optional<int32> cipher_version_;
+  double period_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable stop_condition_;
+  bool is_stopped_ = false;
+  SqliteCheckpointStatistics statistics_;
+
+  thread thread_;
+
+  void run();
+};
+
+}  // namespace td
@@ -12,16 +12,19 @@
 
 namespace td {
 
-SqliteConnectionSafe::SqliteConnectionSafe(string path, DbKey key, optional<int32> cipher_version)
+SqliteConnectionSafe::SqliteConnectionSafe(string path, DbKey key, optional<int32> cipher_version,
+                                           SqliteProfile profile)
     : path_(std::move(path))
-    , lsls_connection_([path = path_, key = std::move(key), cipher_version = std::move(cipher_version)] {
+    , key_(key)
+    , cipher_version_(cipher_version.copy())
+    , profile_(profile)
+    , lsls_connection_([path = path_, key = std::move(key), cipher_version = std::move(cipher_version), profile] {
       auto r_db = SqliteDb::open_with_key(path, false, key, cipher_version.copy());
       if (r_db.is_error()) {
         LOG(FATAL) << "Can't open database: " << r_db.error().message();
       }
       auto db = r_db.move_as_ok();
-      db.exec("PRAGMA journal_mode=WAL").ensure();
-      db.exec("PRAGMA secure_delete=1").ensure();
+      init_sqlite_connection(db, profile).ensure();
       return db;
     }) {
 }
@@ -34,8 +37,32 @@ SqliteDb &SqliteConnectionSafe::get() {
   return lsls_connection_.get();
 }
 
+Result<SqliteDb> SqliteConnectionSafe::open_read_only_connection() const {
+  TRY_RESULT(db, SqliteDb::open_with_key(path_, false, key_, cipher_version_.copy()));
+  // the database is already in WAL mode, so readers aren't blocked by the writer
+  TRY_STATUS(init_sqlite_connection(db, profile_));
+  TRY_STATUS(db.exec("PRAGMA query_only=1"));
+  return std::move(db);
+}
+
+void SqliteConnectionSafe::start_background_checkpoints(double period) {
+  if (!need_background_checkpoints(profile_) || checkpointer_ != nullptr) {
+    return;
+  }
+  LOG(INFO) << "Start background checkpoints of SQLite database " << tag("path", path_);
+  checkpointer_ = td::make_unique<SqliteCheckpointer>(path_, key_, cipher_version_.copy(), period);
+}
+
+SqliteCheckpointStatistics SqliteConnectionSafe::get_checkpoint_statistics() const {
+  if (checkpointer_ == nullptr) {
+    return SqliteCheckpointStatistics();
+  }
+  return checkpointer_->get_statistics();
+}
+
 void SqliteConnectionSafe::close() {
   LOG(INFO) << "Close SQLite database " << tag("path", path_);
+  checkpointer_ = nullptr;
   lsls_connection_.clear_values();
 }
 
@@ -7,30 +7,51 @@
 #pragma once
 
 #include "td/db/DbKey.h"
+#include "td/db/SqliteCheckpointer.h"
 #include "td/db/SqliteDb.h"
+#include "td/db/SqliteProfile.h"
 
 #include "td/actor/SchedulerLocalStorage.h"
 
 #include "td/utils/common.h"
 #include "td/utils/optional.h"
+#include "td/utils/Status.h"
 
 namespace td {
 
 class SqliteConnectionSafe {
  public:
   SqliteConnectionSafe() = default;
-  SqliteConnectionSafe(string path, DbKey key, optional<int32> cipher_version = {});
+  SqliteConnectionSafe(string path, DbKey key, optional<int32> cipher_version = {},
+                       SqliteProfile profile = SqliteProfile::Durable);
 
   SqliteDb &get();
   void set(SqliteDb &&db);
 
+  // opens a new connection, which can be used only for reading; can be called from any thread
+  Result<SqliteDb> open_read_only_connection() const;
+
+  SqliteProfile get_profile() const {
+    return profile_;
+  }
+
+  // starts WAL checkpoints in a separate thread, if the profile needs them; the database must already exist
+  void start_background_checkpoints(double period);
+
+  // can be called from any thread, but not concurrently with close
+  SqliteCheckpointStatistics get_checkpoint_statistics() const;
+
   void close();
 
   void close_and_destroy();
 
  private:
   string path_;
+  DbKey key_;
+  optional<int32> cipher_version_;
+  SqliteProfile profile_ = SqliteProfile::Durable;
   LazySchedulerLocalStorage<SqliteDb> lsls_connection_;
+  unique_ptr<SqliteCheckpointer> checkpointer_;
 };
 
 }  // namespace td
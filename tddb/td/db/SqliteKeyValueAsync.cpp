@@ -11,17 +11,22 @@
 #include "td/actor/actor.h"
 
 #include "td/utils/common.h"
+#include "td/utils/List.h"
+#include "td/utils/misc.h"
 #include "td/utils/optional.h"
+#include "td/utils/Slice.h"
 #include "td/utils/Time.h"
 
+#include <atomic>
 #include <unordered_map>
 
 namespace td {
 
 class SqliteKeyValueAsync final : public SqliteKeyValueAsyncInterface {
  public:
-  explicit SqliteKeyValueAsync(std::shared_ptr<SqliteKeyValueSafe> kv_safe, int32 scheduler_id = -1) {
-    impl_ = create_actor_on_scheduler<Impl>("KV", scheduler_id, std::move(kv_safe));
+  SqliteKeyValueAsync(std::shared_ptr<SqliteKeyValueSafe> kv_safe, int32 scheduler_id, size_t max_cache_size)
+      : statistics_(std::make_shared<Statistics>()) {
+    impl_ = create_actor_on_scheduler<Impl>("KV", scheduler_id, std::move(kv_safe), statistics_, max_cache_size);
   }
   void set(string key, string value, Promise<> promise) final {
     send_closure_later(impl_, &Impl::set, std::move(key), std::move(value), std::move(promise));
@@ -39,15 +44,49 @@ class SqliteKeyValueAsync final : public SqliteKeyValueAsyncInterface {
     send_closure_later(impl_, &Impl::close, std::move(promise));
   }
 
+  SqliteKeyValueAsyncStatistics get_statistics() const final {
+    SqliteKeyValueAsyncStatistics result;
+    result.set_count = statistics_->set_count.load(std::memory_order_relaxed);
+    result.erase_count = statistics_->erase_count.load(std::memory_order_relaxed);
+    result.overwritten_count = statistics_->overwritten_count.load(std::memory_order_relaxed);
+    result.flush_count = statistics_->flush_count.load(std::memory_order_relaxed);
+    result.flushed_key_count = statistics_->flushed_key_count.load(std::memory_order_relaxed);
+    result.get_count = statistics_->get_count.load(std::memory_order_relaxed);
+    result.pending_hit_count = statistics_->pending_hit_count.load(std::memory_order_relaxed);
+    result.cache_hit_count = statistics_->cache_hit_count.load(std::memory_order_relaxed);
+    result.cache_miss_count = statistics_->cache_miss_count.load(std::memory_order_relaxed);
+    return result;
+  }
+
  private:
+  // all counters are changed only by the actor
+  struct Statistics {
+    std::atomic<uint64> set_count{0};
+    std::atomic<uint64> erase_count{0};
+    std::atomic<uint64> overwritten_count{0};
+    std::atomic<uint64> flush_count{0};
+    std::atomic<uint64> flushed_key_count{0};
+    std::atomic<uint64> get_count{0};
+    std::atomic<uint64> pending_hit_count{0};
+    std::atomic<uint64> cache_hit_count{0};
+    std::atomic<uint64> cache_miss_count{0};
+
+    static void add(std::atomic<uint64> &counter, uint64 value = 1) {
+      counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+  };
+
   class Impl final : public Actor {
    public:
-    explicit Impl(std::shared_ptr<SqliteKeyValueSafe> kv_safe) : kv_safe_(std::move(kv_safe)) {
+    Impl(std::shared_ptr<SqliteKeyValueSafe> kv_safe, std::shared_ptr<Statistics> statistics, size_t max_cache_size)
+        : kv_safe_(std::move(kv_safe)), statistics_(std::move(statistics)), max_cache_size_(max_cache_size) {
     }
 
     void set(string key, string value, Promise<> promise) {
+      Statistics::add(statistics_->set_count);
       auto it = buffer_.find(key);
       if (it != buffer_.end()) {
+        Statistics::add(statistics_->overwritten_count);
         it->second = std::move(value);
       } else {
         buffer_.emplace(std::move(key), std::move(value));
@@ -55,13 +94,14 @@ class SqliteKeyValueAsync final : public SqliteKeyValueAsyncInterface {
       if (promise) {
         buffer_promises_.push_back(std::move(promise));
       }
-      cnt_++;
       do_flush(false /*force*/);
     }
 
     void erase(string key, Promise<> promise) {
+      Statistics::add(statistics_->erase_count);
       auto it = buffer_.find(key);
       if (it != buffer_.end()) {
+        Statistics::add(statistics_->overwritten_count);
         it->second = optional<string>();
       } else {
         buffer_.emplace(std::move(key), optional<string>());
@@ -69,25 +109,37 @@ class SqliteKeyValueAsync final : public SqliteKeyValueAsyncInterface {
       if (promise) {
         buffer_promises_.push_back(std::move(promise));
       }
-      cnt_++;
       do_flush(false /*force*/);
     }
 
     void erase_by_prefix(string key_prefix, Promise<> promise) {
       do_flush(true /*force*/);
       kv_->erase_by_prefix(key_prefix);
+      erase_cached_values_by_prefix(key_prefix);
       promise.set_value(Unit());
     }
 
     void get(const string &key, Promise<string> promise) {
+      Statistics::add(statistics_->get_count);
       auto it = buffer_.find(key);
       if (it != buffer_.end()) {
+        Statistics::add(statistics_->pending_hit_count);
         return promise.set_value(it->second ? it->second.value() : "");
       }
-      promise.set_value(kv_->get(key));
+      auto cached_value = get_cached_value(key);
+      if (cached_value != nullptr) {
+        Statistics::add(statistics_->cache_hit_count);
+        return promise.set_value(string(*cached_value));
+      }
+      Statistics::add(statistics_->cache_miss_count);
+      auto value = kv_->get(key);
+      set_cached_value(key, value);
+      promise.set_value(std::move(value));
     }
     void close(Promise<> promise) {
       do_flush(true /*force*/);
+      cache_.clear();
+      cache_size_ = 0;
       kv_safe_.reset();
       kv_ = nullptr;
       stop();
@@ -97,12 +149,89 @@ class SqliteKeyValueAsync final : public SqliteKeyValueAsyncInterface {
    private:
     std::shared_ptr<SqliteKeyValueSafe> kv_safe_;
     SqliteKeyValue *kv_ = nullptr;
+    std::shared_ptr<Statistics> statistics_;
 
     static constexpr double MAX_PENDING_QUERIES_DELAY = 0.01;
     static constexpr size_t MAX_PENDING_QUERIES_COUNT = 100;
     std::unordered_map<string, optional<string>> buffer_;
     std::vector<Promise<>> buffer_promises_;
-    size_t cnt_ = 0;
+
+    // the cache contains values of keys, which are already stored in the database
+    struct CacheEntry final : private ListNode {
+      const string *key = nullptr;
+      string value;
+
+      ListNode *get_list_node() {
+        return static_cast<ListNode *>(this);
+      }
+      static CacheEntry *from_list_node(ListNode *list_node) {
+        return static_cast<CacheEntry *>(list_node);
+      }
+    };
+    static constexpr size_t CACHE_ENTRY_OVERHEAD = 64;
+    ListNode cache_list_;  // from the most recently used entry to the least recently used
+    std::unordered_map<string, CacheEntry> cache_;
+    size_t cache_size_ = 0;
+    size_t max_cache_size_ = 0;
+
+    static size_t get_cache_entry_size(Slice key, Slice value) {
+      return key.size() + value.size() + CACHE_ENTRY_OVERHEAD;
+    }
+
+    const string *get_cached_value(const string &key) {
+      auto it = cache_.find(key);
+      if (it == cache_.end()) {
+        return nullptr;
+      }
+      auto *list_node = it->second.get_list_node();
+      list_node->remove();
+      cache_list_.put(list_node);
+      return &it->second.value;
+    }
+
+    void set_cached_value(const string &key, Slice value) {
+      auto it = cache_.find(key);
+      if (get_cache_entry_size(key, value) > max_cache_size_ / 8) {
+        // big values would evict too much
+        if (it != cache_.end()) {
+          erase_cached_value(it);
+        }
+        return;
+      }
+
+      if (it == cache_.end()) {
+        it = cache_.emplace(key, CacheEntry()).first;
+        it->second.key = &it->first;
+      } else {
+        cache_size_ -= get_cache_entry_size(key, it->second.value);
+        it->second.get_list_node()->remove();
+      }
+      it->second.value = value.str();
+      cache_size_ += get_cache_entry_size(key, value);
+      cache_list_.put(it->second.get_list_node());
+
+      while (cache_size_ > max_cache_size_) {
+        auto *entry = CacheEntry::from_list_node(cache_list_.get());
+        CHECK(entry != nullptr);
+        erase_cached_value(cache_.find(*entry->key));
+      }
+    }
+
+    void erase_cached_value(std::unordered_map<string, CacheEntry>::iterator it) {
+      CHECK(it != cache_.end());
+      cache_size_ -= get_cache_entry_size(it->first, it->second.value);
+      cache_.erase(it);
+    }
+
+    void erase_cached_values_by_prefix(Slice key_prefix) {
+      for (auto it = cache_.begin(); it != cache_.end();) {
+        if (begins_with(it->first, key_prefix)) {
+          erase_cached_value(it++);
+        } else {
+          ++it;
+        }
+      }
+    }
 
     double wakeup_at_ = 0;
     void do_flush(bool force) {
@@ -115,14 +244,14 @@ class SqliteKeyValueAsync final : public SqliteKeyValueAsyncInterface {
         if (wakeup_at_ == 0) {
           wakeup_at_ = now + MAX_PENDING_QUERIES_DELAY;
         }
-        if (now < wakeup_at_ && cnt_ < MAX_PENDING_QUERIES_COUNT) {
+        // repeated writes to the same keys don't increase buffer size
+        if (now < wakeup_at_ && buffer_.size() < MAX_PENDING_QUERIES_COUNT) {
           set_timeout_at(wakeup_at_);
           return;
         }
       }
 
       wakeup_at_ = 0;
-      cnt_ = 0;
 
       kv_->begin_write_transaction().ensure();
       for (auto &it : buffer_) {
@@ -133,6 +262,15 @@ class SqliteKeyValueAsync final : public SqliteKeyValueAsyncInterface {
         }
       }
       kv_->commit_transaction().ensure();
+      Statistics::add(statistics_->flush_count);
+      Statistics::add(statistics_->flushed_key_count, buffer_.size());
+      for (auto &it : buffer_) {
+        if (it.second) {
+          set_cached_value(it.first, it.second.value());
+        } else {
+          set_cached_value(it.first, Slice());
+        }
+      }
       buffer_.clear();
       for (auto &promise : buffer_promises_) {
         promise.set_value(Unit());
@@ -148,12 +286,13 @@ class SqliteKeyValueAsync final : public SqliteKeyValueAsyncInterface {
       kv_ = &kv_safe_->get();
     }
   };
+  std::shared_ptr<Statistics> statistics_;
   ActorOwn<Impl> impl_;
 };
 
 unique_ptr<SqliteKeyValueAsyncInterface> create_sqlite_key_value_async(std::shared_ptr<SqliteKeyValueSafe> kv,
-                                                                       int32 scheduler_id) {
-  return td::make_unique<SqliteKeyValueAsync>(std::move(kv), scheduler_id);
+                                                                       int32 scheduler_id, size_t max_cache_size) {
+  return td::make_unique<SqliteKeyValueAsync>(std::move(kv), scheduler_id, max_cache_size);
 }
 
 }  // namespace td
@@ -14,6 +14,18 @@
 
 namespace td {
 
+struct SqliteKeyValueAsyncStatistics {
+  uint64 set_count = 0;
+  uint64 erase_count = 0;
+  uint64 overwritten_count = 0;  // writes, which were replaced by a later write to the same key before a flush
+  uint64 flush_count = 0;
+  uint64 flushed_key_count = 0;
+  uint64 get_count = 0;
+  uint64 pending_hit_count = 0;
+  uint64 cache_hit_count = 0;
+  uint64 cache_miss_count = 0;
+};
+
 class SqliteKeyValueAsyncInterface {
  public:
   virtual ~SqliteKeyValueAsyncInterface() = default;
@@ -24,8 +36,16 @@ class SqliteKeyValueAsyncInterface {
 
   virtual void get(string key, Promise<string> promise) = 0;
   virtual void close(Promise<> promise) = 0;
+
+  // can be called from any thread
+  virtual SqliteKeyValueAsyncStatistics get_statistics() const = 0;
 };
 
+// writes are buffered for a short time and are flushed in a single transaction; only the last write to a key is applied
+// values of the last read or written keys are cached and returned by get, so keys, which are read through the returned
+// object, must not be changed bypassing it; writes are always applied even if the cached value is the same
+// max_cache_size is the maximum total size of cached keys and values in bytes; cache is disabled if it is zero
 unique_ptr<SqliteKeyValueAsyncInterface> create_sqlite_key_value_async(std::shared_ptr<SqliteKeyValueSafe> kv,
-                                                                       int32 scheduler_id = 1);
+                                                                       int32 scheduler_id = 1,
+                                                                       size_t max_cache_size = 1 << 22);
 }  // namespace td
@@ -0,0 +1,81 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2021
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/db/SqliteProfile.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/port/config.h"
+#include "td/utils/SliceBuilder.h"
+
+namespace td {
+
+Result<SqliteProfile> get_sqlite_profile(Slice name) {
+  if (name == "durable") {
+    return SqliteProfile::Durable;
+  }
+  if (name == "balanced") {
+    return SqliteProfile::Balanced;
+  }
+  if (name == "throughput") {
+    return SqliteProfile::Throughput;
+  }
+  return Status::Error(PSLICE() << "Unsupported database profile \"" << name << '"');
+}
+
+Slice get_sqlite_profile_name(SqliteProfile profile) {
+  switch (profile) {
+    case SqliteProfile::Durable:
+      return Slice("durable");
+    case SqliteProfile::Balanced:
+      return Slice("balanced");
+    case SqliteProfile::Throughput:
+      return Slice("throughput");
+    default:
+      UNREACHABLE();
+      return Slice();
+  }
+}
+
+bool need_background_checkpoints(SqliteProfile profile) {
+#if TD_THREAD_UNSUPPORTED
+  return false;
+#else
+  return profile == SqliteProfile::Throughput;
+#endif
+}
+
+Status init_sqlite_connection(SqliteDb &db, SqliteProfile profile) {
+  TRY_STATUS(db.exec("PRAGMA journal_mode=WAL"));
+  switch (profile) {
+    case SqliteProfile::Durable:
+      TRY_STATUS(db.exec("PRAGMA secure_delete=1"));
+      break;
+    case SqliteProfile::Balanced:
+      TRY_STATUS(db.exec("PRAGMA secure_delete=FAST"));
+      TRY_STATUS(db.exec("PRAGMA synchronous=NORMAL"));
+      TRY_STATUS(db.exec("PRAGMA temp_store=MEMORY"));
+      TRY_STATUS(db.exec("PRAGMA cache_size=-8192"));
+      break;
+    case SqliteProfile::Throughput:
+      TRY_STATUS(db.exec("PRAGMA secure_delete=0"));
+      TRY_STATUS(db.exec("PRAGMA synchronous=NORMAL"));
+      TRY_STATUS(db.exec("PRAGMA temp_store=MEMORY"));
+      TRY_STATUS(db.exec("PRAGMA cache_size=-32768"));
+      // ignored for encrypted databases
+      TRY_STATUS(db.exec("PRAGMA mmap_size=268435456"));
+      // WAL file is truncated to this size, when it is reused after a checkpoint
+      TRY_STATUS(db.exec("PRAGMA journal_size_limit=67108864"));
+      if (need_background_checkpoints(profile)) {
+        TRY_STATUS(db.exec("PRAGMA wal_autocheckpoint=0"));
+      }
+      break;
+    default:
+      UNREACHABLE();
+  }
+  return Status::OK();
+}
+
+}  // namespace td
@@ -0,0 +1,36 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2021
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/db/SqliteDb.h"
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+
+namespace td {
+
+// Performance profile of all connections to a database
+// Durable: every transaction is synced and content of deleted rows is overwritten
+// Balanced: only WAL checkpoints are synced, so the last transactions can be lost after a power failure,
+//   content of deleted rows is overwritten only if this doesn't increase the amount of written data,
+//   bigger page cache is used and temporary tables are kept in memory
+// Throughput: content of deleted rows isn't overwritten, bigger page cache and memory mapping are used,
+//   and WAL checkpoints are done in the background by SqliteCheckpointer instead of committing connections
+enum class SqliteProfile : int32 { Durable, Balanced, Throughput };
+
+Result<SqliteProfile> get_sqlite_profile(Slice name) TD_WARN_UNUSED_RESULT;
+
+Slice get_sqlite_profile_name(SqliteProfile profile);
+
+// returns true, if WAL checkpoints must be done by SqliteCheckpointer
+bool need_background_checkpoints(SqliteProfile profile);
+
+// must be called for every new connection to the database
+Status init_sqlite_connection(SqliteDb &db, SqliteProfile profile) TD_WARN_UNUSED_RESULT;
+
+}  // namespace td
@@ -0,0 +1,112 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2021
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include "td/actor/actor.h"
+#include "td/actor/MultiPromise.h"
+#include "td/actor/PromiseFuture.h"
+
+#include "td/utils/common.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace td {
+
+// Runs read queries in parallel on several schedulers, each of which has its own read-only database connection
+// The owner must commit all writes, which need to be visible to a query, before the query is run
+template <class DbT>
+class SqliteReaderPool {
+ public:
+  using CreateDbFunc = std::function<unique_ptr<DbT>()>;
+
+  SqliteReaderPool() = default;
+  SqliteReaderPool(const vector<int32> &scheduler_ids, const CreateDbFunc &create_db) {
+    for (auto scheduler_id : scheduler_ids) {
+      ReaderInfo reader;
+      reader.query_count = std::make_shared<std::atomic<size_t>>(0);
+      reader.actor = create_actor_on_scheduler<Reader>("SqliteReader", scheduler_id, create_db, reader.query_count);
+      readers_.push_back(std::move(reader));
+    }
+  }
+
+  bool empty() const {
+    return readers_.empty();
+  }
+
+  // the query is run by the reader with the least number of pending queries
+  void run(Promise<DbT *> query) {
+    CHECK(!empty());
+    size_t best_pos = 0;
+    size_t best_query_count = 0;
+    for (size_t i = 0; i < readers_.size(); i++) {
+      auto pos = (next_reader_pos_ + i) % readers_.size();
+      auto query_count = readers_[pos].query_count->load(std::memory_order_relaxed);
+      if (i == 0 || query_count < best_query_count) {
+        best_pos = pos;
+        best_query_count = query_count;
+      }
+    }
+    next_reader_pos_ = (best_pos + 1) % readers_.size();
+
+    auto &reader = readers_[best_pos];
+    reader.query_count->fetch_add(1, std::memory_order_relaxed);
+    send_closure(reader.actor, &Reader::run, std::move(query));
+  }
+
+  // the promise is set after all connections are closed
+  void close(Promise<> promise) {
+    MultiPromiseActorSafe mpas{"SqliteReaderPoolCloseMultiPromiseActor"};
+    mpas.add_promise(std::move(promise));
+    auto lock = mpas.get_promise();
+    for (auto &reader : readers_) {
+      send_closure(std::move(reader.actor), &Reader::close, mpas.get_promise());
+    }
+    readers_.clear();
+    lock.set_value(Unit());
+  }
+
+ private:
+  class Reader final : public Actor {
+   public:
+    Reader(CreateDbFunc create_db, std::shared_ptr<std::atomic<size_t>> query_count)
+        : create_db_(std::move(create_db)), query_count_(std::move(query_count)) {
+    }
+
+    void run(Promise<DbT *> query) {
+      query.set_value(db_.get());
+      query_count_->fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void close(Promise<> promise) {
+      db_ = nullptr;
+      stop();
+      promise.set_value(Unit());
+    }
+
+   private:
+    CreateDbFunc create_db_;
+    std::shared_ptr<std::atomic<size_t>> query_count_;
+    unique_ptr<DbT> db_;
+
+    void start_up() final {
+      db_ = create_db_();
+      // the function can own the database, which must be released before it is closed
+      create_db_ = nullptr;
+    }
+  };
+
+  struct ReaderInfo {
+    ActorOwn<Reader> actor;
+    std::shared_ptr<std::atomic<size_t>> query_count;
+  };
+  vector<ReaderInfo> readers_;
+  size_t next_reader_pos_ = 0;
+};
+
+}  // namespace td
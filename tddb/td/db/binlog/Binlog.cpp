@@ -9,7 +9,9 @@
 #include "td/db/binlog/detail/BinlogEventsBuffer.h"
 #include "td/db/binlog/detail/BinlogEventsProcessor.h"
 
+#include "td/utils/algorithm.h"
 #include "td/utils/buffer.h"
+#include "td/utils/crypto.h"
 #include "td/utils/format.h"
 #include "td/utils/misc.h"
 #include "td/utils/port/Clocks.h"
@@ -17,6 +19,7 @@
 #include "td/utils/port/path.h"
 #include "td/utils/port/PollFlags.h"
 #include "td/utils/port/Stat.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/Random.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/SliceBuilder.h"
@@ -25,6 +28,12 @@
 #include "td/utils/tl_helpers.h"
 #include "td/utils/tl_parsers.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
 namespace td {
 namespace detail {
 struct AesCtrEncryptionEvent {
@@ -138,7 +147,8 @@ class BinlogReader {
     }
 
     event->debug_info_ = BinlogDebugInfo{__FILE__, __LINE__};
-    TRY_STATUS(event->init(input_->cut_head(size_).move_as_buffer_slice()));
+    // CRC is checked later for a batch of events at once
+    TRY_STATUS(event->init(input_->cut_head(size_).move_as_buffer_slice(), false));
     offset_ += size_;
     event->offset_ = offset_;
     state_ = State::ReadLength;
@@ -162,6 +172,351 @@ static int64 file_size(CSlice path) {
   }
   return r_stat.ok().size_;
 }
+
+size_t get_load_thread_count(int32 load_thread_count) {
+  if (load_thread_count <= 0) {
+    load_thread_count = static_cast<int32>(thread::hardware_concurrency());
+  }
+  return static_cast<size_t>(clamp(load_thread_count, 1, 16));
+}
+
+// threads, which are used during the whole binlog load; they are created only if they are needed
+class BinlogLoadWorkers {
+ public:
+  explicit BinlogLoadWorkers(size_t thread_count) : thread_count_(thread_count) {
+  }
+  BinlogLoadWorkers(const BinlogLoadWorkers &) = delete;
+  BinlogLoadWorkers &operator=(const BinlogLoadWorkers &) = delete;
+  BinlogLoadWorkers(BinlogLoadWorkers &&) = delete;
+  BinlogLoadWorkers &operator=(BinlogLoadWorkers &&) = delete;
+  ~BinlogLoadWorkers() {
+#if !TD_THREAD_UNSUPPORTED
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      is_closed_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+#endif
+  }
+
+  size_t get_thread_count() const {
+    return thread_count_;
+  }
+
+  // calls f(task_id) for all task_id in [0, task_count) simultaneously; task_count must not exceed thread count
+  void run(size_t task_count, const std::function<void(size_t)> &f) {
+    CHECK(task_count <= thread_count_);
+#if !TD_THREAD_UNSUPPORTED
+    if (task_count > 1) {
+      while (workers_.size() + 1 < thread_count_) {
+        workers_.emplace_back([this] { loop(); });
+        workers_.back().set_name("BinlogLoad");
+      }
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      f_ = &f;
+      next_task_ = 1;
+      task_count_ = task_count;
+      unfinished_task_count_ = task_count - 1;
+      lock.unlock();
+      task_cv_.notify_all();
+
+      f(0);
+
+      lock.lock();
+      finished_cv_.wait(lock, [this] { return unfinished_task_count_ == 0; });
+      f_ = nullptr;
+      return;
+    }
+#endif
+    for (size_t task_id = 0; task_id < task_count; task_id++) {
+      f(task_id);
+    }
+  }
+
+ private:
+  size_t thread_count_;
+#if !TD_THREAD_UNSUPPORTED
+  std::mutex mutex_;
+  std::condition_variable task_cv_;
+  std::condition_variable finished_cv_;
+  const std::function<void(size_t)> *f_ = nullptr;
+  size_t next_task_ = 0;
+  size_t task_count_ = 0;
+  size_t unfinished_task_count_ = 0;
+  bool is_closed_ = false;
+  vector<thread> workers_;
+
+  void loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      task_cv_.wait(lock, [this] { return is_closed_ || next_task_ < task_count_; });
+      if (is_closed_) {
+        return;
+      }
+      auto task_id = next_task_++;
+      auto f = f_;
+      lock.unlock();
+      (*f)(task_id);
+      lock.lock();
+      if (--unfinished_task_count_ == 0) {
+        finished_cv_.notify_all();
+      }
+    }
+  }
+#endif
+};
+
+// returns number of events in the beginning of the vector with valid CRC
+size_t get_valid_event_count(const vector<BinlogEvent> &events, BinlogLoadWorkers &workers) {
+  static constexpr size_t MIN_EVENTS_PER_THREAD = 1024;
+  auto thread_count = clamp(events.size() / MIN_EVENTS_PER_THREAD, static_cast<size_t>(1), workers.get_thread_count());
+  vector<size_t> first_invalid_event(thread_count, events.size());
+  workers.run(thread_count, [&](size_t thread_id) {
+    auto begin = events.size() * thread_id / thread_count;
+    auto end = events.size() * (thread_id + 1) / thread_count;
+    for (auto i = begin; i < end; i++) {
+      auto &event = events[i];
+      auto raw_event = event.raw_event_.as_slice();
+      if (crc32(raw_event.substr(0, raw_event.size() - BinlogEvent::TAIL_SIZE)) != event.crc32_) {
+        first_invalid_event[thread_id] = i;
+        return;
+      }
+    }
+  });
+  return *std::min_element(first_invalid_event.begin(), first_invalid_event.end());
+}
+
+// decrypts large amounts of data using several threads, because AES-CTR allows to start decryption at any offset
+class ParallelAesCtrByteFlow final : public ByteFlowInplaceBase {
+ public:
+  ParallelAesCtrByteFlow(const UInt256 &key, const UInt128 &iv, BinlogLoadWorkers *workers)
+      : key_(key), iv_(iv), workers_(workers) {
+    state_ = create_state(0);
+  }
+
+  AesCtrState move_aes_ctr_state() {
+    return std::move(state_);
+  }
+
+  // the workers exist only during the binlog load
+  void clear_workers() {
+    workers_ = nullptr;
+  }
+
+  bool loop() final {
+    bool result = false;
+    if (workers_ != nullptr && workers_->get_thread_count() > 1 && input_->size() >= 2 * MIN_SIZE_PER_THREAD) {
+      decrypt_parallel();
+      result = true;
+    } else {
+      auto ready = input_->prepare_read();
+      if (!ready.empty()) {
+        state_.encrypt(ready, MutableSlice(const_cast<char *>(ready.data()), ready.size()));
+        input_->confirm_read(ready.size());
+        output_.advance_end(ready.size());
+        offset_ += ready.size();
+        result = true;
+      }
+    }
+
+    if (!is_input_active_) {
+      finish(Status::OK());  // End of input stream.
+    }
+    return result;
+  }
+
+ private:
+  static constexpr size_t MIN_SIZE_PER_THREAD = 1 << 19;
+
+  UInt256 key_;
+  UInt128 iv_;
+  BinlogLoadWorkers *workers_;
+  uint64 offset_ = 0;
+  AesCtrState state_;
+
+  AesCtrState create_state(uint64 offset) const {
+    // add number of the block to the big-endian counter
+    UInt128 counter = iv_;
+    auto add = offset / 16;
+    for (int i = 15; i >= 0 && add != 0; i--) {
+      auto sum = counter.raw[i] + (add & 0xFF);
+      counter.raw[i] = static_cast<uint8>(sum);
+      add = (add >> 8) + (sum >> 8);
+    }
+
+    AesCtrState state;
+    state.init(as_slice(key_), as_slice(counter));
+    char skipped[16] = {};
+    auto skipped_size = static_cast<size_t>(offset % 16);
+    state.encrypt(Slice(skipped, skipped_size), MutableSlice(skipped, skipped_size));
+    return state;
+  }
+
+  void decrypt_parallel() {
+    vector<MutableSlice> slices;
+    size_t total_size = 0;
+    auto it = input_->clone();
+    while (true) {
+      auto ready = it.prepare_read();
+      if (ready.empty()) {
+        break;
+      }
+      slices.emplace_back(const_cast<char *>(ready.data()), ready.size());
+      it.confirm_read(ready.size());
+      total_size += ready.size();
+    }
+
+    auto thread_count = min(workers_->get_thread_count(), total_size / MIN_SIZE_PER_THREAD);
+    workers_->run(thread_count, [&](size_t thread_id) {
+      auto begin = total_size * thread_id / thread_count;
+      auto end = total_size * (thread_id + 1) / thread_count;
+      auto state = create_state(offset_ + begin);
+      size_t slice_begin = 0;
+      for (auto &slice : slices) {
+        auto slice_end = slice_begin + slice.size();
+        auto from = max(begin, slice_begin);
+        auto to = min(end, slice_end);
+        if (from < to) {
+          auto part = slice.substr(from - slice_begin, to - from);
+          state.encrypt(part, part);
+        }
+        slice_begin = slice_end;
+      }
+    });
+
+    input_->advance(total_size);
+    output_.advance_end(total_size);
+    offset_ += total_size;
+    state_ = create_state(offset_);
+  }
+};
+
+// writes a snapshot of binlog events to a new binlog file in a separate thread
+class BinlogBackgroundReindex {
+ public:
+  BinlogBackgroundReindex(FileFd fd, vector<BufferSlice> raw_events, BufferSlice encryption_event, Slice key,
+                          Slice iv)
+      : fd_(std::move(fd)), raw_events_(std::move(raw_events)), encryption_event_(std::move(encryption_event)) {
+    if (!encryption_event_.empty()) {
+      is_encrypted_ = true;
+      aes_ctr_state_.init(key, iv);
+    }
+  }
+
+  void start() {
+#if !TD_THREAD_UNSUPPORTED
+    thread_ = thread([this] {
+      status_ = run();
+      is_finished_.store(true, std::memory_order_release);
+    });
+#else
+    status_ = run();
+    is_finished_.store(true, std::memory_order_release);
+#endif
+  }
+
+  bool is_finished() const {
+    return is_finished_.load(std::memory_order_acquire);
+  }
+
+  Status wait() {
+#if !TD_THREAD_UNSUPPORTED
+    thread_.join();
+#endif
+    return std::move(status_);
+  }
+
+  // the following methods can be called only after wait()
+  Status append(Slice raw_event) {
+    return write(raw_event);
+  }
+
+  Status sync() {
+    TRY_STATUS(flush());
+    return fd_.sync();
+  }
+
+  void close() {
+    fd_.close();
+  }
+
+  FileFd move_fd() {
+    return std::move(fd_);
+  }
+
+  AesCtrState move_aes_ctr_state() {
+    return std::move(aes_ctr_state_);
+  }
+
+  int64 size() const {
+    return size_;
+  }
+
+  uint64 event_count() const {
+    return event_count_;
+  }
+
+ private:
+  static constexpr size_t MAX_BUFFER_SIZE = 1 << 20;
+
+  FileFd fd_;
+  vector<BufferSlice> raw_events_;
+  BufferSlice encryption_event_;
+  bool is_encrypted_ = false;
+  AesCtrState aes_ctr_state_;
+  string buffer_;
+  int64 size_ = 0;
+  uint64 event_count_ = 0;
+
+  Status status_;
+  std::atomic<bool> is_finished_{false};
+#if !TD_THREAD_UNSUPPORTED
+  thread thread_;
+#endif
+
+  Status run() {
+    if (is_encrypted_) {
+      // the encryption event itself isn't encrypted
+      buffer_.append(encryption_event_.as_slice().begin(), encryption_event_.size());
+      size_ += static_cast<int64>(encryption_event_.size());
+      event_count_++;
+    }
+    for (auto &raw_event : raw_events_) {
+      TRY_STATUS(write(raw_event.as_slice()));
+    }
+    reset_to_empty(raw_events_);
+    return flush();
+  }
+
+  Status write(Slice raw_event) {
+    auto old_size = buffer_.size();
+    buffer_.append(raw_event.begin(), raw_event.size());
+    if (is_encrypted_) {
+      MutableSlice data(&buffer_[old_size], raw_event.size());
+      aes_ctr_state_.encrypt(data, data);
+    }
+    size_ += static_cast<int64>(raw_event.size());
+    event_count_++;
+    if (buffer_.size() >= MAX_BUFFER_SIZE) {
+      return flush();
+    }
+    return Status::OK();
+  }
+
+  Status flush() {
+    Slice data = buffer_;
+    while (!data.empty()) {
+      TRY_RESULT(written_size, fd_.write(data));
+      data.remove_prefix(written_size);
+    }
+    buffer_.clear();
+    return Status::OK();
+  }
+};
 }  // namespace detail
 
 int32 VERBOSITY_NAME(binlog) = VERBOSITY_NAME(DEBUG) + 8;
@@ -236,21 +591,38 @@ void Binlog::add_event(BinlogEvent &&event) {
   lazy_flush();
 
   if (state_ == State::Run) {
-    auto fd_size = fd_size_;
-    if (events_buffer_) {
-      fd_size += events_buffer_->size();
-    }
-    auto need_reindex = [&](int64 min_size, int rate) {
-      return fd_size > min_size && fd_size / rate > processor_->total_raw_events_size();
-    };
-    if (need_reindex(50000, 5) || need_reindex(100000, 4) || need_reindex(300000, 3) || need_reindex(500000, 2)) {
-      LOG(INFO) << tag("fd_size", format::as_size(fd_size))
+    if (background_reindex_ != nullptr) {
+      try_finish_background_reindex();
+    } else if (need_reindex()) {
+      LOG(INFO) << tag("fd_size", format::as_size(fd_size_))
                 << tag("total events size", format::as_size(processor_->total_raw_events_size()));
-      do_reindex();
+      if (use_background_reindex_) {
+        start_background_reindex();
+      } else {
+        do_reindex();
+      }
     }
   }
 }
 
+bool Binlog::need_reindex() const {
+  auto fd_size = fd_size_;
+  if (events_buffer_) {
+    fd_size += events_buffer_->size();
+  }
+  auto need_reindex = [&](int64 min_size, int rate) {
+    return fd_size > min_size && fd_size / rate > processor_->total_raw_events_size();
+  };
+  return need_reindex(50000, 5) || need_reindex(100000, 4) || need_reindex(300000, 3) || need_reindex(500000, 2);
+}
+
+void Binlog::set_use_background_reindex(bool use_background_reindex) {
+#if TD_THREAD_UNSUPPORTED
+  use_background_reindex = false;
+#endif
+  use_background_reindex_ = use_background_reindex;
+}
+
 size_t Binlog::flush_events_buffer(bool force) {
   if (!events_buffer_) {
     return 0;
@@ -282,6 +654,7 @@ Status Binlog::close(bool need_sync) {
   if (fd_.empty()) {
     return Status::OK();
   }
+  cancel_background_reindex();
   if (need_sync) {
     sync();
   } else {
@@ -302,6 +675,7 @@ void Binlog::close(Promise<> promise) {
 }
 
 void Binlog::change_key(DbKey new_db_key) {
+  cancel_background_reindex();
   db_key_ = std::move(new_db_key);
   aes_ctr_key_salt_ = BufferSlice();
   do_reindex();
@@ -341,6 +715,9 @@ void Binlog::do_event(BinlogEvent &&event) {
         break;
       }
     }
+    if (background_reindex_ != nullptr) {
+      background_reindex_events_.push_back(event.raw_event_.clone());
+    }
   }
 
   if (event.type_ < 0) {
@@ -413,9 +790,12 @@ void Binlog::do_event(BinlogEvent &&event) {
 }
 
 void Binlog::sync() {
+  if (background_reindex_ != nullptr) {
+    try_finish_background_reindex();
+  }
   flush();
   if (need_sync_) {
-    auto status = fd_.sync();
+    auto status = use_data_sync_ ? fd_.sync_data() : fd_.sync();
     LOG_IF(FATAL, status.is_error()) << "Failed to sync binlog: " << status;
     need_sync_ = false;
   }
@@ -463,10 +843,10 @@ void Binlog::update_read_encryption() {
     }
     case EncryptionType::AesCtr: {
       byte_flow_source_ = ByteFlowSource(&buffer_reader_);
-      aes_xcode_byte_flow_ = AesCtrByteFlow();
-      aes_xcode_byte_flow_.init(std::move(aes_ctr_state_));
+      aes_read_byte_flow_ =
+          td::make_unique<detail::ParallelAesCtrByteFlow>(aes_ctr_key_, aes_ctr_iv_, load_workers_.get());
       byte_flow_sink_ = ByteFlowSink();
-      byte_flow_source_ >> aes_xcode_byte_flow_ >> byte_flow_sink_;
+      byte_flow_source_ >> *aes_read_byte_flow_ >> byte_flow_sink_;
       byte_flow_flag_ = true;
       auto r_file_size = fd_.get_size();
       r_file_size.ensure();
@@ -504,15 +884,48 @@ Status Binlog::load_binlog(const Callback &callback, const Callback &debug_callb
   fd_.set_input_writer(&buffer_writer_);
   detail::BinlogReader reader{nullptr};
   binlog_reader_ptr_ = &reader;
+  load_workers_ = td::make_unique<detail::BinlogLoadWorkers>(detail::get_load_thread_count(load_thread_count_));
+  SCOPE_EXIT {
+    if (aes_read_byte_flow_ != nullptr) {
+      aes_read_byte_flow_->clear_workers();
+    }
+    load_workers_ = nullptr;
+  };
 
   update_read_encryption();
 
   fd_.get_poll_info().add_flags(PollFlags::Read());
   info_.wrong_password = false;
+
+  // events are read in big chunks and their CRC is checked in parallel
+  static constexpr size_t LOAD_READ_SIZE = 1 << 22;
+  vector<BinlogEvent> events;
+  auto add_events = [&] {
+    auto valid_event_count = detail::get_valid_event_count(events, *load_workers_);
+    for (size_t i = 0; i < valid_event_count; i++) {
+      if (debug_callback) {
+        debug_callback(events[i]);
+      }
+      do_add_event(std::move(events[i]));
+      if (info_.wrong_password) {
+        return false;
+      }
+    }
+    if (valid_event_count != events.size()) {
+      LOG(ERROR) << events[valid_event_count].validate();
+      return false;
+    }
+    events.clear();
+    return true;
+  };
+
   while (true) {
     BinlogEvent event;
     auto r_need_size = reader.read_next(&event);
     if (r_need_size.is_error()) {
+      if (!add_events()) {
+        break;
+      }
       if (r_need_size.error().code() == -2) {
         auto old_size = detail::file_size(path_);
         auto offset = reader.offset();
@@ -531,15 +944,17 @@ Status Binlog::load_binlog(const Callback &callback, const Callback &debug_callb
     auto need_size = r_need_size.move_as_ok();
     // LOG(ERROR) << "Need size = " << need_size;
     if (need_size == 0) {
-      if (debug_callback) {
-        debug_callback(event);
-      }
-      do_add_event(std::move(event));
-      if (info_.wrong_password) {
-        return Status::OK();
+      // service events can change encryption of the following events, so they must be applied immediately
+      bool is_service_event = event.type_ < 0;
+      events.push_back(std::move(event));
+      if (is_service_event && !add_events()) {
+        break;
       }
     } else {
-      TRY_STATUS(fd_.flush_read(max(need_size, static_cast<size_t>(4096))));
+      if (!add_events()) {
+        break;
+      }
+      TRY_STATUS(fd_.flush_read(max(need_size, LOAD_READ_SIZE)));
       buffer_reader_.sync_with_writer();
       if (byte_flow_flag_) {
         byte_flow_source_.wakeup();
@@ -549,6 +964,9 @@ Status Binlog::load_binlog(const Callback &callback, const Callback &debug_callb
       }
     }
   }
+  if (info_.wrong_password) {
+    return Status::OK();
+  }
 
   auto offset = processor_->offset();
   processor_->for_each([&](BinlogEvent &event) {
@@ -574,7 +992,7 @@ Status Binlog::load_binlog(const Callback &callback, const Callback &debug_callb
 
   // reuse aes_ctr_state_
   if (encryption_type_ == EncryptionType::AesCtr) {
-    aes_ctr_state_ = aes_xcode_byte_flow_.move_aes_ctr_state();
+    aes_ctr_state_ = aes_read_byte_flow_->move_aes_ctr_state();
   }
   update_write_encryption();
 
@@ -583,9 +1001,8 @@ Status Binlog::load_binlog(const Callback &callback, const Callback &debug_callb
 
 void Binlog::update_encryption(Slice key, Slice iv) {
   as_slice(aes_ctr_key_).copy_from(key);
-  UInt128 aes_ctr_iv;
-  as_slice(aes_ctr_iv).copy_from(iv);
-  aes_ctr_state_.init(as_slice(aes_ctr_key_), as_slice(aes_ctr_iv));
+  as_slice(aes_ctr_iv_).copy_from(iv);
+  aes_ctr_state_.init(as_slice(aes_ctr_key_), as_slice(aes_ctr_iv_));
 }
 
 void Binlog::reset_encryption() {
@@ -668,8 +1085,6 @@ void Binlog::do_reindex() {
   LOG_IF(FATAL, status.is_error()) << "Failed to rename binlog: " << status;
 
   auto finish_time = Clocks::monotonic();
-  auto finish_size = fd_size_;
-  auto finish_events = fd_events_;
   {
     auto r_stat = stat(path_);
     if (r_stat.is_error()) {
@@ -680,17 +1095,7 @@ void Binlog::do_reindex() {
                                              << detail::file_size(new_path) << ' ' << fd_events_ << ' ' << path_;
   }
 
-  auto ratio = static_cast<double>(start_size) / static_cast<double>(finish_size + 1);
-
-  [&](Slice msg) {
-    if (start_size > (10 << 20) || finish_time - start_time > 1) {
-      LOG(WARNING) << "Slow " << msg;
-    } else {
-      LOG(INFO) << msg;
-    }
-  }(PSLICE() << "Regenerate index " << tag("name", path_) << tag("time", format::as_time(finish_time - start_time))
-             << tag("before_size", format::as_size(start_size)) << tag("after_size", format::as_size(finish_size))
-             << tag("ratio", ratio) << tag("before_events", start_events) << tag("after_events", finish_events));
+  on_reindex_finished(false, finish_time - start_time, finish_time - start_time, start_size, start_events);
 
   buffer_writer_ = ChainBufferWriter();
   buffer_reader_ = buffer_writer_.extract_reader();
@@ -702,6 +1107,165 @@ void Binlog::do_reindex() {
   update_write_encryption();
 }
 
+void Binlog::start_background_reindex() {
+  CHECK(state_ == State::Run);
+  CHECK(background_reindex_ == nullptr);
+  if (db_key_.is_empty() != (encryption_type_ == EncryptionType::None) ||
+      (encryption_type_ == EncryptionType::AesCtr && aes_ctr_key_salt_.empty())) {
+    // the encryption must be changed, so the binlog can be regenerated only synchronously
+    return do_reindex();
+  }
+
+  auto start_time = Clocks::monotonic();
+  flush_events_buffer(true);
+
+  string new_path = path_ + ".new";
+  auto r_opened_file = open_binlog(new_path, FileFd::Flags::Write | FileFd::Flags::Create | FileFd::Truncate);
+  if (r_opened_file.is_error()) {
+    LOG(ERROR) << "Can't open new binlog for regenerate: " << r_opened_file.error();
+    return;
+  }
+
+  // the new binlog is encrypted with the same key, but with a new IV
+  BufferSlice encryption_event;
+  BufferSlice iv;
+  if (encryption_type_ == EncryptionType::AesCtr) {
+    using EncryptionEvent = detail::AesCtrEncryptionEvent;
+    EncryptionEvent event;
+    event.key_salt_ = aes_ctr_key_salt_.clone();
+    event.iv_ = BufferSlice(EncryptionEvent::iv_size());
+    Random::secure_bytes(event.iv_.as_slice());
+    event.key_hash_ = EncryptionEvent::generate_hash(as_slice(aes_ctr_key_));
+    iv = event.iv_.clone();
+    encryption_event =
+        BinlogEvent::create_raw(0, BinlogEvent::ServiceTypes::AesCtrEncryption, 0, create_default_storer(event));
+  }
+
+  vector<BufferSlice> raw_events;
+  processor_->for_each([&](BinlogEvent &event) { raw_events.push_back(event.raw_event_.clone()); });
+
+  background_reindex_ = td::make_unique<detail::BinlogBackgroundReindex>(
+      r_opened_file.move_as_ok(), std::move(raw_events), std::move(encryption_event), as_slice(aes_ctr_key_),
+      iv.as_slice());
+  background_reindex_events_.clear();
+  background_reindex_start_time_ = start_time;
+  background_reindex_start_size_ = fd_size_;
+  background_reindex_start_events_ = fd_events_;
+  background_reindex_->start();
+  background_reindex_blocking_time_ = Clocks::monotonic() - start_time;
+}
+
+void Binlog::try_finish_background_reindex() {
+  if (background_reindex_ != nullptr && background_reindex_->is_finished()) {
+    finish_background_reindex();
+  }
+}
+
+void Binlog::finish_background_reindex() {
+  CHECK(state_ == State::Run);
+  CHECK(background_reindex_ != nullptr);
+  auto start_time = Clocks::monotonic();
+  auto reindex = std::move(background_reindex_);
+  auto events = std::move(background_reindex_events_);
+  background_reindex_events_.clear();
+
+  // append events, which were added after the snapshot was taken
+  auto status = reindex->wait();
+  for (auto &event : events) {
+    if (status.is_error()) {
+      break;
+    }
+    status = reindex->append(event.as_slice());
+  }
+  if (status.is_ok()) {
+    status = reindex->sync();
+  }
+
+  string new_path = path_ + ".new";
+  if (status.is_error()) {
+    LOG(ERROR) << "Failed to regenerate binlog in background: " << status;
+    reindex->close();
+    unlink(new_path).ignore();
+    FileFd::remove_local_lock(new_path);
+    return;
+  }
+
+  status = unlink(path_);
+  LOG_IF(FATAL, status.is_error()) << "Failed to unlink old binlog: " << status;
+  fd_.close();  // now we can close old file and release the system lock
+  status = rename(new_path, path_);
+  FileFd::remove_local_lock(new_path);  // now we can release local lock for temporary file
+  LOG_IF(FATAL, status.is_error()) << "Failed to rename binlog: " << status;
+
+  fd_ = BufferedFdBase<FileFd>(reindex->move_fd());
+  fd_size_ = reindex->size();
+  fd_events_ = reindex->event_count();
+  need_sync_ = false;
+  {
+    auto r_stat = stat(path_);
+    if (r_stat.is_error()) {
+      LOG(FATAL) << "Failed to rename binlog of size " << fd_size_ << " to " << path_ << ": " << r_stat.error()
+                 << ". Old file size is " << detail::file_size(new_path);
+    }
+    LOG_CHECK(fd_size_ == r_stat.ok().size_) << fd_size_ << ' ' << r_stat.ok().size_ << ' '
+                                             << detail::file_size(new_path) << ' ' << fd_events_ << ' ' << path_;
+  }
+
+  buffer_writer_ = ChainBufferWriter();
+  buffer_reader_ = buffer_writer_.extract_reader();
+  if (encryption_type_ == EncryptionType::AesCtr) {
+    aes_ctr_state_ = reindex->move_aes_ctr_state();
+  }
+  update_write_encryption();
+
+  auto finish_time = Clocks::monotonic();
+  auto blocking_time = max(background_reindex_blocking_time_, finish_time - start_time);
+  on_reindex_finished(true, finish_time - background_reindex_start_time_, blocking_time,
+                      background_reindex_start_size_, background_reindex_start_events_);
+}
+
+void Binlog::cancel_background_reindex() {
+  if (background_reindex_ == nullptr) {
+    return;
+  }
+  auto reindex = std::move(background_reindex_);
+  background_reindex_events_.clear();
+  reindex->wait().ignore();
+  reindex->close();
+
+  string new_path = path_ + ".new";
+  unlink(new_path).ignore();
+  FileFd::remove_local_lock(new_path);
+}
+
+void Binlog::on_reindex_finished(bool is_background, double reindex_time, double blocking_time, int64 start_size,
+                                 uint64 start_events) {
+  auto finish_size = fd_size_;
+  auto finish_events = fd_events_;
+
+  reindex_statistics_.reindex_count++;
+  if (is_background) {
+    reindex_statistics_.background_reindex_count++;
+  }
+  reindex_statistics_.total_reindex_time += reindex_time;
+  reindex_statistics_.max_blocking_time = max(reindex_statistics_.max_blocking_time, blocking_time);
+  reindex_statistics_.last_size_before = start_size;
+  reindex_statistics_.last_size_after = finish_size;
+
+  auto ratio = static_cast<double>(start_size) / static_cast<double>(finish_size + 1);
+
+  [&](Slice msg) {
+    if (start_size > (10 << 20) || blocking_time > 1) {
+      LOG(WARNING) << "Slow " << msg;
+    } else {
+      LOG(INFO) << msg;
+    }
+  }(PSLICE() << "Regenerate index " << format::cond(is_background, "in background ") << tag("name", path_)
+             << tag("time", format::as_time(reindex_time)) << tag("blocking_time", format::as_time(blocking_time))
+             << tag("before_size", format::as_size(start_size)) << tag("after_size", format::as_size(finish_size))
+             << tag("ratio", ratio) << tag("before_events", start_events) << tag("after_events", finish_events));
+}
+
 string Binlog::debug_get_binlog_data(int64 begin_offset, int64 end_offset) {
   if (begin_offset > end_offset) {
     return "Begin offset is bigger than end_offset";
@@ -38,10 +38,23 @@ struct BinlogInfo {
   bool is_opened{false};
 };
 
+struct BinlogReindexStatistics {
+  uint64 reindex_count{0};
+  uint64 background_reindex_count{0};
+  double total_reindex_time{0.0};
+  // maximum time for which adding of new events was blocked by a reindex
+  double max_blocking_time{0.0};
+  int64 last_size_before{0};
+  int64 last_size_after{0};
+};
+
 namespace detail {
 class BinlogReader;
 class BinlogEventsProcessor;
 class BinlogEventsBuffer;
+class BinlogBackgroundReindex;
+class BinlogLoadWorkers;
+class ParallelAesCtrByteFlow;
 }  // namespace detail
 
 class Binlog {
@@ -100,6 +113,21 @@ class Binlog {
 
   void add_event(BinlogEvent &&event);
   void sync();
+  // if enabled, only file data is synced, which is faster, but file metadata like modification time can be lost
+  void set_use_data_sync(bool use_data_sync) {
+    use_data_sync_ = use_data_sync;
+  }
+  // if enabled, the new binlog version is written in a separate thread, while new events are still being added
+  void set_use_background_reindex(bool use_background_reindex);
+  bool has_background_reindex() const {
+    return background_reindex_ != nullptr;
+  }
+  // replaces the binlog file with the new version if the background reindex has finished writing it
+  void try_finish_background_reindex();
+  // number of threads used to decrypt and check binlog events during init; 0 means the number of CPU cores
+  void set_load_thread_count(int32 load_thread_count) {
+    load_thread_count_ = load_thread_count;
+  }
   void flush();
   void lazy_flush();
   double need_flush_since() const {
@@ -120,6 +148,10 @@ class Binlog {
     return info_;
   }
 
+  const BinlogReindexStatistics &get_reindex_statistics() const {
+    return reindex_statistics_;
+  }
+
  private:
   BufferedFdBase<FileFd> fd_;
   ChainBufferWriter buffer_writer_;
@@ -135,12 +167,16 @@ class Binlog {
   // AesCtrEncryption
   BufferSlice aes_ctr_key_salt_;
   UInt256 aes_ctr_key_{};
+  UInt128 aes_ctr_iv_{};
   AesCtrState aes_ctr_state_;
 
   bool byte_flow_flag_ = false;
   ByteFlowSource byte_flow_source_;
   ByteFlowSink byte_flow_sink_;
   AesCtrByteFlow aes_xcode_byte_flow_;
+  unique_ptr<detail::ParallelAesCtrByteFlow> aes_read_byte_flow_;
+  unique_ptr<detail::BinlogLoadWorkers> load_workers_;
+  int32 load_thread_count_{0};
 
   int64 fd_size_{0};
   uint64 fd_events_{0};
@@ -152,14 +188,30 @@ class Binlog {
   uint64 last_id_{0};
   double need_flush_since_ = 0;
   bool need_sync_{false};
+  bool use_data_sync_{false};
   enum class State { Empty, Load, Reindex, Run } state_{State::Empty};
 
+  bool use_background_reindex_{false};
+  unique_ptr<detail::BinlogBackgroundReindex> background_reindex_;
+  std::vector<BufferSlice> background_reindex_events_;  // events added after the background reindex has started
+  double background_reindex_start_time_{0.0};
+  double background_reindex_blocking_time_{0.0};
+  int64 background_reindex_start_size_{0};
+  uint64 background_reindex_start_events_{0};
+  BinlogReindexStatistics reindex_statistics_;
+
   static Result<FileFd> open_binlog(const string &path, int32 flags);
   size_t flush_events_buffer(bool force);
   void do_add_event(BinlogEvent &&event);
   void do_event(BinlogEvent &&event);
   Status load_binlog(const Callback &callback, const Callback &debug_callback = Callback()) TD_WARN_UNUSED_RESULT;
   void do_reindex();
+  bool need_reindex() const;
+  void start_background_reindex();
+  void finish_background_reindex();
+  void cancel_background_reindex();
+  void on_reindex_finished(bool is_background, double reindex_time, double blocking_time, int64 start_size,
+                           uint64 start_events);
 
   void update_encryption(Slice key, Slice iv);
   void reset_encryption();
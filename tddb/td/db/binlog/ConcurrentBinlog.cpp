@@ -11,13 +11,44 @@
 #include "td/utils/SliceBuilder.h"
 #include "td/utils/Time.h"
 
+#include <atomic>
 #include <map>
+#include <memory>
+#include <mutex>
 
 namespace td {
 namespace detail {
+struct BinlogStatisticsData {
+  // written only by BinlogActor
+  std::atomic<uint64> sync_count{0};
+  std::atomic<uint64> synced_promise_count{0};
+  std::atomic<uint64> total_sync_time_ns{0};
+  std::atomic<uint64> max_sync_time_ns{0};
+
+  void on_sync(size_t promise_count, double sync_time) {
+    auto sync_time_ns = static_cast<uint64>(sync_time * 1e9);
+    sync_count.store(sync_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    synced_promise_count.store(synced_promise_count.load(std::memory_order_relaxed) + promise_count,
+                               std::memory_order_relaxed);
+    total_sync_time_ns.store(total_sync_time_ns.load(std::memory_order_relaxed) + sync_time_ns,
+                             std::memory_order_relaxed);
+    if (sync_time_ns > max_sync_time_ns.load(std::memory_order_relaxed)) {
+      max_sync_time_ns.store(sync_time_ns, std::memory_order_relaxed);
+    }
+  }
+
+  // changed rarely, so can be protected by a mutex
+  std::mutex reindex_statistics_mutex;
+  BinlogReindexStatistics reindex_statistics;
+};
+
 class BinlogActor final : public Actor {
  public:
-  BinlogActor(unique_ptr<Binlog> binlog, uint64 seq_no) : binlog_(std::move(binlog)), processor_(seq_no) {
+  BinlogActor(unique_ptr<Binlog> binlog, uint64 seq_no, std::shared_ptr<BinlogStatisticsData> statistics)
+      : binlog_(std::move(binlog)), processor_(seq_no), statistics_(std::move(statistics)) {
+  }
+  void start_up() final {
+    check_background_reindex();
   }
   void close(Promise<> promise) {
     binlog_->close().ensure();
@@ -48,6 +79,7 @@ class BinlogActor final : public Actor {
     });
     flush_immediate_sync();
     try_flush();
+    check_background_reindex();
   }
 
   void force_sync(Promise<> &&promise) {
@@ -67,22 +99,48 @@ class BinlogActor final : public Actor {
 
   void change_key(DbKey db_key, Promise<> promise) {
     binlog_->change_key(std::move(db_key));
+    check_background_reindex();
     promise.set_value(Unit());
   }
 
+  void set_use_background_reindex(bool use_background_reindex) {
+    binlog_->set_use_background_reindex(use_background_reindex);
+    check_background_reindex();
+  }
+
+  void set_sync_policy(BinlogSyncPolicy policy) {
+    policy_ = policy;
+    binlog_->set_use_data_sync(policy_.use_data_sync);
+    if (lazy_sync_flag_) {
+      lazy_sync_at_ = min(lazy_sync_at_, Time::now_cached() + policy_.max_sync_delay);
+      wakeup_at(lazy_sync_at_);
+    }
+    if (need_sync_pending_promises()) {
+      do_immediate_sync(Promise<>());
+    }
+  }
+
  private:
   unique_ptr<Binlog> binlog_;
 
   OrderedEventsProcessor<Event> processor_;
 
+  BinlogSyncPolicy policy_;
+  std::shared_ptr<BinlogStatisticsData> statistics_;
+
   std::multimap<uint64, Promise<>> immediate_sync_promises_;
   std::vector<Promise<>> sync_promises_;
   bool force_sync_flag_ = false;
   bool lazy_sync_flag_ = false;
   bool flush_flag_ = false;
+  bool background_reindex_check_flag_ = false;
+  double lazy_sync_at_ = 0;
   double wakeup_at_ = 0;
+  uint64 reindex_count_ = 0;
 
   static constexpr double FLUSH_TIMEOUT = 0.001;  // 1ms
+  // the reindex thread can't send events to the actor, so its state is polled while it is running
+  static constexpr double BACKGROUND_REINDEX_CHECK_DELAY = 0.01;  // 10ms
 
   void wakeup_after(double after) {
     auto now = Time::now_cached();
@@ -96,6 +154,25 @@ class BinlogActor final : public Actor {
     }
   }
 
+  void update_reindex_statistics() {
+    auto &reindex_statistics = binlog_->get_reindex_statistics();
+    if (reindex_statistics.reindex_count == reindex_count_) {
+      return;
+    }
+    reindex_count_ = reindex_statistics.reindex_count;
+    std::lock_guard<std::mutex> lock(statistics_->reindex_statistics_mutex);
+    statistics_->reindex_statistics = reindex_statistics;
+  }
+
+  void check_background_reindex() {
+    binlog_->try_finish_background_reindex();
+    update_reindex_statistics();
+    if (binlog_->has_background_reindex() && !background_reindex_check_flag_) {
+      background_reindex_check_flag_ = true;
+      wakeup_after(BACKGROUND_REINDEX_CHECK_DELAY);
+    }
+  }
+
   void do_add_raw_event(BufferSlice &&raw_event, BinlogDebugInfo info) {
     binlog_->add_raw_event(std::move(raw_event), info);
   }
@@ -127,35 +204,56 @@ class BinlogActor final : public Actor {
     }
     if (!force_sync_flag_) {
       force_sync_flag_ = true;
-      wakeup_after(0.003);
+      wakeup_after(policy_.force_sync_delay);
     }
   }
 
+  bool need_sync_pending_promises() const {
+    return policy_.max_pending_sync_count != 0 && sync_promises_.size() >= policy_.max_pending_sync_count;
+  }
+
   void do_lazy_sync(Promise<> &&promise) {
     if (!promise) {
       return;
     }
     sync_promises_.emplace_back(std::move(promise));
+    if (need_sync_pending_promises()) {
+      // sync all pending events at once
+      return do_immediate_sync(Promise<>());
+    }
     if (!lazy_sync_flag_ && !force_sync_flag_) {
-      wakeup_after(30);
+      lazy_sync_at_ = Time::now_cached() + policy_.max_sync_delay;
+      wakeup_at(lazy_sync_at_);
       lazy_sync_flag_ = true;
     }
   }
 
   void timeout_expired() final {
-    bool need_sync = lazy_sync_flag_ || force_sync_flag_;
-    lazy_sync_flag_ = false;
-    force_sync_flag_ = false;
+    wakeup_at_ = 0;
+    bool need_sync = force_sync_flag_ || (lazy_sync_flag_ && Time::now_cached() > lazy_sync_at_ - 1e-9);
+    if (need_sync) {
+      lazy_sync_flag_ = false;
+      force_sync_flag_ = false;
+    } else if (lazy_sync_flag_) {
+      // the timeout was set to check the background reindex
+      wakeup_at(lazy_sync_at_);
+    }
     bool need_flush = flush_flag_;
     flush_flag_ = false;
-    wakeup_at_ = 0;
+    if (background_reindex_check_flag_) {
+      background_reindex_check_flag_ = false;
+      check_background_reindex();
+    }
     if (need_sync) {
+      auto sync_start_time = Time::now();
       binlog_->sync();
+      statistics_->on_sync(sync_promises_.size(), Time::now() - sync_start_time);
       // LOG(ERROR) << "BINLOG SYNC";
       for (auto &promise : sync_promises_) {
         promise.set_value(Unit());
       }
       sync_promises_.clear();
+      update_reindex_statistics();
     } else if (need_flush) {
       try_flush();
       // LOG(ERROR) << "BINLOG FLUSH";
@@ -182,8 +280,9 @@ Result<BinlogInfo> ConcurrentBinlog::init(string path, const Callback &callback,
 void ConcurrentBinlog::init_impl(unique_ptr<Binlog> binlog, int32 scheduler_id) {
   path_ = binlog->get_path().str();
   last_id_ = binlog->peek_next_id();
+  statistics_ = std::make_shared<detail::BinlogStatisticsData>();
   binlog_actor_ = create_actor_on_scheduler<detail::BinlogActor>(PSLICE() << "Binlog " << path_, scheduler_id,
-                                                                 std::move(binlog), last_id_);
+                                                                 std::move(binlog), last_id_, statistics_);
 }
 
 void ConcurrentBinlog::close_impl(Promise<> promise) {
@@ -204,4 +303,29 @@ void ConcurrentBinlog::force_flush() {
 void ConcurrentBinlog::change_key(DbKey db_key, Promise<> promise) {
   send_closure(binlog_actor_, &detail::BinlogActor::change_key, std::move(db_key), std::move(promise));
 }
+void ConcurrentBinlog::set_sync_policy(BinlogSyncPolicy policy) {
+  send_closure(binlog_actor_, &detail::BinlogActor::set_sync_policy, policy);
+}
+void ConcurrentBinlog::set_use_background_reindex(bool use_background_reindex) {
+  send_closure(binlog_actor_, &detail::BinlogActor::set_use_background_reindex, use_background_reindex);
+}
+BinlogSyncStatistics ConcurrentBinlog::get_sync_statistics() const {
+  BinlogSyncStatistics result;
+  if (statistics_ == nullptr) {
+    return result;
+  }
+  auto &data = *statistics_;
+  result.sync_count = data.sync_count.load(std::memory_order_relaxed);
+  result.synced_promise_count = data.synced_promise_count.load(std::memory_order_relaxed);
+  result.total_sync_time = static_cast<double>(data.total_sync_time_ns.load(std::memory_order_relaxed)) * 1e-9;
+  result.max_sync_time = static_cast<double>(data.max_sync_time_ns.load(std::memory_order_relaxed)) * 1e-9;
+  return result;
+}
+BinlogReindexStatistics ConcurrentBinlog::get_reindex_statistics() const {
+  if (statistics_ == nullptr) {
+    return BinlogReindexStatistics();
+  }
+  std::lock_guard<std::mutex> lock(statistics_->reindex_statistics_mutex);
+  return statistics_->reindex_statistics;
+}
 }  // namespace td
@@ -20,13 +20,34 @@
 
 #include <atomic>
 #include <functional>
+#include <memory>
 
 namespace td {
 
 namespace detail {
 class BinlogActor;
+struct BinlogStatisticsData;
 }  // namespace detail
 
+// defines how events, waiting for a sync, are grouped into one sync
+struct BinlogSyncPolicy {
+  // maximum time in seconds before an event added with a promise is synced
+  double max_sync_delay = 30.0;
+  // time in seconds to wait for other sync requests after force_sync is called
+  double force_sync_delay = 0.003;
+  // if positive, then events are synced as soon as there are max_pending_sync_count promises waiting for a sync
+  size_t max_pending_sync_count = 0;
+  // use fdatasync instead of fsync if supported
+  bool use_data_sync = false;
+};
+
+struct BinlogSyncStatistics {
+  uint64 sync_count = 0;
+  uint64 synced_promise_count = 0;
+  double total_sync_time = 0.0;
+  double max_sync_time = 0.0;
+};
+
 class ConcurrentBinlog final : public BinlogInterface {
  public:
   using Callback = std::function<void(const BinlogEvent &)>;
@@ -45,6 +66,17 @@ class ConcurrentBinlog final : public BinlogInterface {
   void force_flush() final;
   void change_key(DbKey db_key, Promise<> promise) final;
 
+  void set_sync_policy(BinlogSyncPolicy policy);
+
+  // if enabled, the binlog is reindexed in a separate thread; see Binlog::set_use_background_reindex
+  void set_use_background_reindex(bool use_background_reindex);
+
+  // can be called from any thread
+  BinlogSyncStatistics get_sync_statistics() const;
+
+  // can be called from any thread
+  BinlogReindexStatistics get_reindex_statistics() const;
+
   uint64 next_id() final {
     return last_id_.fetch_add(1, std::memory_order_relaxed);
   }
@@ -63,6 +95,7 @@ class ConcurrentBinlog final : public BinlogInterface {
   void add_raw_event_impl(uint64 id, BufferSlice &&raw_event, Promise<> promise, BinlogDebugInfo info) final;
 
   ActorOwn<detail::BinlogActor> binlog_actor_;
+  std::shared_ptr<detail::BinlogStatisticsData> statistics_;
   string path_;
   std::atomic<uint64> last_id_{0};
 };
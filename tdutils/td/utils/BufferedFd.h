@@ -47,6 +47,11 @@ class BufferedFdBase : public FdT {
   void set_output_reader(ChainBufferReader *write) {
     write_ = write;
   }
+  // the next size bytes will be read to one buffer with prepend_size bytes of free space before them
+  void reserve_input(size_t size, size_t prepend_size) {
+    CHECK(read_);
+    read_->reserve(size, prepend_size);
+  }
 
  private:
   ChainBufferWriter *read_ = nullptr;
@@ -45,6 +45,28 @@ class ChangesProcessor {
     try_compactify();
   }
 
+  // finishes all changes, including unfinished ones
+  template <class F>
+  void finish_all(F &&func) {
+    while (ready_i_ < data_array_.size()) {
+      func(std::move(data_array_[ready_i_].first));
+      ready_i_++;
+    }
+    clear();
+  }
+
+  // returns data of a change, which isn't processed yet
+  DataT &get(Id token) {
+    size_t pos = static_cast<size_t>(token) - offset_;
+    CHECK(ready_i_ <= pos && pos < data_array_.size());
+    return data_array_[pos].first;
+  }
+
+  // returns true if all added changes are processed
+  bool empty() const {
+    return ready_i_ == data_array_.size();
+  }
+
  private:
   size_t offset_ = 1;
   size_t ready_i_ = 0;
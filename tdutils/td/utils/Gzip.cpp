@@ -9,6 +9,8 @@
 char disable_linker_warning_about_empty_file_gzip_cpp TD_UNUSED;
 
 #if TD_HAVE_ZLIB
+#include "td/utils/as.h"
+#include "td/utils/port/thread_local.h"
 #include "td/utils/SliceBuilder.h"
 
 #include <cstring>
@@ -17,6 +19,10 @@ char disable_linker_warning_about_empty_file_gzip_cpp TD_UNUSED;
 
 #include <zlib.h>
 
+#if TD_HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
 namespace td {
 
 class Gzip::Impl {
@@ -154,7 +160,73 @@ Gzip::~Gzip() {
   clear();
 }
 
+#if TD_HAVE_LIBDEFLATE
+namespace {
+
+// libdeflate can't process streams, but it decompresses whole buffers several times faster than zlib
+struct LibdeflateDecompressor {
+  libdeflate_decompressor *decompressor = libdeflate_alloc_decompressor();
+
+  LibdeflateDecompressor() = default;
+  LibdeflateDecompressor(const LibdeflateDecompressor &) = delete;
+  LibdeflateDecompressor &operator=(const LibdeflateDecompressor &) = delete;
+  LibdeflateDecompressor(LibdeflateDecompressor &&) = delete;
+  LibdeflateDecompressor &operator=(LibdeflateDecompressor &&) = delete;
+  ~LibdeflateDecompressor() {
+    libdeflate_free_decompressor(decompressor);
+  }
+};
+
+libdeflate_decompressor *get_libdeflate_decompressor() {
+  static TD_THREAD_LOCAL LibdeflateDecompressor *decompressor;
+  init_thread_local<LibdeflateDecompressor>(decompressor);
+  return decompressor->decompressor;
+}
+
+// returns an empty BufferSlice if the data can't be decompressed by libdeflate
+BufferSlice libdeflate_gzdecode(Slice s) {
+  auto decompressor = get_libdeflate_decompressor();
+  if (decompressor == nullptr || s.size() < 18) {
+    return BufferSlice();
+  }
+
+  bool is_gzip = static_cast<unsigned char>(s[0]) == 0x1f && static_cast<unsigned char>(s[1]) == 0x8b;
+  size_t output_size = s.size() * 2;
+  if (is_gzip) {
+    // the gzip trailer contains the uncompressed size modulo 2^32, but it can be wrong
+    auto stored_size = static_cast<size_t>(as<uint32>(s.end() - 4));
+    output_size = td::max(output_size, td::min(stored_size, s.size() * 64));
+  }
+  while (true) {
+    BufferSlice result(output_size);
+    size_t result_size = 0;
+    auto status = is_gzip ? libdeflate_gzip_decompress(decompressor, s.data(), s.size(), result.as_slice().data(),
+                                                       result.size(), &result_size)
+                          : libdeflate_zlib_decompress(decompressor, s.data(), s.size(), result.as_slice().data(),
+                                                       result.size(), &result_size);
+    if (status == LIBDEFLATE_SUCCESS) {
+      result.truncate(result_size);
+      return result;
+    }
+    // deflate can't compress data more than 1032 times
+    if (status != LIBDEFLATE_INSUFFICIENT_SPACE || output_size >= s.size() * 1032) {
+      return BufferSlice();
+    }
+    output_size *= 2;
+  }
+}
+
+}  // namespace
+#endif
+
 BufferSlice gzdecode(Slice s) {
+#if TD_HAVE_LIBDEFLATE
+  auto result = libdeflate_gzdecode(s);
+  if (!result.empty()) {
+    return result;
+  }
+  // fallback to zlib, which supports also multistream data and preset dictionaries
+#endif
   Gzip gzip;
   gzip.init_decode().ensure();
   ChainBufferWriter message;
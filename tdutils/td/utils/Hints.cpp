@@ -67,25 +67,207 @@ vector<string> Hints::get_words(Slice name, bool is_search) {
   return fix_words(std::move(words));
 }
 
-void Hints::add_word(const string &word, KeyT key, std::map<string, vector<KeyT>> &word_to_keys) {
-  vector<KeyT> &keys = word_to_keys[word];
+Slice Hints::WordIndex::get_word(size_t pos) const {
+  size_t begin = pos == 0 ? 0 : sorted_words_[pos - 1].end_offset;
+  return Slice(words_).substr(begin, sorted_words_[pos].end_offset - begin);
+}
+
+size_t Hints::WordIndex::get_keys_begin(size_t pos) const {
+  return pos == 0 ? 0 : sorted_words_[pos - 1].keys_end;
+}
+
+// returns position of the first sorted word, which isn't less than the given word
+size_t Hints::WordIndex::find_word(Slice word) const {
+  size_t left = 0;
+  size_t right = sorted_words_.size();
+  while (left < right) {
+    auto middle = left + (right - left) / 2;
+    if (get_word(middle) < word) {
+      left = middle + 1;
+    } else {
+      right = middle;
+    }
+  }
+  return left;
+}
+
+void Hints::WordIndex::add(const string &word, KeyT key) {
+  if (removed_key_count_ > 0) {
+    // the key could have been removed from the sorted words
+    auto pos = find_word(word);
+    if (pos < sorted_words_.size() && get_word(pos) == word) {
+      for (auto i = get_keys_begin(pos); i < sorted_words_[pos].keys_end; i++) {
+        if (keys_[i] == key) {
+          CHECK(is_key_removed_[i]);
+          is_key_removed_[i] = false;
+          removed_key_count_--;
+          return;
+        }
+      }
+    }
+  }
+
+  vector<KeyT> &keys = added_words_[word];
   CHECK(!td::contains(keys, key));
   keys.push_back(key);
+  added_key_count_++;
+  rebuild_if_needed();
 }
 
-void Hints::delete_word(const string &word, KeyT key, std::map<string, vector<KeyT>> &word_to_keys) {
-  vector<KeyT> &keys = word_to_keys[word];
-  auto key_it = std::find(keys.begin(), keys.end(), key);
-  CHECK(key_it != keys.end());
-  if (keys.size() == 1) {
-    word_to_keys.erase(word);
-  } else {
-    CHECK(keys.size() > 1);
-    *key_it = keys.back();
-    keys.pop_back();
+void Hints::WordIndex::add_all(vector<std::pair<string, KeyT>> word_keys) {
+  if (!need_rebuild(added_key_count_ + removed_key_count_ + word_keys.size())) {
+    for (auto &word_key : word_keys) {
+      add(word_key.first, word_key.second);
+    }
+    return;
+  }
+
+  move_added_word_keys(word_keys);
+  std::sort(word_keys.begin(), word_keys.end());
+  rebuild(word_keys);
+}
+
+void Hints::WordIndex::remove(const string &word, KeyT key) {
+  auto it = added_words_.find(word);
+  if (it != added_words_.end()) {
+    vector<KeyT> &keys = it->second;
+    auto key_it = std::find(keys.begin(), keys.end(), key);
+    if (key_it != keys.end()) {
+      if (keys.size() == 1) {
+        added_words_.erase(it);
+      } else {
+        *key_it = keys.back();
+        keys.pop_back();
+      }
+      added_key_count_--;
+      return;
+    }
+  }
+
+  auto pos = find_word(word);
+  CHECK(pos < sorted_words_.size() && get_word(pos) == word);
+  for (auto i = get_keys_begin(pos); i < sorted_words_[pos].keys_end; i++) {
+    if (keys_[i] == key && !is_key_removed_[i]) {
+      is_key_removed_[i] = true;
+      removed_key_count_++;
+      rebuild_if_needed();
+      return;
+    }
+  }
+  UNREACHABLE();
+}
+
+void Hints::WordIndex::search(const string &prefix, vector<KeyT> &results) const {
+  for (auto pos = find_word(prefix); pos < sorted_words_.size(); pos++) {
+    if (!begins_with(get_word(pos), prefix)) {
+      break;
+    }
+    auto keys_begin = get_keys_begin(pos);
+    auto keys_end = sorted_words_[pos].keys_end;
+    if (removed_key_count_ == 0) {
+      results.insert(results.end(), keys_.begin() + keys_begin, keys_.begin() + keys_end);
+      continue;
+    }
+    for (auto i = keys_begin; i < keys_end; i++) {
+      if (!is_key_removed_[i]) {
+        results.push_back(keys_[i]);
+      }
+    }
+  }
+
+  for (auto it = added_words_.lower_bound(prefix); it != added_words_.end() && begins_with(it->first, prefix); ++it) {
+    results.insert(results.end(), it->second.begin(), it->second.end());
+  }
+}
+
+// the sorted words are rebuilt after the number of changes becomes proportional to their size,
+// so each change costs amortized O(1) copied keys
+bool Hints::WordIndex::need_rebuild(size_t change_count) const {
+  const size_t MIN_REBUILD_CHANGE_COUNT = 256;
+  return change_count > MIN_REBUILD_CHANGE_COUNT + keys_.size() / 4;
+}
+
+void Hints::WordIndex::rebuild_if_needed() {
+  if (need_rebuild(added_key_count_ + removed_key_count_)) {
+    rebuild();
   }
 }
 
+// appends the added words in sorted order
+void Hints::WordIndex::move_added_word_keys(vector<std::pair<string, KeyT>> &word_keys) {
+  word_keys.reserve(word_keys.size() + added_key_count_);
+  for (auto &it : added_words_) {
+    for (auto key : it.second) {
+      word_keys.emplace_back(it.first, key);
+    }
+  }
+  added_words_.clear();
+  added_key_count_ = 0;
+}
+
+void Hints::WordIndex::rebuild() {
+  vector<std::pair<string, KeyT>> word_keys;
+  move_added_word_keys(word_keys);
+  rebuild(word_keys);
+}
+
+void Hints::WordIndex::rebuild(const vector<std::pair<string, KeyT>> &word_keys) {
+  CHECK(added_words_.empty());
+  string words;
+  vector<Word> sorted_words;
+  vector<KeyT> keys;
+  words.reserve(words_.size());
+  sorted_words.reserve(sorted_words_.size() + word_keys.size());
+  keys.reserve(keys_.size() - removed_key_count_ + word_keys.size());
+
+  // merge the sorted words with the added words
+  size_t pos = 0;
+  size_t added_pos = 0;
+  while (pos < sorted_words_.size() || added_pos < word_keys.size()) {
+    Slice word;
+    bool use_sorted_word = false;
+    bool use_added_word = false;
+    if (added_pos == word_keys.size() || (pos < sorted_words_.size() && get_word(pos) < word_keys[added_pos].first)) {
+      word = get_word(pos);
+      use_sorted_word = true;
+    } else {
+      word = word_keys[added_pos].first;
+      use_added_word = true;
+      use_sorted_word = pos < sorted_words_.size() && get_word(pos) == word;
+    }
+
+    auto old_keys_size = keys.size();
+    if (use_sorted_word) {
+      for (auto i = get_keys_begin(pos); i < sorted_words_[pos].keys_end; i++) {
+        if (!is_key_removed_[i]) {
+          keys.push_back(keys_[i]);
+        }
+      }
+    }
+    if (use_added_word) {
+      while (added_pos < word_keys.size() && word_keys[added_pos].first == word) {
+        keys.push_back(word_keys[added_pos].second);
+        added_pos++;
+      }
+    }
+    if (keys.size() != old_keys_size) {
+      words.append(word.begin(), word.size());
+      sorted_words.push_back(Word{narrow_cast<uint32>(words.size()), narrow_cast<uint32>(keys.size())});
+    }
+
+    if (use_sorted_word) {
+      pos++;
+    }
+  }
+
+  words.shrink_to_fit();
+  words_ = std::move(words);
+  sorted_words_ = std::move(sorted_words);
+  keys_ = std::move(keys);
+  is_key_removed_ = vector<bool>(keys_.size(), false);
+  removed_key_count_ = 0;
+}
+
 void Hints::add(KeyT key, Slice name) {
   // LOG(ERROR) << "Add " << key << ": " << name;
   auto it = key_to_name_.find(key);
@@ -95,7 +277,7 @@ void Hints::add(KeyT key, Slice name) {
     }
     vector<string> old_transliterations;
     for (auto &old_word : get_words(it->second, false)) {
-      delete_word(old_word, key, word_to_keys_);
+      word_to_keys_.remove(old_word, key);
 
       for (auto &w : get_word_transliterations(old_word, false)) {
         if (w != old_word) {
@@ -104,7 +286,7 @@ void Hints::add(KeyT key, Slice name) {
       }
     }
     for (auto &word : fix_words(old_transliterations)) {
-      delete_word(word, key, translit_word_to_keys_);
+      translit_word_to_keys_.remove(word, key);
     }
   }
   if (name.empty()) {
@@ -117,7 +299,7 @@ void Hints::add(KeyT key, Slice name) {
 
   vector<string> transliterations;
   for (auto &word : get_words(name, false)) {
-    add_word(word, key, word_to_keys_);
+    word_to_keys_.add(word, key);
 
     for (auto &w : get_word_transliterations(word, false)) {
       if (w != word) {
@@ -126,36 +308,61 @@ void Hints::add(KeyT key, Slice name) {
     }
   }
   for (auto &word : fix_words(transliterations)) {
-    add_word(word, key, translit_word_to_keys_);
+    translit_word_to_keys_.add(word, key);
   }
 
   key_to_name_[key] = name.str();
 }
 
+void Hints::add_all(vector<std::pair<KeyT, string>> key_names) {
+  vector<std::pair<string, KeyT>> word_keys;
+  vector<std::pair<string, KeyT>> translit_word_keys;
+  for (auto &key_name : key_names) {
+    auto key = key_name.first;
+    if (key_name.second.empty() || has_key(key)) {
+      // words of the key could have been added earlier in the same call
+      word_to_keys_.add_all(std::move(word_keys));
+      translit_word_to_keys_.add_all(std::move(translit_word_keys));
+      word_keys.clear();
+      translit_word_keys.clear();
+
+      add(key, key_name.second);
+      continue;
+    }
+
+    vector<string> transliterations;
+    for (auto &word : get_words(key_name.second, false)) {
+      for (auto &w : get_word_transliterations(word, false)) {
+        if (w != word) {
+          transliterations.push_back(std::move(w));
+        }
+      }
+      word_keys.emplace_back(std::move(word), key);
+    }
+    for (auto &word : fix_words(transliterations)) {
+      translit_word_keys.emplace_back(std::move(word), key);
+    }
+
+    key_to_name_.emplace(key, std::move(key_name.second));
+  }
+  word_to_keys_.add_all(std::move(word_keys));
+  translit_word_to_keys_.add_all(std::move(translit_word_keys));
+}
+
 void Hints::set_rating(KeyT key, RatingT rating) {
   // LOG(ERROR) << "Set rating " << key << ": " << rating;
   key_to_rating_[key] = rating;
 }
 
-void Hints::add_search_results(vector<KeyT> &results, const string &word,
-                               const std::map<string, vector<KeyT>> &word_to_keys) {
+void Hints::search_word(const string &word, vector<KeyT> &results) const {
+  results.clear();
   LOG(DEBUG) << "Search for word " << word;
-  auto it = word_to_keys.lower_bound(word);
-  while (it != word_to_keys.end() && begins_with(it->first, word)) {
-    results.insert(results.end(), it->second.begin(), it->second.end());
-    ++it;
-  }
-}
-
-vector<Hints::KeyT> Hints::search_word(const string &word) const {
-  vector<KeyT> results;
-  add_search_results(results, word, translit_word_to_keys_);
+  translit_word_to_keys_.search(word, results);
   for (const auto &w : get_word_transliterations(word, true)) {
-    add_search_results(results, w, word_to_keys_);
+    word_to_keys_.search(w, results);
   }
 
   td::unique(results);
-  return results;
 }
 
 std::pair<size_t, vector<Hints::KeyT>> Hints::search(Slice query, int32 limit, bool return_all_for_empty_query) const {
@@ -174,12 +381,14 @@ std::pair<size_t, vector<Hints::KeyT>> Hints::search(Slice query, int32 limit, b
     }
   }
 
+  // the buffer is reused for all words after the first one
+  vector<KeyT> keys;
   for (size_t i = 0; i < words.size(); i++) {
-    vector<KeyT> keys = search_word(words[i]);
     if (i == 0) {
-      results = std::move(keys);
+      search_word(words[i], results);
       continue;
     }
+    search_word(words[i], keys);
 
     // now need to intersect two lists
     size_t results_pos = 0;
@@ -199,12 +408,18 @@ std::pair<size_t, vector<Hints::KeyT>> Hints::search(Slice query, int32 limit, b
     results.resize(new_results_size);
   }
 
+  // find ratings once instead of doing it in every comparison
   auto total_size = results.size();
+  auto rated_results = td::transform(results, [this](KeyT key) { return std::make_pair(get_rating(key), key); });
   if (total_size < static_cast<size_t>(limit)) {
-    std::sort(results.begin(), results.end(), CompareByRating(key_to_rating_));
+    std::sort(rated_results.begin(), rated_results.end());
   } else {
-    std::partial_sort(results.begin(), results.begin() + limit, results.end(), CompareByRating(key_to_rating_));
-    results.resize(limit);
+    std::partial_sort(rated_results.begin(), rated_results.begin() + limit, rated_results.end());
+    rated_results.resize(limit);
+  }
+  results.resize(rated_results.size());
+  for (size_t i = 0; i < rated_results.size(); i++) {
+    results[i] = rated_results[i].second;
   }
 
   return {total_size, std::move(results)};
@@ -226,6 +441,14 @@ std::pair<size_t, vector<Hints::KeyT>> Hints::search_empty(int32 limit) const {
   return search(Slice(), limit, true);
 }
 
+Hints::RatingT Hints::get_rating(KeyT key) const {
+  auto it = key_to_rating_.find(key);
+  if (it == key_to_rating_.end()) {
+    return RatingT();
+  }
+  return it->second;
+}
+
 size_t Hints::size() const {
   return key_to_name_.size();
 }
@@ -23,6 +23,9 @@ class Hints {
  public:
   void add(KeyT key, Slice name);
 
+  // same as add for each pair, but builds the index once
+  void add_all(vector<std::pair<KeyT, string>> key_names);
+
   void remove(KeyT key) {
     add(key, "");
   }
@@ -42,44 +45,64 @@ class Hints {
   size_t size() const;
 
  private:
-  std::map<string, vector<KeyT>> word_to_keys_;
-  std::map<string, vector<KeyT>> translit_word_to_keys_;
-  std::unordered_map<KeyT, string> key_to_name_;
-  std::unordered_map<KeyT, RatingT> key_to_rating_;
+  // Prefix search index of words
+  // Most words are stored in a compact array sorted by word, which is rebuilt after enough changes;
+  // the other words are kept in a small map of recent changes
+  class WordIndex {
+   public:
+    void add(const string &word, KeyT key);
 
-  static void add_word(const string &word, KeyT key, std::map<string, vector<KeyT>> &word_to_keys);
-  static void delete_word(const string &word, KeyT key, std::map<string, vector<KeyT>> &word_to_keys);
+    void add_all(vector<std::pair<string, KeyT>> word_keys);
 
-  static vector<string> fix_words(vector<string> words);
+    void remove(const string &word, KeyT key);
 
-  static vector<string> get_words(Slice name, bool is_search);
+    // appends keys of all words beginning with the prefix
+    void search(const string &prefix, vector<KeyT> &results) const;
 
-  static void add_search_results(vector<KeyT> &results, const string &word,
-                                 const std::map<string, vector<KeyT>> &word_to_keys);
+   private:
+    struct Word {
+      uint32 end_offset;  // in words_
+      uint32 keys_end;    // in keys_
+    };
+    string words_;  // sorted words, stored without separators
+    vector<Word> sorted_words_;
+    vector<KeyT> keys_;
+    vector<bool> is_key_removed_;
+    size_t removed_key_count_ = 0;
 
-  vector<KeyT> search_word(const string &word) const;
+    std::map<string, vector<KeyT>> added_words_;
+    size_t added_key_count_ = 0;
 
-  class CompareByRating {
-    const std::unordered_map<KeyT, RatingT> &key_to_rating_;
+    Slice get_word(size_t pos) const;
 
-    RatingT get_rating(const KeyT &key) const {
-      auto it = key_to_rating_.find(key);
-      if (it == key_to_rating_.end()) {
-        return RatingT();
-      }
-      return it->second;
-    }
+    size_t get_keys_begin(size_t pos) const;
 
-   public:
-    explicit CompareByRating(const std::unordered_map<KeyT, RatingT> &key_to_rating) : key_to_rating_(key_to_rating) {
-    }
-
-    bool operator()(const KeyT &lhs, const KeyT &rhs) const {
-      auto lhs_rating = get_rating(lhs);
-      auto rhs_rating = get_rating(rhs);
-      return lhs_rating < rhs_rating || (lhs_rating == rhs_rating && lhs < rhs);
-    }
+    size_t find_word(Slice word) const;
+
+    bool need_rebuild(size_t change_count) const;
+
+    void rebuild_if_needed();
+
+    void move_added_word_keys(vector<std::pair<string, KeyT>> &word_keys);
+
+    void rebuild();
+
+    // merges the sorted words with the word_keys, sorted by word
+    void rebuild(const vector<std::pair<string, KeyT>> &word_keys);
   };
+
+  WordIndex word_to_keys_;
+  WordIndex translit_word_to_keys_;
+  std::unordered_map<KeyT, string> key_to_name_;
+  std::unordered_map<KeyT, RatingT> key_to_rating_;
+
+  static vector<string> fix_words(vector<string> words);
+
+  static vector<string> get_words(Slice name, bool is_search);
+
+  void search_word(const string &word, vector<KeyT> &results) const;
+
+  RatingT get_rating(KeyT key) const;
 };
 
 }  // namespace td
@@ -6,14 +6,31 @@
 //
 #include "td/utils/JsonBuilder.h"
 
+#include "td/utils/bits.h"
 #include "td/utils/misc.h"
 #include "td/utils/ScopeGuard.h"
 #include "td/utils/SliceBuilder.h"
 
 #include <cstring>
 
+#if defined(__AVX2__)
+#define TD_JSON_USE_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TD_JSON_USE_SSE2 1
+#include <emmintrin.h>
+#endif
+
 namespace td {
 
+static bool is_plain_json_char(unsigned char c) {
+  return c >= 32 && c != '"' && c != '\\';
+}
+
+static bool is_plain_json_ascii_char(unsigned char c) {
+  return c < 128 && is_plain_json_char(c);
+}
+
 StringBuilder &operator<<(StringBuilder &sb, const JsonRawString &val) {
   sb << '"';
   SCOPE_EXIT {
@@ -23,6 +40,19 @@ StringBuilder &operator<<(StringBuilder &sb, const JsonRawString &val) {
   auto len = val.value_.size();
 
   for (size_t pos = 0; pos < len; pos++) {
+    // characters, which don't need to be escaped, are appended at once
+    auto plain_end = pos;
+    while (plain_end < len && is_plain_json_char(static_cast<unsigned char>(s[plain_end]))) {
+      plain_end++;
+    }
+    if (plain_end != pos) {
+      sb << Slice(s + pos, s + plain_end);
+      pos = plain_end;
+      if (pos == len) {
+        break;
+      }
+    }
+
     auto ch = static_cast<unsigned char>(s[pos]);
     switch (ch) {
       case '"':
@@ -67,6 +97,19 @@ StringBuilder &operator<<(StringBuilder &sb, const JsonString &val) {
   auto len = val.str_.size();
 
   for (size_t pos = 0; pos < len; pos++) {
+    // ASCII characters, which don't need to be escaped, are appended at once
+    auto plain_end = pos;
+    while (plain_end < len && is_plain_json_ascii_char(static_cast<unsigned char>(s[plain_end]))) {
+      plain_end++;
+    }
+    if (plain_end != pos) {
+      sb << Slice(s + pos, s + plain_end);
+      pos = plain_end;
+      if (pos == len) {
+        break;
+      }
+    }
+
     auto ch = static_cast<unsigned char>(s[pos]);
     switch (ch) {
       case '"':
@@ -136,24 +179,75 @@ StringBuilder &operator<<(StringBuilder &sb, const JsonString &val) {
   return sb;
 }
 
+// returns position of the first '"' or '\\' in [begin, end) or end if there are no such characters
+static const char *find_json_string_special_char(const char *begin, const char *end) {
+  auto *ptr = begin;
+#if TD_JSON_USE_AVX2
+  const __m256i quotes = _mm256_set1_epi8('"');
+  const __m256i backslashes = _mm256_set1_epi8('\\');
+  while (end - ptr >= 32) {
+    auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr));
+    auto mask = static_cast<uint32>(_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quotes), _mm256_cmpeq_epi8(chunk, backslashes))));
+    if (mask != 0) {
+      return ptr + count_trailing_zeroes_non_zero32(mask);
+    }
+    ptr += 32;
+  }
+#elif TD_JSON_USE_SSE2
+  const __m128i quotes = _mm_set1_epi8('"');
+  const __m128i backslashes = _mm_set1_epi8('\\');
+  while (end - ptr >= 16) {
+    auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+    auto mask = static_cast<uint32>(
+        _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quotes), _mm_cmpeq_epi8(chunk, backslashes))));
+    if (mask != 0) {
+      return ptr + count_trailing_zeroes_non_zero32(mask);
+    }
+    ptr += 16;
+  }
+#endif
+  while (ptr < end && *ptr != '"' && *ptr != '\\') {
+    ptr++;
+  }
+  return ptr;
+}
+
+// returns position of the closing '"' or nullptr if the string isn't terminated
+static const char *find_json_string_end(const char *begin, const char *end, bool &has_escapes) {
+  has_escapes = false;
+  auto *ptr = find_json_string_special_char(begin, end);
+  while (ptr < end && *ptr == '\\') {
+    has_escapes = true;
+    ptr += 2;
+    if (ptr >= end) {
+      return nullptr;
+    }
+    ptr = find_json_string_special_char(ptr, end);
+  }
+  if (ptr >= end) {
+    return nullptr;
+  }
+  return ptr;
+}
+
 Result<MutableSlice> json_string_decode(Parser &parser) {
   if (!parser.try_skip('"')) {
     return Status::Error("Opening '\"' expected");
   }
   auto *cur_src = parser.data().data();
   auto *end_src = parser.data().end();
-  auto *end = cur_src;
-  while (end < end_src && end[0] != '"') {
-    if (end[0] == '\\') {
-      end++;
-    }
-    end++;
-  }
-  if (end >= end_src) {
+  bool has_escapes;
+  auto *end = find_json_string_end(cur_src, end_src, has_escapes);
+  if (end == nullptr) {
     return Status::Error("Closing '\"' not found");
   }
-  parser.advance(end + 1 - cur_src);
-  end_src = end;
+  auto length = static_cast<size_t>(end - cur_src);
+  parser.advance(length + 1);
+  if (!has_escapes) {
+    return MutableSlice(cur_src, length);
+  }
+  end_src = cur_src + length;
 
   auto *cur_dest = cur_src;
   auto *begin_dest = cur_src;
@@ -261,18 +355,17 @@ Status json_string_skip(Parser &parser) {
   auto *begin_src = parser.data().data();
   auto *cur_src = begin_src;
   auto *end_src = parser.data().end();
-  auto *end = cur_src;
-  while (end < end_src && *end != '"') {
-    if (*end == '\\') {
-      end++;
-    }
-    end++;
-  }
-  if (end >= end_src) {
+  bool has_escapes;
+  auto *end = find_json_string_end(cur_src, end_src, has_escapes);
+  if (end == nullptr) {
     return Status::Error("Closing '\"' not found");
   }
-  parser.advance(end + 1 - cur_src);
-  end_src = end;
+  auto length = static_cast<size_t>(end - cur_src);
+  parser.advance(length + 1);
+  if (!has_escapes) {
+    return Status::OK();
+  }
+  end_src = cur_src + length;
 
   while (cur_src != end_src) {
     auto *slash = static_cast<char *>(std::memchr(cur_src, '\\', end_src - cur_src));
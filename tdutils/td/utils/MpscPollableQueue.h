@@ -15,6 +15,7 @@
 #include "td/utils/SpinLock.h"
 
 #include <utility>
+#include <vector>
 
 namespace td {
 // interface like in PollableQueue
@@ -61,6 +62,24 @@ class MpscPollableQueue {
       event_fd_.release();
     }
   }
+  // puts all values at once, waking up the reader at most once
+  // values are moved out of the vector, but its memory can be reused
+  void writer_put_batch(std::vector<ValueType> &values) {
+    auto guard = lock_.lock();
+    if (writer_vector_.empty()) {
+      std::swap(writer_vector_, values);
+    } else {
+      for (auto &value : values) {
+        writer_vector_.push_back(std::move(value));
+      }
+      values.clear();
+    }
+    if (wait_event_fd_) {
+      wait_event_fd_ = false;
+      guard.reset();
+      event_fd_.release();
+    }
+  }
   EventFd &reader_get_event_fd() {
     return event_fd_;
   }
@@ -121,6 +140,10 @@ class MpscPollableQueue {
     UNREACHABLE();
   }
 
+  void writer_put_batch(std::vector<ValueType> &values) {
+    UNREACHABLE();
+  }
+
   void writer_flush() {
     UNREACHABLE();
   }
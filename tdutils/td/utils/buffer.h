@@ -24,6 +24,7 @@ struct BufferRaw {
   // Constant after first reader is created.
   // May be change by writer before it.
   // So writer may do prepends till there is no reader created.
+  // After that, memory before begin_ is still unused and can be given only to a slice, which starts at begin_.
   size_t begin_ = 0;
 
   // Write by writer.
@@ -215,6 +216,20 @@ class BufferSlice {
     }
   }
 
+  // extends the slice to the left by size bytes, if it starts at the beginning of the buffer and the buffer has
+  // enough free space before it; returns the memory for the new bytes or an empty slice, if it isn't possible
+  // must be called by the owner of the buffer writer before other slices of the buffer are passed to other threads
+  MutableSlice prepend_inplace(size_t size) {
+    if (is_null() || size == 0 || begin_ != buffer_->begin_ || begin_ < size) {
+      return MutableSlice();
+    }
+    buffer_->begin_ -= size;
+    debug_untrack();
+    begin_ -= size;
+    debug_track();
+    return MutableSlice(buffer_->data_ + begin_, size);
+  }
+
   BufferSlice from_slice(Slice slice) const {
     auto res = BufferSlice(BufferAllocator::create_reader(buffer_));
     res.debug_untrack();
@@ -662,6 +677,33 @@ class ChainBufferReader {
     return res;
   }
 
+  // same as move_as_buffer_slice, but if the data ends with a buffer, which was created by ChainBufferWriter::reserve,
+  // then only the data before the buffer is copied to the free space in front of it
+  BufferSlice move_as_joined_buffer_slice() {
+    if (begin_.head().size() < size()) {
+      auto save_size = size();
+      auto it = begin_.clone();
+      size_t prefix_size = 0;
+      while (true) {
+        auto ready = it.prepare_read();
+        CHECK(!ready.empty());
+        if (prefix_size + ready.size() >= save_size) {
+          break;
+        }
+        prefix_size += ready.size();
+        it.confirm_read(ready.size());
+      }
+      auto res = it.read_as_buffer_slice(save_size - prefix_size);
+      auto prefix = res.prepend_inplace(prefix_size);
+      if (!prefix.empty()) {
+        advance(prefix_size, prefix);
+        *this = ChainBufferReader();
+        return res;
+      }
+    }
+    return move_as_buffer_slice();
+  }
+
   BufferSlice read_as_buffer_slice(size_t limit = std::numeric_limits<size_t>::max()) {
     return begin_.read_as_buffer_slice(min(limit, size()));
   }
@@ -719,6 +761,16 @@ class ChainBufferWriter {
     tail_ = std::move(new_tail);  // release tail_
     return writer_.prepare_append();
   }
+  // the next size bytes will be appended to a new buffer with prepend_size bytes of free space before them,
+  // so ChainBufferReader::move_as_joined_buffer_slice can add up to prepend_size preceding bytes without copying them
+  void reserve(size_t size, size_t prepend_size) {
+    CHECK(!empty());
+    BufferWriter new_writer(0, prepend_size, size);
+    auto new_tail = ChainBufferNodeAllocator::create(new_writer.as_buffer_slice(), true);
+    tail_->next_ = ChainBufferNodeAllocator::clone(new_tail);
+    writer_ = std::move(new_writer);
+    tail_ = std::move(new_tail);  // release tail_
+  }
   void confirm_append(size_t size) {
     CHECK(!empty());
     writer_.confirm_append(size);
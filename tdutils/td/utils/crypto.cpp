@@ -6,6 +6,7 @@
 //
 #include "td/utils/crypto.h"
 
+#include "td/utils/algorithm.h"
 #include "td/utils/as.h"
 #include "td/utils/BigNum.h"
 #include "td/utils/bits.h"
@@ -43,6 +44,14 @@
 #include <zlib.h>
 #endif
 
+#if TD_HAVE_OPENSSL && (TD_GCC || TD_CLANG) && (defined(__x86_64__) || defined(__i386__))
+#define TD_HAVE_X86_AES_DISPATCH 1
+#if (TD_GCC && __GNUC__ >= 9) || (TD_CLANG && __clang_major__ >= 12)
+#define TD_HAVE_X86_VAES_DISPATCH 1
+#endif
+#include <immintrin.h>
+#endif
+
 #if TD_HAVE_CRC32C
 #include "crc32c/crc32c.h"
 #endif
@@ -535,7 +544,355 @@ void AesIgeState::decrypt(Slice from, MutableSlice to) {
   impl_->decrypt(from, to);
 }
 
+#if TD_HAVE_X86_AES_DISPATCH
+namespace {
+
+#define TD_TARGET_AES __attribute__((target("sse2,aes")))
+
+// all blocks must be kept in registers, so loops over messages and AES rounds must be unrolled
+#if TD_CLANG
+#define TD_AES_UNROLL_LOOP _Pragma("unroll")
+#elif __GNUC__ >= 8
+#define TD_AES_UNROLL_LOOP _Pragma("GCC unroll 16")
+#else
+#define TD_AES_UNROLL_LOOP
+#endif
+
+// state of one message in aes_ige_*_multiple
+struct AesIgeLane {
+  AesBlock round_keys[15];
+  AesBlock out_iv;  // previous output block
+  AesBlock in_iv;   // previous input block
+  const uint8 *in;
+  uint8 *out;
+  size_t block_count;
+  MutableSlice iv;
+};
+
+TD_TARGET_AES __m128i aes_256_xor_shifted(__m128i a) {
+  a = _mm_xor_si128(a, _mm_slli_si128(a, 4));
+  a = _mm_xor_si128(a, _mm_slli_si128(a, 4));
+  return _mm_xor_si128(a, _mm_slli_si128(a, 4));
+}
+
+// computes the next two round keys from the previous two
+template <int rcon>
+TD_TARGET_AES void aes_256_expand_key_step(__m128i *k) {
+  k[2] = _mm_xor_si128(aes_256_xor_shifted(k[0]), _mm_shuffle_epi32(_mm_aeskeygenassist_si128(k[1], rcon), 0xff));
+  k[3] = _mm_xor_si128(aes_256_xor_shifted(k[1]), _mm_shuffle_epi32(_mm_aeskeygenassist_si128(k[2], 0), 0xaa));
+}
+
+TD_TARGET_AES void aes_256_expand_key(const uint8 *key, bool encrypt, AesBlock *round_keys) {
+  __m128i k[15];
+  k[0] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(key));
+  k[1] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(key + 16));
+  aes_256_expand_key_step<0x01>(k);
+  aes_256_expand_key_step<0x02>(k + 2);
+  aes_256_expand_key_step<0x04>(k + 4);
+  aes_256_expand_key_step<0x08>(k + 6);
+  aes_256_expand_key_step<0x10>(k + 8);
+  aes_256_expand_key_step<0x20>(k + 10);
+  k[14] = _mm_xor_si128(aes_256_xor_shifted(k[12]), _mm_shuffle_epi32(_mm_aeskeygenassist_si128(k[13], 0x40), 0xff));
+
+  for (int i = 0; i < 15; i++) {
+    __m128i round_key;
+    if (encrypt) {
+      round_key = k[i];
+    } else if (i == 0 || i == 14) {
+      round_key = k[14 - i];
+    } else {
+      round_key = _mm_aesimc_si128(k[14 - i]);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(round_keys[i].raw()), round_key);
+  }
+}
+
+TD_TARGET_AES __m128i load_block(const AesBlock &block) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(block.raw()));
+}
+
+TD_TARGET_AES void store_block(AesBlock &block, __m128i value) {
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(block.raw()), value);
+}
+
+// processes next block_count blocks of N messages; blocks of different messages are independent,
+// so the CPU can execute their AES rounds in parallel
+template <size_t N, bool is_encrypt>
+TD_TARGET_AES void aes_ige_run_aes_ni(AesIgeLane *const *lanes, size_t block_count) {
+  __m128i out_iv[N];
+  __m128i in_iv[N];
+  TD_AES_UNROLL_LOOP
+  for (size_t k = 0; k < N; k++) {
+    out_iv[k] = load_block(lanes[k]->out_iv);
+    in_iv[k] = load_block(lanes[k]->in_iv);
+  }
+
+  for (size_t i = 0; i < block_count; i++) {
+    __m128i data[N];
+    __m128i x[N];
+    TD_AES_UNROLL_LOOP
+    for (size_t k = 0; k < N; k++) {
+      data[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lanes[k]->in + i * AES_BLOCK_SIZE));
+      x[k] = _mm_xor_si128(_mm_xor_si128(data[k], out_iv[k]), load_block(lanes[k]->round_keys[0]));
+    }
+    TD_AES_UNROLL_LOOP
+    for (size_t r = 1; r < 14; r++) {
+      TD_AES_UNROLL_LOOP
+      for (size_t k = 0; k < N; k++) {
+        if (is_encrypt) {
+          x[k] = _mm_aesenc_si128(x[k], load_block(lanes[k]->round_keys[r]));
+        } else {
+          x[k] = _mm_aesdec_si128(x[k], load_block(lanes[k]->round_keys[r]));
+        }
+      }
+    }
+    TD_AES_UNROLL_LOOP
+    for (size_t k = 0; k < N; k++) {
+      if (is_encrypt) {
+        x[k] = _mm_aesenclast_si128(x[k], load_block(lanes[k]->round_keys[14]));
+      } else {
+        x[k] = _mm_aesdeclast_si128(x[k], load_block(lanes[k]->round_keys[14]));
+      }
+      out_iv[k] = _mm_xor_si128(x[k], in_iv[k]);
+      in_iv[k] = data[k];
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes[k]->out + i * AES_BLOCK_SIZE), out_iv[k]);
+    }
+  }
+
+  TD_AES_UNROLL_LOOP
+  for (size_t k = 0; k < N; k++) {
+    store_block(lanes[k]->out_iv, out_iv[k]);
+    store_block(lanes[k]->in_iv, in_iv[k]);
+    lanes[k]->in += block_count * AES_BLOCK_SIZE;
+    lanes[k]->out += block_count * AES_BLOCK_SIZE;
+    lanes[k]->block_count -= block_count;
+  }
+}
+
+#if TD_HAVE_X86_VAES_DISPATCH
+#define TD_TARGET_VAES __attribute__((target("sse2,aes,avx2,vaes")))
+
+TD_TARGET_VAES __m256i load_block_pair(const uint8 *first, const uint8 *second) {
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(first))),
+                                 _mm_loadu_si128(reinterpret_cast<const __m128i *>(second)), 1);
+}
+
+// the same as aes_ige_run_aes_ni, but AES rounds are applied to blocks of two messages by one instruction
+template <size_t N, bool is_encrypt>
+TD_TARGET_VAES void aes_ige_run_vaes(AesIgeLane *const *lanes, size_t block_count) {
+  static_assert(N % 2 == 0, "");
+  constexpr size_t M = N / 2;
+  __m256i round_keys[M][15];
+  __m256i out_iv[M];
+  __m256i in_iv[M];
+  TD_AES_UNROLL_LOOP
+  for (size_t j = 0; j < M; j++) {
+    auto first = lanes[2 * j];
+    auto second = lanes[2 * j + 1];
+    TD_AES_UNROLL_LOOP
+    for (size_t r = 0; r < 15; r++) {
+      round_keys[j][r] = load_block_pair(first->round_keys[r].raw(), second->round_keys[r].raw());
+    }
+    out_iv[j] = load_block_pair(first->out_iv.raw(), second->out_iv.raw());
+    in_iv[j] = load_block_pair(first->in_iv.raw(), second->in_iv.raw());
+  }
+
+  for (size_t i = 0; i < block_count; i++) {
+    auto offset = i * AES_BLOCK_SIZE;
+    __m256i data[M];
+    __m256i x[M];
+    TD_AES_UNROLL_LOOP
+    for (size_t j = 0; j < M; j++) {
+      data[j] = load_block_pair(lanes[2 * j]->in + offset, lanes[2 * j + 1]->in + offset);
+      x[j] = _mm256_xor_si256(_mm256_xor_si256(data[j], out_iv[j]), round_keys[j][0]);
+    }
+    TD_AES_UNROLL_LOOP
+    for (size_t r = 1; r < 14; r++) {
+      TD_AES_UNROLL_LOOP
+      for (size_t j = 0; j < M; j++) {
+        if (is_encrypt) {
+          x[j] = _mm256_aesenc_epi128(x[j], round_keys[j][r]);
+        } else {
+          x[j] = _mm256_aesdec_epi128(x[j], round_keys[j][r]);
+        }
+      }
+    }
+    TD_AES_UNROLL_LOOP
+    for (size_t j = 0; j < M; j++) {
+      if (is_encrypt) {
+        x[j] = _mm256_aesenclast_epi128(x[j], round_keys[j][14]);
+      } else {
+        x[j] = _mm256_aesdeclast_epi128(x[j], round_keys[j][14]);
+      }
+      out_iv[j] = _mm256_xor_si256(x[j], in_iv[j]);
+      in_iv[j] = data[j];
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes[2 * j]->out + offset), _mm256_castsi256_si128(out_iv[j]));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes[2 * j + 1]->out + offset),
+                       _mm256_extracti128_si256(out_iv[j], 1));
+    }
+  }
+
+  TD_AES_UNROLL_LOOP
+  for (size_t j = 0; j < M; j++) {
+    TD_AES_UNROLL_LOOP
+    for (size_t k = 0; k < 2; k++) {
+      auto lane = lanes[2 * j + k];
+      auto lane_out_iv = k == 0 ? _mm256_castsi256_si128(out_iv[j]) : _mm256_extracti128_si256(out_iv[j], 1);
+      auto lane_in_iv = k == 0 ? _mm256_castsi256_si128(in_iv[j]) : _mm256_extracti128_si256(in_iv[j], 1);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(lane->out_iv.raw()), lane_out_iv);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(lane->in_iv.raw()), lane_in_iv);
+      lane->in += block_count * AES_BLOCK_SIZE;
+      lane->out += block_count * AES_BLOCK_SIZE;
+      lane->block_count -= block_count;
+    }
+  }
+}
+#endif
+
+enum class AesIgeImplementation : int32 { Evp, AesNi, Vaes };
+
+AesIgeImplementation get_aes_ige_implementation() {
+  static const AesIgeImplementation implementation = [] {
+    __builtin_cpu_init();
+#if TD_HAVE_X86_VAES_DISPATCH
+    if (__builtin_cpu_supports("vaes") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("aes")) {
+      return AesIgeImplementation::Vaes;
+    }
+#endif
+    if (__builtin_cpu_supports("aes")) {
+      return AesIgeImplementation::AesNi;
+    }
+    return AesIgeImplementation::Evp;
+  }();
+  return implementation;
+}
+
+template <bool is_encrypt>
+void aes_ige_run(AesIgeImplementation implementation, AesIgeLane *const *lanes, size_t lane_count,
+                 size_t block_count) {
+#if TD_HAVE_X86_VAES_DISPATCH
+  if (implementation == AesIgeImplementation::Vaes) {
+    switch (lane_count) {
+      case 8:
+        return aes_ige_run_vaes<8, is_encrypt>(lanes, block_count);
+      case 4:
+        return aes_ige_run_vaes<4, is_encrypt>(lanes, block_count);
+      case 2:
+        return aes_ige_run_vaes<2, is_encrypt>(lanes, block_count);
+      default:
+        break;
+    }
+  }
+#endif
+  switch (lane_count) {
+    case 8:
+      return aes_ige_run_aes_ni<8, is_encrypt>(lanes, block_count);
+    case 4:
+      return aes_ige_run_aes_ni<4, is_encrypt>(lanes, block_count);
+    case 2:
+      return aes_ige_run_aes_ni<2, is_encrypt>(lanes, block_count);
+    case 1:
+      return aes_ige_run_aes_ni<1, is_encrypt>(lanes, block_count);
+    default:
+      UNREACHABLE();
+  }
+}
+
+template <bool is_encrypt>
+void init_aes_ige_lane(AesIgeLane &lane, const AesIgeData &message) {
+  CHECK(message.key.size() == 32);
+  CHECK(message.iv.size() == 32);
+  CHECK(message.from.size() % AES_BLOCK_SIZE == 0);
+  CHECK(message.to.size() >= message.from.size());
+  aes_256_expand_key(message.key.ubegin(), is_encrypt, lane.round_keys);
+  if (is_encrypt) {
+    lane.out_iv.load(message.iv.ubegin());
+    lane.in_iv.load(message.iv.ubegin() + AES_BLOCK_SIZE);
+  } else {
+    lane.in_iv.load(message.iv.ubegin());
+    lane.out_iv.load(message.iv.ubegin() + AES_BLOCK_SIZE);
+  }
+  lane.in = message.from.ubegin();
+  lane.out = message.to.ubegin();
+  lane.block_count = message.from.size() / AES_BLOCK_SIZE;
+  lane.iv = message.iv;
+}
+
+template <bool is_encrypt>
+void finish_aes_ige_lane(AesIgeLane &lane) {
+  if (is_encrypt) {
+    lane.out_iv.store(lane.iv.ubegin());
+    lane.in_iv.store(lane.iv.ubegin() + AES_BLOCK_SIZE);
+  } else {
+    lane.in_iv.store(lane.iv.ubegin());
+    lane.out_iv.store(lane.iv.ubegin() + AES_BLOCK_SIZE);
+  }
+}
+
+template <bool is_encrypt>
+void aes_ige_crypt(AesIgeImplementation implementation, const AesIgeData &message) {
+  AesIgeLane lane;
+  init_aes_ige_lane<is_encrypt>(lane, message);
+  if (lane.block_count != 0) {
+    AesIgeLane *lanes[] = {&lane};
+    aes_ige_run<is_encrypt>(implementation, lanes, 1, lane.block_count);
+  }
+  finish_aes_ige_lane<is_encrypt>(lane);
+}
+
+template <bool is_encrypt>
+void aes_ige_crypt_multiple(AesIgeImplementation implementation, Span<AesIgeData> data) {
+  vector<AesIgeLane> lanes(data.size());
+  for (size_t i = 0; i < data.size(); i++) {
+    init_aes_ige_lane<is_encrypt>(lanes[i], data[i]);
+  }
+
+  // there are not enough registers to process more messages simultaneously
+  const size_t max_lane_count = 8;
+  vector<AesIgeLane *> active_lanes;
+  size_t next_lane = 0;
+  while (true) {
+    td::remove_if(active_lanes, [](AesIgeLane *lane) {
+      if (lane->block_count == 0) {
+        finish_aes_ige_lane<is_encrypt>(*lane);
+        return true;
+      }
+      return false;
+    });
+    while (active_lanes.size() < max_lane_count && next_lane < lanes.size()) {
+      auto &lane = lanes[next_lane++];
+      if (lane.block_count == 0) {
+        finish_aes_ige_lane<is_encrypt>(lane);
+      } else {
+        active_lanes.push_back(&lane);
+      }
+    }
+    if (active_lanes.empty()) {
+      break;
+    }
+
+    size_t lane_count = 1;
+    while (lane_count * 2 <= active_lanes.size()) {
+      lane_count *= 2;
+    }
+    size_t block_count = active_lanes[0]->block_count;
+    for (size_t i = 1; i < lane_count; i++) {
+      block_count = td::min(block_count, active_lanes[i]->block_count);
+    }
+    aes_ige_run<is_encrypt>(implementation, active_lanes.data(), lane_count, block_count);
+  }
+}
+
+}  // namespace
+#endif
+
 void aes_ige_encrypt(Slice aes_key, MutableSlice aes_iv, Slice from, MutableSlice to) {
+#if TD_HAVE_X86_AES_DISPATCH
+  auto implementation = get_aes_ige_implementation();
+  if (implementation != AesIgeImplementation::Evp) {
+    return aes_ige_crypt<true>(implementation, AesIgeData{aes_key, aes_iv, from, to});
+  }
+#endif
   AesIgeStateImpl state;
   state.init(aes_key, aes_iv, true);
   state.encrypt(from, to);
@@ -543,12 +900,42 @@ void aes_ige_encrypt(Slice aes_key, MutableSlice aes_iv, Slice from, MutableSlic
 }
 
 void aes_ige_decrypt(Slice aes_key, MutableSlice aes_iv, Slice from, MutableSlice to) {
+#if TD_HAVE_X86_AES_DISPATCH
+  auto implementation = get_aes_ige_implementation();
+  if (implementation != AesIgeImplementation::Evp) {
+    return aes_ige_crypt<false>(implementation, AesIgeData{aes_key, aes_iv, from, to});
+  }
+#endif
   AesIgeStateImpl state;
   state.init(aes_key, aes_iv, false);
   state.decrypt(from, to);
   state.get_iv(aes_iv);
 }
 
+void aes_ige_encrypt_multiple(Span<AesIgeData> data) {
+#if TD_HAVE_X86_AES_DISPATCH
+  auto implementation = get_aes_ige_implementation();
+  if (implementation != AesIgeImplementation::Evp) {
+    return aes_ige_crypt_multiple<true>(implementation, data);
+  }
+#endif
+  for (auto &message : data) {
+    aes_ige_encrypt(message.key, message.iv, message.from, message.to);
+  }
+}
+
+void aes_ige_decrypt_multiple(Span<AesIgeData> data) {
+#if TD_HAVE_X86_AES_DISPATCH
+  auto implementation = get_aes_ige_implementation();
+  if (implementation != AesIgeImplementation::Evp) {
+    return aes_ige_crypt_multiple<false>(implementation, data);
+  }
+#endif
+  for (auto &message : data) {
+    aes_ige_decrypt(message.key, message.iv, message.from, message.to);
+  }
+}
+
 void aes_cbc_encrypt(Slice aes_key, MutableSlice aes_iv, Slice from, MutableSlice to) {
   CHECK(from.size() <= to.size());
   CHECK(from.size() % 16 == 0);
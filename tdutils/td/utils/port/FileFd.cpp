@@ -619,6 +619,18 @@ Status FileFd::sync() {
   return Status::OK();
 }
 
+Status FileFd::sync_data() {
+  CHECK(!empty());
+#if TD_LINUX || TD_ANDROID || TD_FREEBSD
+  if (detail::skip_eintr([&] { return fdatasync(get_native_fd().fd()); }) != 0) {
+    return OS_ERROR("Sync data failed");
+  }
+  return Status::OK();
+#else
+  return sync();
+#endif
+}
+
 Status FileFd::seek(int64 position) {
   CHECK(!empty());
 #if TD_PORT_POSIX
@@ -63,6 +63,9 @@ class FileFd {
 
   Status sync() TD_WARN_UNUSED_RESULT;
 
+  // syncs file data and only metadata needed to read the data; falls back to sync() if unsupported
+  Status sync_data() TD_WARN_UNUSED_RESULT;
+
   Status seek(int64 position) TD_WARN_UNUSED_RESULT;
 
   Status truncate_to_current_position(int64 current_position) TD_WARN_UNUSED_RESULT;
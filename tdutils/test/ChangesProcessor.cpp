@@ -0,0 +1,81 @@
+//
+// Copyright Aliaksei Levin (levlam@telegram.org), Arseny Smirnov (arseny30@gmail.com) 2014-2021
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "td/utils/ChangesProcessor.h"
+#include "td/utils/common.h"
+#include "td/utils/Random.h"
+#include "td/utils/Span.h"
+#include "td/utils/tests.h"
+
+#include <algorithm>
+#include <utility>
+
+TEST(ChangesProcessor, random) {
+  int n = 100000;
+  int d = 100;
+  td::ChangesProcessor<int> processor;
+  td::vector<std::pair<td::ChangesProcessor<int>::Id, int>> changes;
+  for (int i = 0; i < n; i++) {
+    changes.emplace_back(processor.add(i), i);
+  }
+  ASSERT_TRUE(!processor.empty());
+
+  // changes are finished in random order within blocks of d changes
+  td::Random::Xorshift128plus rnd(123);
+  for (int i = 0; i < n; i += d) {
+    td::random_shuffle(td::as_mutable_span(changes).substr(i, d), rnd);
+  }
+
+  int next_value = 0;
+  for (auto &change : changes) {
+    processor.finish(change.first, [&](int value) {
+      ASSERT_EQ(next_value, value);
+      next_value++;
+    });
+    ASSERT_TRUE(next_value <= change.second + d);
+  }
+  ASSERT_EQ(n, next_value);
+  ASSERT_TRUE(processor.empty());
+}
+
+TEST(ChangesProcessor, finish_all) {
+  td::ChangesProcessor<td::string> processor;
+  td::vector<td::string> result;
+  auto on_change = [&](td::string value) {
+    result.push_back(std::move(value));
+  };
+
+  auto first_id = processor.add(td::string("a"));
+  auto second_id = processor.add(td::string("b"));
+  auto third_id = processor.add(td::string("c"));
+  processor.finish(second_id, on_change);
+  ASSERT_TRUE(result.empty());
+  processor.get(first_id) = "A";
+  processor.get(third_id) = "C";
+  processor.finish(first_id, on_change);
+  ASSERT_EQ(2u, result.size());
+  ASSERT_EQ("A", result[0]);
+  ASSERT_EQ("b", result[1]);
+  ASSERT_TRUE(!processor.empty());
+
+  auto fourth_id = processor.add(td::string("d"));
+  processor.finish_all(on_change);
+  ASSERT_EQ(4u, result.size());
+  ASSERT_EQ("C", result[2]);
+  ASSERT_EQ("d", result[3]);
+  ASSERT_TRUE(processor.empty());
+
+  // late finishes of already processed changes are ignored
+  processor.finish(fourth_id, on_change);
+  ASSERT_EQ(4u, result.size());
+
+  auto fifth_id = processor.add(td::string("e"));
+  ASSERT_TRUE(fifth_id > fourth_id);
+  processor.finish(fifth_id, on_change);
+  ASSERT_EQ(5u, result.size());
+  ASSERT_EQ("e", result[4]);
+  ASSERT_TRUE(processor.empty());
+}
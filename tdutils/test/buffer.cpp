@@ -54,3 +54,36 @@ TEST(Buffer, buffer_builder) {
     ASSERT_EQ(builder.extract().as_slice(), str);
   }
 }
+
+TEST(Buffer, chain_buffer_reserve) {
+  for (int test = 0; test < 100; test++) {
+    auto str = td::rand_string('a', 'z', td::Random::fast(2, 100000));
+    auto prefix_size = static_cast<size_t>(td::Random::fast(1, static_cast<int>(str.size()) - 1));
+    auto is_reserved = td::Random::fast_bool();
+
+    td::ChainBufferWriter writer;
+    auto reader = writer.extract_reader();
+    td::Slice data = str;
+    for (auto &part : td::rand_split(data.substr(0, prefix_size))) {
+      writer.append(part);
+    }
+    const char *reserved_data = nullptr;
+    if (is_reserved) {
+      writer.reserve(str.size() - prefix_size, prefix_size + td::Random::fast(0, 10));
+      reserved_data = writer.prepare_append_inplace().data();
+    }
+    for (auto &part : td::rand_split(data.substr(prefix_size))) {
+      writer.append(part);
+    }
+    auto suffix = td::rand_string('a', 'z', td::Random::fast(1, 100));
+    writer.append(suffix);
+    reader.sync_with_writer();
+
+    auto head = reader.cut_head(str.size()).move_as_joined_buffer_slice();
+    ASSERT_EQ(str, head.as_slice());
+    ASSERT_EQ(suffix, reader.move_as_joined_buffer_slice().as_slice());
+    if (is_reserved) {
+      ASSERT_TRUE(head.as_slice().data() + prefix_size == reserved_data);
+    }
+  }
+}
@@ -160,6 +160,53 @@ TEST(Crypto, AesIgeState) {
   }
 }
 
+TEST(Crypto, AesIgeMultiple) {
+  td::Random::Xorshift128plus rnd(123);
+  for (int message_count : {1, 2, 3, 7, 8, 16, 21, 40}) {
+    td::vector<td::string> keys(message_count, td::string(32, '\0'));
+    td::vector<td::string> ivs(message_count, td::string(32, '\0'));
+    td::vector<td::string> plaintexts(message_count);
+    for (int i = 0; i < message_count; i++) {
+      rnd.bytes(keys[i]);
+      rnd.bytes(ivs[i]);
+      plaintexts[i] = td::string(16 * rnd.fast(0, i % 3 == 0 ? 300 : 20), '\0');
+      rnd.bytes(plaintexts[i]);
+    }
+
+    auto encrypted = plaintexts;
+    auto encrypt_ivs = ivs;
+    td::vector<td::AesIgeData> data(message_count);
+    for (int i = 0; i < message_count; i++) {
+      data[i] = {keys[i], encrypt_ivs[i], encrypted[i], encrypted[i]};
+    }
+    td::aes_ige_encrypt_multiple(data);
+
+    auto decrypted = encrypted;
+    auto decrypt_ivs = ivs;
+    for (int i = 0; i < message_count; i++) {
+      data[i] = {keys[i], decrypt_ivs[i], decrypted[i], decrypted[i]};
+    }
+    td::aes_ige_decrypt_multiple(data);
+
+    for (int i = 0; i < message_count; i++) {
+      td::AesIgeState state;
+      state.init(keys[i], ivs[i], true);
+      td::string expected(plaintexts[i].size(), '\0');
+      state.encrypt(plaintexts[i], expected);
+      ASSERT_TRUE(expected == encrypted[i]);
+      ASSERT_TRUE(plaintexts[i] == decrypted[i]);
+
+      auto iv = ivs[i];
+      td::string u(plaintexts[i].size(), '\0');
+      td::aes_ige_encrypt(keys[i], iv, plaintexts[i], u);
+      ASSERT_TRUE(iv == encrypt_ivs[i]);
+      iv = ivs[i];
+      td::aes_ige_decrypt(keys[i], iv, u, u);
+      ASSERT_TRUE(iv == decrypt_ivs[i]);
+    }
+  }
+}
+
 TEST(Crypto, AesCbcState) {
   td::vector<td::uint32> answers1{0u, 3617355989u, 3449188102u, 186999968u, 4244808847u, 2626031206u};
 
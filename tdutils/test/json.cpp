@@ -88,3 +88,24 @@ TEST(JSON, kphp) {
       "{\"keyboard\":[[\"\\u2022 abcdefg\"],[\"\\u2022 hijklmnop\"],[\"\\u2022 "
       "qrstuvwxyz\"]],\"one_time_keyboard\":true}");
 }
+
+TEST(JSON, long_strings) {
+  for (size_t length = 0; length < 100; length++) {
+    td::string plain(length, 'a');
+    decode_encode("\"" + plain + "\"");
+    decode_encode("[\"" + plain + "\",\"" + plain + "\"]");
+    for (size_t pos = 0; pos <= length; pos++) {
+      auto escaped = plain;
+      escaped.insert(pos, "\\\"");
+      decode_encode("\"" + escaped + "\"");
+      escaped = plain;
+      escaped.insert(pos, "\\\\");
+      decode_encode("{\"" + escaped + "\":\"" + escaped + "\"}");
+
+      auto unterminated = "\"" + plain + "\\";
+      ASSERT_TRUE(td::json_decode(unterminated).is_error());
+      unterminated = "[\"" + escaped.substr(0, pos) + "\\\"]";
+      ASSERT_TRUE(td::json_decode(unterminated).is_error());
+    }
+  }
+}
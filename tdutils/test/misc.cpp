@@ -16,6 +16,7 @@
 #include "td/utils/Hash.h"
 #include "td/utils/HashMap.h"
 #include "td/utils/HashSet.h"
+#include "td/utils/Hints.h"
 #include "td/utils/invoke.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
@@ -612,6 +613,90 @@ TEST(Misc, translit) {
   test_translit("yo", {"e", "yo", "е", "ио"}, false);
 }
 
+TEST(Misc, Hints) {
+  // words consist of digits, which have no transliterations
+  td::Random::Xorshift128plus rnd(123);
+  auto gen_word = [&] {
+    td::string word;
+    int length = rnd.fast(1, 3);
+    for (int i = 0; i < length; i++) {
+      word += static_cast<char>('0' + rnd.fast(0, 3));
+    }
+    return word;
+  };
+
+  td::Hints hints;
+  std::unordered_map<td::int64, td::vector<td::string>> key_to_words;
+  for (int t = 0; t < 100000; t++) {
+    if (rnd.fast(0, 500) == 0) {
+      // both new and already added keys are added at once; some of them are removed or added twice
+      td::vector<std::pair<td::int64, td::string>> key_names;
+      int first_key = rnd.fast(0, 999);
+      int key_count = rnd.fast(1, 1000);
+      for (int i = 0; i < key_count; i++) {
+        auto key = static_cast<td::int64>((first_key + i) % 1000 + 1);
+        if (rnd.fast(0, 100) == 0) {
+          key = static_cast<td::int64>(first_key + 1);
+        }
+        td::vector<td::string> words;
+        int word_count = rnd.fast(0, 2);
+        for (int j = 0; j < word_count; j++) {
+          words.push_back(gen_word());
+        }
+        key_names.emplace_back(key, td::implode(words, ' '));
+        if (words.empty()) {
+          key_to_words.erase(key);
+        } else {
+          key_to_words[key] = std::move(words);
+        }
+      }
+      hints.add_all(std::move(key_names));
+    }
+
+    auto key = static_cast<td::int64>(rnd.fast(1, 1000));
+    if (rnd.fast(0, 4) == 0) {
+      hints.remove(key);
+      key_to_words.erase(key);
+    } else {
+      td::vector<td::string> words;
+      int word_count = rnd.fast(1, 3);
+      for (int i = 0; i < word_count; i++) {
+        words.push_back(gen_word());
+      }
+      hints.add(key, td::implode(words, ' '));
+      key_to_words[key] = std::move(words);
+    }
+    if (rnd.fast(0, 5) == 0) {
+      hints.set_rating(key, rnd.fast(0, 10));
+    }
+
+    if (t % 100 != 0) {
+      continue;
+    }
+    ASSERT_EQ(key_to_words.size(), hints.size());
+    td::vector<td::string> query_words{gen_word()};
+    if (rnd.fast(0, 1) == 0) {
+      query_words.push_back(gen_word());
+    }
+    td::vector<td::int64> expected_keys;
+    for (auto &it : key_to_words) {
+      bool is_found = true;
+      for (auto &query_word : query_words) {
+        is_found &= std::any_of(it.second.begin(), it.second.end(),
+                                [&](const td::string &word) { return td::begins_with(word, query_word); });
+      }
+      if (is_found) {
+        expected_keys.push_back(it.first);
+      }
+    }
+    auto result = hints.search(td::implode(query_words, ' '), 1000000);
+    ASSERT_EQ(expected_keys.size(), result.first);
+    std::sort(expected_keys.begin(), expected_keys.end());
+    std::sort(result.second.begin(), result.second.end());
+    ASSERT_EQ(expected_keys, result.second);
+  }
+}
+
 static void test_unicode(td::uint32 (*func)(td::uint32)) {
   for (td::uint32 i = 0; i <= 0x110000; i++) {
     auto res = func(i);
@@ -6,6 +6,14 @@
 //
 #include "data.h"
 
+#include "td/telegram/DialogId.h"
+#include "td/telegram/FullMessageId.h"
+#include "td/telegram/MessageId.h"
+#include "td/telegram/MessagesDb.h"
+#include "td/telegram/NotificationId.h"
+#include "td/telegram/ServerMessageId.h"
+#include "td/telegram/UserId.h"
+
 #include "td/db/binlog/BinlogHelper.h"
 #include "td/db/binlog/ConcurrentBinlog.h"
 #include "td/db/BinlogKeyValue.h"
@@ -14,23 +22,32 @@
 #include "td/db/SqliteConnectionSafe.h"
 #include "td/db/SqliteDb.h"
 #include "td/db/SqliteKeyValue.h"
+#include "td/db/SqliteKeyValueAsync.h"
 #include "td/db/SqliteKeyValueSafe.h"
+#include "td/db/SqliteProfile.h"
 #include "td/db/TsSeqKeyValue.h"
 
 #include "td/actor/actor.h"
 #include "td/actor/ConcurrentScheduler.h"
 
+#include "td/utils/as.h"
 #include "td/utils/base64.h"
 #include "td/utils/common.h"
 #include "td/utils/filesystem.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/optional.h"
 #include "td/utils/port/FileFd.h"
+#include "td/utils/port/sleep.h"
+#include "td/utils/port/Stat.h"
 #include "td/utils/port/thread.h"
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
+#include "td/utils/SliceBuilder.h"
 #include "td/utils/Status.h"
 #include "td/utils/tests.h"
 
+#include <algorithm>
 #include <limits>
 #include <map>
 #include <memory>
@@ -134,6 +151,166 @@ TEST(DB, binlog_encryption) {
   }
 }
 
+TEST(DB, binlog_background_reindex) {
+  CSlice binlog_name = "test_binlog";
+  for (auto &db_key : {DbKey::empty(), DbKey::password("cucumber")}) {
+    Binlog::destroy(binlog_name).ignore();
+    {
+      Binlog binlog;
+      binlog.init(binlog_name.str(), [](const BinlogEvent &x) {}, db_key).ensure();
+      binlog.set_use_background_reindex(true);
+      auto first_id = binlog.add(1, create_storer("AAAA"));
+      auto second_id = binlog.add(1, create_storer("BBBB"));
+      for (int i = 0; stat(PSLICE() << binlog_name << ".new").is_error(); i++) {
+        ASSERT_TRUE(i < 1000000);
+        binlog.rewrite(second_id, 1, create_storer(string(1000, static_cast<char>('a' + i % 26))));
+        if (i == 10) {
+          binlog.erase(first_id);
+        }
+      }
+      // the reindex has been started; wait until it finishes
+      for (int i = 0; binlog.get_reindex_statistics().background_reindex_count == 0; i++) {
+        ASSERT_TRUE(i < 10000);
+        usleep_for(1000);
+        binlog.sync();
+      }
+      binlog.rewrite(second_id, 1, create_storer("CCCC"));
+      binlog.add(1, create_storer("DDDD"));
+
+      auto statistics = binlog.get_reindex_statistics();
+      ASSERT_EQ(1u, statistics.background_reindex_count);
+      ASSERT_TRUE(statistics.last_size_after < statistics.last_size_before);
+      binlog.close().ensure();
+    }
+    {
+      std::vector<string> v;
+      Binlog binlog;
+      binlog.init(binlog_name.str(), [&](const BinlogEvent &x) { v.push_back(x.data_.str()); }, db_key).ensure();
+      ASSERT_TRUE(v == std::vector<string>({"CCCC", "DDDD"}));
+    }
+  }
+  Binlog::destroy(binlog_name).ignore();
+}
+
+TEST(DB, concurrent_binlog_background_reindex) {
+  CSlice binlog_name = "test_binlog";
+  Binlog::destroy(binlog_name).ignore();
+  auto binlog = make_unique<Binlog>();
+  binlog->init(binlog_name.str(), [](const BinlogEvent &x) {}).ensure();
+  binlog->set_use_background_reindex(true);
+  auto id = binlog->add(1, create_storer("AAAA"));
+  for (int i = 0; stat(PSLICE() << binlog_name << ".new").is_error(); i++) {
+    ASSERT_TRUE(i < 1000000);
+    binlog->rewrite(id, 1, create_storer(string(1000, static_cast<char>('a' + i % 26))));
+  }
+
+  ConcurrentScheduler sched;
+  sched.init(0);
+  std::shared_ptr<ConcurrentBinlog> concurrent_binlog;
+  {
+    auto guard = sched.get_main_guard();
+    concurrent_binlog = std::make_shared<ConcurrentBinlog>(std::move(binlog), 0);
+  }
+  sched.start();
+  // no new events are added, but the reindex must be finished anyway
+  for (int i = 0; concurrent_binlog->get_reindex_statistics().background_reindex_count == 0; i++) {
+    ASSERT_TRUE(i < 10000);
+    sched.run_main(0.001);
+  }
+  {
+    auto guard = sched.get_main_guard();
+    concurrent_binlog->close(PromiseCreator::lambda([](Unit) { Scheduler::instance()->finish(); }));
+  }
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+  ASSERT_TRUE(stat(PSLICE() << binlog_name << ".new").is_error());
+  Binlog::destroy(binlog_name).ignore();
+}
+
+TEST(DB, binlog_parallel_load) {
+  CSlice binlog_name = "test_binlog";
+  for (auto &db_key : {DbKey::empty(), DbKey::password("cucumber")}) {
+    Binlog::destroy(binlog_name).ignore();
+    std::vector<string> values;
+    {
+      Binlog binlog;
+      binlog.init(binlog_name.str(), [](const BinlogEvent &x) {}, db_key).ensure();
+      for (int i = 0; i < 5000; i++) {
+        values.push_back(string(4 * Random::fast(1, 500), static_cast<char>('a' + i % 26)));
+        binlog.add(1, create_storer(values.back()));
+      }
+      binlog.close().ensure();
+    }
+    for (auto load_thread_count : {1, 3, 8}) {
+      std::vector<string> v;
+      Binlog binlog;
+      binlog.set_load_thread_count(load_thread_count);
+      binlog.init(binlog_name.str(), [&](const BinlogEvent &x) { v.push_back(x.data_.str()); }, db_key).ensure();
+      ASSERT_TRUE(v == values);
+      binlog.add(1, create_storer("AAAA"));
+      values.push_back("AAAA");
+    }
+  }
+  Binlog::destroy(binlog_name).ignore();
+}
+
+TEST(DB, binlog_parallel_load_encrypted) {
+  CSlice binlog_name = "test_binlog";
+  auto db_key = DbKey::password("cucumber");
+  Binlog::destroy(binlog_name).ignore();
+  {
+    Binlog binlog;
+    binlog.init(binlog_name.str(), [](const BinlogEvent &x) {}, db_key).ensure();
+    // several read chunks, so the load threads are used many times
+    for (int i = 0; i < 12000; i++) {
+      binlog.add(1 + i % 3, create_storer(string(4 * Random::fast(1, 500), static_cast<char>('a' + i % 26))));
+    }
+    binlog.close().ensure();
+  }
+  auto binlog_data = read_file_str(binlog_name).move_as_ok();
+
+  struct LoadedEvent {
+    uint64 id;
+    int32 type;
+    string data;
+    int64 offset;
+    bool operator==(const LoadedEvent &other) const {
+      return id == other.id && type == other.type && data == other.data && offset == other.offset;
+    }
+  };
+  auto load = [&](Slice data, int32 load_thread_count) {
+    write_file(binlog_name, data).ensure();
+    std::vector<LoadedEvent> events;
+    Binlog binlog;
+    binlog.set_load_thread_count(load_thread_count);
+    binlog
+        .init(binlog_name.str(),
+              [&](const BinlogEvent &x) { events.push_back({x.id_, x.type_, x.data_.str(), x.offset_}); }, db_key)
+        .ensure();
+    binlog.close(false).ensure();
+    return events;
+  };
+
+  auto serial_events = load(binlog_data, 1);
+  ASSERT_EQ(12000u, serial_events.size());
+  for (auto load_thread_count : {2, 3, 8}) {
+    ASSERT_TRUE(load(binlog_data, load_thread_count) == serial_events);
+  }
+
+  // the binlog must be truncated at the same corrupted event
+  auto corrupted_event_offset = serial_events[serial_events.size() * 2 / 3].offset;
+  binlog_data[narrow_cast<size_t>(corrupted_event_offset) - BinlogEvent::TAIL_SIZE - 1] ^= 1;
+  auto serial_corrupted_events = load(binlog_data, 1);
+  ASSERT_EQ(serial_events.size() * 2 / 3, serial_corrupted_events.size());
+  ASSERT_TRUE(std::equal(serial_corrupted_events.begin(), serial_corrupted_events.end(), serial_events.begin()));
+  for (auto load_thread_count : {2, 3, 8}) {
+    ASSERT_TRUE(load(binlog_data, load_thread_count) == serial_corrupted_events);
+  }
+  Binlog::destroy(binlog_name).ignore();
+}
+
 TEST(DB, sqlite_lfs) {
   string path = "test_sqlite_db";
   SqliteDb::destroy(path).ignore();
@@ -143,6 +320,82 @@ TEST(DB, sqlite_lfs) {
   SqliteDb::destroy(path).ignore();
 }
 
+TEST(DB, sqlite_read_only_connection) {
+  string path = "test_sqlite_db";
+  SqliteDb::destroy(path).ignore();
+  SqliteDb::open_with_key(path, true, DbKey::empty()).ensure();
+  auto key = DbKey::password("cucumber");
+  {
+    auto db = SqliteDb::change_key(path, true, key, DbKey::empty()).move_as_ok();
+    db.exec("PRAGMA journal_mode=WAL").ensure();
+    db.exec("CREATE TABLE IF NOT EXISTS t (k INT PRIMARY KEY)").ensure();
+    db.exec("INSERT INTO t VALUES(1)").ensure();
+  }
+
+  ConcurrentScheduler sched;
+  sched.init(0);
+  auto guard = sched.get_main_guard();
+  SqliteConnectionSafe connection(path, key);
+  auto read_only_db = connection.open_read_only_connection().move_as_ok();
+  {
+    auto stmt = read_only_db.get_statement("SELECT k FROM t").move_as_ok();
+    stmt.step().ensure();
+    ASSERT_TRUE(stmt.has_row());
+    ASSERT_EQ(1, stmt.view_int32(0));
+  }
+  ASSERT_TRUE(read_only_db.exec("INSERT INTO t VALUES(2)").is_error());
+
+  connection.get().exec("INSERT INTO t VALUES(2)").ensure();
+  connection.close();
+  read_only_db.close();
+  SqliteDb::destroy(path).ignore();
+}
+
+TEST(DB, sqlite_profile) {
+  string path = "test_sqlite_db";
+  SqliteDb::destroy(path).ignore();
+  SqliteDb::open_with_key(path, true, DbKey::empty()).ensure();
+
+  auto get_integer_pragma = [](SqliteDb &db, Slice name) {
+    auto stmt = db.get_statement(PSLICE() << "PRAGMA " << name).move_as_ok();
+    stmt.step().ensure();
+    CHECK(stmt.has_row());
+    return stmt.view_int32(0);
+  };
+
+  ConcurrentScheduler sched;
+  sched.init(0);
+  auto guard = sched.get_main_guard();
+  for (auto profile : {SqliteProfile::Durable, SqliteProfile::Balanced, SqliteProfile::Throughput}) {
+    SqliteConnectionSafe connection(path, DbKey::empty(), optional<int32>(), profile);
+    auto &db = connection.get();
+    ASSERT_EQ(profile == SqliteProfile::Durable ? 2 : 1, get_integer_pragma(db, "synchronous"));
+    ASSERT_EQ(profile == SqliteProfile::Durable ? 1 : (profile == SqliteProfile::Balanced ? 2 : 0),
+              get_integer_pragma(db, "secure_delete"));
+    ASSERT_EQ("wal", db.get_pragma_string("journal_mode").ok());
+    connection.close();
+  }
+
+  SqliteConnectionSafe connection(path, DbKey::empty(), optional<int32>(), SqliteProfile::Throughput);
+  auto &db = connection.get();
+  ASSERT_EQ(0, get_integer_pragma(db, "wal_autocheckpoint"));
+  db.exec("CREATE TABLE IF NOT EXISTS t (k INT PRIMARY KEY, v BLOB)").ensure();
+  db.begin_write_transaction().ensure();
+  for (int i = 0; i < 1000; i++) {
+    db.exec(PSLICE() << "INSERT INTO t VALUES(" << i << ", randomblob(1000))").ensure();
+  }
+  db.commit_transaction().ensure();
+
+  connection.start_background_checkpoints(0.001);
+  while (connection.get_checkpoint_statistics().checkpoint_count == 0) {
+    usleep_for(1000);
+  }
+  auto statistics = connection.get_checkpoint_statistics();
+  ASSERT_TRUE(statistics.max_wal_frame_count > 0);
+  connection.close();
+  SqliteDb::destroy(path).ignore();
+}
+
 TEST(DB, sqlite_encryption) {
   string path = "test_sqlite_db";
   SqliteDb::destroy(path).ignore();
@@ -679,3 +932,508 @@ TEST(DB, persistent_key_value) {
   }
   SqliteDb::destroy(path).ignore();
 }
+
+TEST(DB, binlog_sync_policy) {
+  static constexpr size_t EVENT_COUNT = 10;
+  CSlice path = "test_binlog_sync";
+  Binlog::destroy(path).ignore();
+
+  class Main final : public Actor {
+   public:
+    explicit Main(CSlice path) : path_(path.str()) {
+    }
+
+    void start_up() final {
+      binlog_->init(path_, [](const BinlogEvent &) {}).ensure();
+      BinlogSyncPolicy policy;
+      policy.max_sync_delay = 1000.0;
+      policy.max_pending_sync_count = EVENT_COUNT;
+      policy.use_data_sync = true;
+      binlog_->set_sync_policy(policy);
+      for (size_t i = 0; i < EVENT_COUNT; i++) {
+        binlog_->add(1, SliceStorer("data"), PromiseCreator::lambda([actor_id = actor_id(this)](Unit) {
+                       send_closure(actor_id, &Main::on_event_synced);
+                     }));
+      }
+      set_timeout_in(10.0);
+    }
+
+    void on_event_synced() {
+      synced_event_count_++;
+      if (synced_event_count_ != EVENT_COUNT) {
+        return;
+      }
+      // all events must be synced at once
+      auto statistics = binlog_->get_sync_statistics();
+      ASSERT_EQ(1u, statistics.sync_count);
+      ASSERT_EQ(static_cast<uint64>(EVENT_COUNT), statistics.synced_promise_count);
+      close_binlog();
+    }
+
+    void timeout_expired() final {
+      LOG(ERROR) << "Binlog events weren't synced";
+      ASSERT_TRUE(false);
+      close_binlog();
+    }
+
+   private:
+    string path_;
+    std::shared_ptr<ConcurrentBinlog> binlog_ = std::make_shared<ConcurrentBinlog>();
+    size_t synced_event_count_ = 0;
+
+    void close_binlog() {
+      binlog_->close(PromiseCreator::lambda([](Unit) { Scheduler::instance()->finish(); }));
+      stop();
+    }
+  };
+
+  ConcurrentScheduler sched;
+  sched.init(0);
+  sched.create_actor_unsafe<Main>(0, "Main", path).release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+  Binlog::destroy(path).ignore();
+}
+
+TEST(DB, sqlite_key_value_async) {
+  CSlice path = "test_sqlite_kv_async";
+  SqliteDb::destroy(path).ignore();
+  SqliteDb::open_with_key(path, true, DbKey::empty()).ensure();
+
+  class Main final : public Actor {
+   public:
+    explicit Main(CSlice path) : path_(path.str()) {
+    }
+
+    void start_up() final {
+      sql_connection_ = std::make_shared<SqliteConnectionSafe>(path_, DbKey::empty());
+      kv_safe_ = std::make_shared<SqliteKeyValueSafe>("common", sql_connection_);
+      kv_async_ = create_sqlite_key_value_async(kv_safe_, 0, 1 << 10);
+
+      for (int i = 0; i < 1000; i++) {
+        kv_async_->set("a", to_string(i), Auto());
+      }
+      kv_async_->set("ab", "b", Auto());
+      kv_async_->erase("c", Auto());
+      kv_async_->get("a", check_value("999"));
+      kv_async_->set("a", "1", PromiseCreator::lambda([actor_id = actor_id(this)](Unit) {
+                       send_closure(actor_id, &Main::on_flushed);
+                     }));
+      set_timeout_in(10.0);
+    }
+
+    void on_flushed() {
+      auto statistics = kv_async_->get_statistics();
+      ASSERT_EQ(1000u, statistics.overwritten_count);
+      ASSERT_EQ(1u, statistics.flush_count);
+      ASSERT_EQ(3u, statistics.flushed_key_count);
+      ASSERT_EQ(1u, statistics.pending_hit_count);
+
+      kv_async_->get("a", check_value("1"));
+      kv_async_->get("c", check_value(""));
+      kv_async_->get("d", check_value(""));
+      kv_async_->get("d", check_value(""));
+      kv_async_->set("a", "1", Auto());
+      kv_async_->get("big", check_value(""));
+      kv_async_->erase_by_prefix("a", Auto());
+      kv_async_->get("a", check_value(""));
+      kv_async_->get("ab", PromiseCreator::lambda([actor_id = actor_id(this)](string value) {
+                       ASSERT_EQ("", value);
+                       send_closure(actor_id, &Main::on_finished);
+                     }));
+    }
+
+    void on_finished() {
+      auto statistics = kv_async_->get_statistics();
+      ASSERT_EQ(3u, statistics.cache_hit_count);
+      ASSERT_EQ(4u, statistics.cache_miss_count);
+
+      // the key is written both directly and through the asynchronous object
+      kv_async_->set("s", "a", PromiseCreator::lambda([actor_id = actor_id(this)](Unit) {
+                       send_closure(actor_id, &Main::on_mixed_set);
+                     }));
+    }
+
+    void on_mixed_set() {
+      ASSERT_EQ("a", kv_safe_->get().get("s"));
+      kv_safe_->get().set("s", "b");
+      kv_async_->set("s", "a", PromiseCreator::lambda([actor_id = actor_id(this)](Unit) {
+                       send_closure(actor_id, &Main::on_mixed_set_again);
+                     }));
+    }
+
+    void on_mixed_set_again() {
+      ASSERT_EQ("a", kv_safe_->get().get("s"));
+      kv_safe_->get().set("s", "b");
+      kv_async_->erase("s", PromiseCreator::lambda([actor_id = actor_id(this)](Unit) {
+                         send_closure(actor_id, &Main::on_mixed_erase);
+                       }));
+    }
+
+    void on_mixed_erase() {
+      ASSERT_EQ("", kv_safe_->get().get("s"));
+      close_kv();
+    }
+
+    void timeout_expired() final {
+      LOG(ERROR) << "Key-value writes weren't flushed";
+      ASSERT_TRUE(false);
+      close_kv();
+    }
+
+   private:
+    string path_;
+    std::shared_ptr<SqliteConnectionSafe> sql_connection_;
+    std::shared_ptr<SqliteKeyValueSafe> kv_safe_;
+    unique_ptr<SqliteKeyValueAsyncInterface> kv_async_;
+
+    static Promise<string> check_value(string expected_value) {
+      return PromiseCreator::lambda(
+          [expected_value = std::move(expected_value)](string value) { ASSERT_EQ(expected_value, value); });
+    }
+
+    void close_kv() {
+      kv_async_->close(PromiseCreator::lambda([sql_connection = sql_connection_](Unit) {
+        sql_connection->close_and_destroy();
+        Scheduler::instance()->finish();
+      }));
+      kv_safe_.reset();
+      sql_connection_.reset();
+      stop();
+    }
+  };
+
+  ConcurrentScheduler sched;
+  sched.init(0);
+  sched.create_actor_unsafe<Main>(0, "Main", path).release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+}
+
+TEST(DB, messages_db_fts_queue) {
+  CSlice path = "test_messages_db";
+  SqliteDb::destroy(path).ignore();
+  SqliteDb::open_with_key(path, true, DbKey::empty()).ensure();
+
+  ConcurrentScheduler sched;
+  sched.init(0);
+  auto guard = sched.get_main_guard();
+  auto sql_connection = std::make_shared<SqliteConnectionSafe>(path.str(), DbKey::empty());
+  auto &db = sql_connection->get();
+  db.exec("BEGIN TRANSACTION").ensure();
+  init_messages_db(db, 0).ensure();
+  db.exec("COMMIT TRANSACTION").ensure();
+
+  auto messages_db_sync_safe = create_messages_db_sync(sql_connection);
+  auto &messages_db = messages_db_sync_safe->get();
+  DialogId dialog_id(UserId(static_cast<int64>(123)));
+  auto add_message = [&](int32 id, string text) {
+    messages_db
+        .add_message({dialog_id, MessageId(ServerMessageId(id))}, ServerMessageId(), UserId(), 0, 0, 0, id,
+                     std::move(text), NotificationId(), MessageId(), BufferSlice("data"))
+        .ensure();
+  };
+  auto delete_message = [&](int32 id) {
+    messages_db.delete_message({dialog_id, MessageId(ServerMessageId(id))}).ensure();
+  };
+  auto search = [&](string query, int32 limit) {
+    MessagesDbFtsQuery fts_query;
+    fts_query.query = std::move(query);
+    fts_query.limit = limit;
+    return messages_db.get_messages_fts(std::move(fts_query)).move_as_ok();
+  };
+  auto check_index = [&] {
+    db.exec("INSERT INTO messages_fts(messages_fts) VALUES('integrity-check')").ensure();
+  };
+
+  for (int32 i = 1; i <= 300; i++) {
+    add_message(i, PSTRING() << "hello word" << i % 10);
+  }
+  ASSERT_EQ(300, messages_db.get_unindexed_fts_message_count().move_as_ok());
+  auto result = search("hello", 100);
+  ASSERT_TRUE(result.messages.empty());
+  ASSERT_EQ(300, result.max_unindexed_search_id);
+  ASSERT_EQ(-1, result.get_total_count(true, 100));
+
+  // messages with the biggest search_id are indexed first
+  ASSERT_EQ(100, messages_db.index_fts_messages(100).move_as_ok());
+  result = search("hello", 1000);
+  ASSERT_EQ(100u, result.messages.size());
+  ASSERT_EQ(201, result.next_search_id);
+  ASSERT_EQ(200, result.max_unindexed_search_id);
+  ASSERT_EQ(-1, result.get_total_count(true, 1000));
+
+  delete_message(250);            // indexed
+  delete_message(150);            // not indexed yet
+  add_message(260, "bye word0");  // replaced after indexing
+  add_message(140, "bye word0");  // replaced before indexing
+  check_index();
+
+  while (messages_db.index_fts_messages(50).move_as_ok() > 0) {
+  }
+  ASSERT_EQ(0, messages_db.get_unindexed_fts_message_count().move_as_ok());
+  messages_db.merge_fts_index(100).ensure();
+  check_index();
+
+  result = search("hello", 1000);
+  ASSERT_EQ(296u, result.messages.size());
+  ASSERT_EQ(0, result.max_unindexed_search_id);
+  ASSERT_EQ(296, result.get_total_count(true, 1000));
+  ASSERT_EQ(-1, result.get_total_count(false, 1000));
+  ASSERT_EQ(-1, result.get_total_count(true, 296));
+  for (auto &message : result.messages) {
+    auto id = message.message_id.get_server_message_id().get();
+    ASSERT_TRUE(id != 250 && id != 150 && id != 260 && id != 140);
+  }
+
+  result = search("bye", 1000);
+  ASSERT_EQ(2u, result.messages.size());
+  ASSERT_EQ(2, result.get_total_count(true, 1000));
+  ASSERT_EQ(28u, search("word0", 1000).messages.size());
+
+  // the whole result is returned page by page
+  int64 from_search_id = 0;
+  size_t found_count = 0;
+  while (true) {
+    MessagesDbFtsQuery fts_query;
+    fts_query.query = "word3";
+    fts_query.from_search_id = from_search_id;
+    fts_query.limit = 7;
+    result = messages_db.get_messages_fts(std::move(fts_query)).move_as_ok();
+    ASSERT_EQ(0, result.max_unindexed_search_id);
+    if (result.messages.empty()) {
+      break;
+    }
+    found_count += result.messages.size();
+    from_search_id = result.next_search_id;
+  }
+  ASSERT_EQ(30u, found_count);
+
+  messages_db_sync_safe.reset();
+  sql_connection->close_and_destroy();
+}
+
+TEST(DB, messages_db_compression) {
+  CSlice path = "test_messages_db";
+  SqliteDb::destroy(path).ignore();
+  SqliteDb::open_with_key(path, true, DbKey::empty()).ensure();
+
+  ConcurrentScheduler sched;
+  sched.init(0);
+  auto guard = sched.get_main_guard();
+  auto sql_connection = std::make_shared<SqliteConnectionSafe>(path.str(), DbKey::empty());
+  auto &db = sql_connection->get();
+  db.exec("BEGIN TRANSACTION").ensure();
+  init_messages_db(db, 0).ensure();
+  db.exec("COMMIT TRANSACTION").ensure();
+
+  auto compressing_db_safe = create_messages_db_sync(sql_connection, true);
+  auto plain_db_safe = create_messages_db_sync(sql_connection, false);
+  DialogId dialog_id(UserId(static_cast<int64>(123)));
+  auto get_full_message_id = [&](int32 id) {
+    return FullMessageId(dialog_id, MessageId(ServerMessageId(id)));
+  };
+  auto get_stored_data = [&](int32 id) {
+    auto stmt = db.get_statement("SELECT data FROM messages WHERE dialog_id = ?1 AND message_id = ?2").move_as_ok();
+    stmt.bind_int64(1, dialog_id.get()).ensure();
+    stmt.bind_int64(2, get_full_message_id(id).get_message_id().get()).ensure();
+    stmt.step().ensure();
+    CHECK(stmt.has_row());
+    return stmt.view_blob(0).str();
+  };
+
+  std::map<int32, string> values;
+  for (int32 id = 1; id <= 60; id++) {
+    string data;
+    switch (id % 3) {
+      case 0:
+        data = PSTRING() << "short" << id;
+        break;
+      case 1:
+        data = rand_string('a', 'c', Random::fast(256, 10000));
+        break;
+      case 2:
+        data = string(Random::fast(256, 10000), '\0');
+        Random::secure_bytes(data);
+        break;
+    }
+    values[id] = data;
+    // legacy uncompressed rows are mixed with the compressed ones
+    auto &messages_db = id % 2 == 0 ? plain_db_safe->get() : compressing_db_safe->get();
+    messages_db
+        .add_message(get_full_message_id(id), ServerMessageId(), UserId(), 0, 0, 0, 0, "", NotificationId(),
+                     MessageId(), BufferSlice(data))
+        .ensure();
+  }
+
+  for (auto &it : values) {
+    auto stored_size = get_stored_data(it.first).size();
+    if (it.first % 2 == 1 && it.first % 3 == 1) {
+      ASSERT_TRUE(stored_size < it.second.size());
+    } else if (it.first % 2 == 0) {
+      ASSERT_EQ(it.second.size(), stored_size);
+    }
+    for (auto *messages_db_safe : {compressing_db_safe.get(), plain_db_safe.get()}) {
+      auto message = messages_db_safe->get().get_message(get_full_message_id(it.first)).move_as_ok();
+      ASSERT_EQ(it.second, message.data.as_slice().str());
+    }
+  }
+
+  MessagesDbMessagesQuery query;
+  query.dialog_id = dialog_id;
+  query.from_message_id = MessageId::max();
+  query.limit = 100;
+  auto messages = plain_db_safe->get().get_messages(query).move_as_ok();
+  ASSERT_EQ(values.size(), messages.size());
+  for (auto &message : messages) {
+    ASSERT_EQ(values[message.message_id.get_server_message_id().get()], message.data.as_slice().str());
+  }
+
+  // compressed data with a wrong uncompressed size must not be returned
+  auto compressed_data = get_stored_data(1);
+  auto real_size = static_cast<int32>(values[1].size());
+  int32 new_id = 100;
+  for (auto wrong_size : {-1, 0, real_size - 1, real_size + 1, std::numeric_limits<int32>::max()}) {
+    as<int32>(&compressed_data[4]) = wrong_size;
+    auto stmt = db.get_statement("INSERT INTO messages (dialog_id, message_id, data) VALUES(?1, ?2, ?3)").move_as_ok();
+    stmt.bind_int64(1, dialog_id.get()).ensure();
+    stmt.bind_int64(2, get_full_message_id(new_id).get_message_id().get()).ensure();
+    stmt.bind_blob(3, compressed_data).ensure();
+    stmt.step().ensure();
+    auto message = compressing_db_safe->get().get_message(get_full_message_id(new_id)).move_as_ok();
+    ASSERT_TRUE(message.data.empty());
+    new_id++;
+  }
+
+  compressing_db_safe.reset();
+  plain_db_safe.reset();
+  sql_connection->close_and_destroy();
+}
+
+TEST(DB, messages_db_async_transaction_limits) {
+  CSlice path = "test_messages_db";
+  SqliteDb::destroy(path).ignore();
+  SqliteDb::open_with_key(path, true, DbKey::empty()).ensure();
+
+  class Main final : public Actor {
+   public:
+    explicit Main(CSlice path) : path_(path.str()) {
+    }
+
+    void start_up() final {
+      sql_connection_ = std::make_shared<SqliteConnectionSafe>(path_, DbKey::empty());
+      auto &db = sql_connection_->get();
+      db.exec("BEGIN TRANSACTION").ensure();
+      init_messages_db(db, 0).ensure();
+      db.exec("COMMIT TRANSACTION").ensure();
+      messages_db_async_ = create_messages_db_async(create_messages_db_sync(sql_connection_), 0);
+
+      auto statistics = messages_db_async_->get_statistics();
+      ASSERT_EQ(50u, statistics.max_pending_write_count);
+      ASSERT_EQ(0.01, statistics.max_pending_write_delay);
+
+      // under load the transactions are committed because of the number of pending writes, and the limits grow
+      for (int32 i = 1; i <= 5000; i++) {
+        add_message(first_dialog_id_, i, Auto());
+      }
+      // the read doesn't need to see pending writes in the other dialog
+      messages_db_async_->get_message(
+          get_full_message_id(second_dialog_id_, 1),
+          PromiseCreator::lambda([actor_id = actor_id(this)](Result<MessagesDbDialogMessage> result) {
+            ASSERT_TRUE(result.is_error());
+            send_closure(actor_id, &Main::on_load_finished);
+          }));
+      set_timeout_in(10.0);
+    }
+
+    void on_load_finished() {
+      // the statistics are published after each transaction
+      auto statistics = messages_db_async_->get_statistics();
+      ASSERT_TRUE(statistics.full_transaction_count >= 5u);
+      ASSERT_EQ(0u, statistics.read_transaction_count);
+      ASSERT_EQ(1000u, statistics.max_pending_write_count);
+      ASSERT_EQ(0.1, statistics.max_pending_write_delay);
+
+      // the read must see pending writes in its dialog
+      add_message(second_dialog_id_, 1, Auto());
+      messages_db_async_->get_message(
+          get_full_message_id(second_dialog_id_, 1),
+          PromiseCreator::lambda([actor_id = actor_id(this)](Result<MessagesDbDialogMessage> result) {
+            ASSERT_TRUE(result.is_ok());
+            ASSERT_EQ("data", result.ok().data.as_slice().str());
+            send_closure(actor_id, &Main::on_read_flushed);
+          }));
+    }
+
+    void on_read_flushed() {
+      auto statistics = messages_db_async_->get_statistics();
+      ASSERT_EQ(5001u, statistics.write_count);
+      ASSERT_EQ(1u, statistics.read_transaction_count);
+      ASSERT_EQ(1u, statistics.deferred_read_count);
+      add_idle_message();
+    }
+
+    // single writes are committed because of the timeout, and the limits shrink
+    void add_idle_message() {
+      if (idle_write_count_ == 8) {
+        auto statistics = messages_db_async_->get_statistics();
+        ASSERT_TRUE(statistics.shrink_count >= 5u);
+        ASSERT_EQ(50u, statistics.max_pending_write_count);
+        ASSERT_EQ(0.01, statistics.max_pending_write_delay);
+        return close_db();
+      }
+      idle_write_count_++;
+      add_message(second_dialog_id_, 1 + idle_write_count_, PromiseCreator::lambda([actor_id = actor_id(this)](Unit) {
+                    send_closure(actor_id, &Main::add_idle_message);
+                  }));
+    }
+
+    void timeout_expired() final {
+      LOG(ERROR) << "Message database writes weren't committed";
+      ASSERT_TRUE(false);
+      close_db();
+    }
+
+   private:
+    string path_;
+    std::shared_ptr<SqliteConnectionSafe> sql_connection_;
+    std::shared_ptr<MessagesDbAsyncInterface> messages_db_async_;
+    DialogId first_dialog_id_{UserId(static_cast<int64>(123))};
+    DialogId second_dialog_id_{UserId(static_cast<int64>(456))};
+    int32 idle_write_count_ = 0;
+
+    static FullMessageId get_full_message_id(DialogId dialog_id, int32 id) {
+      return FullMessageId(dialog_id, MessageId(ServerMessageId(id)));
+    }
+
+    void add_message(DialogId dialog_id, int32 id, Promise<> promise) {
+      messages_db_async_->add_message(get_full_message_id(dialog_id, id), ServerMessageId(), UserId(), 0, 0, 0, 0, "",
+                                      NotificationId(), MessageId(), BufferSlice("data"), std::move(promise));
+    }
+
+    void close_db() {
+      messages_db_async_->close(PromiseCreator::lambda([sql_connection = sql_connection_](Unit) {
+        sql_connection->close_and_destroy();
+        Scheduler::instance()->finish();
+      }));
+      messages_db_async_.reset();
+      sql_connection_.reset();
+      stop();
+    }
+  };
+
+  ConcurrentScheduler sched;
+  sched.init(0);
+  sched.create_actor_unsafe<Main>(0, "Main", path).release();
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+}
@@ -5,22 +5,32 @@
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
 #include "td/telegram/ConfigManager.h"
+#include "td/telegram/Global.h"
 #include "td/telegram/net/DcId.h"
+#include "td/telegram/net/GzipWorker.h"
+#include "td/telegram/net/NetQuery.h"
+#include "td/telegram/net/NetQueryCreator.h"
 #include "td/telegram/net/PublicRsaKeyShared.h"
 #include "td/telegram/net/Session.h"
+#include "td/telegram/net/SessionMultiProxy.h"
 #include "td/telegram/NotificationManager.h"
+#include "td/telegram/telegram_api.h"
 
 #include "td/mtproto/AuthData.h"
+#include "td/mtproto/AuthKey.h"
 #include "td/mtproto/DhCallback.h"
 #include "td/mtproto/DhHandshake.h"
 #include "td/mtproto/Handshake.h"
 #include "td/mtproto/HandshakeActor.h"
+#include "td/mtproto/KDF.h"
+#include "td/mtproto/PacketInfo.h"
 #include "td/mtproto/Ping.h"
 #include "td/mtproto/PingConnection.h"
 #include "td/mtproto/ProxySecret.h"
 #include "td/mtproto/RawConnection.h"
 #include "td/mtproto/RSA.h"
 #include "td/mtproto/TlsInit.h"
+#include "td/mtproto/Transport.h"
 #include "td/mtproto/TransportType.h"
 
 #include "td/net/GetHostByNameActor.h"
@@ -31,12 +41,17 @@
 #include "td/actor/ConcurrentScheduler.h"
 #include "td/actor/PromiseFuture.h"
 
+#include "td/utils/as.h"
 #include "td/utils/base64.h"
+#include "td/utils/buffer.h"
 #include "td/utils/BufferedFd.h"
 #include "td/utils/common.h"
 #include "td/utils/crypto.h"
 #include "td/utils/logging.h"
 #include "td/utils/port/Clocks.h"
+#include "td/utils/port/config.h"
+#include "td/utils/port/detail/NativeFd.h"
+#include "td/utils/port/detail/PollableFd.h"
 #include "td/utils/port/IPAddress.h"
 #include "td/utils/port/SocketFd.h"
 #include "td/utils/Random.h"
@@ -45,6 +60,13 @@
 #include "td/utils/Status.h"
 #include "td/utils/tests.h"
 #include "td/utils/Time.h"
+#include "td/utils/UInt.h"
+
+#include <utility>
+
+#if TD_PORT_POSIX
+#include <sys/socket.h>
+#endif
 
 using namespace td;
 
@@ -734,3 +756,233 @@ TEST(Mtproto, RSA) {
   rsa.encrypt(pem.substr(0, 256), to);
   ASSERT_EQ("U2nJEtB2AgpHrm3HB0yhpTQgb0wbesi9Pv/W1v/vULU=", td::base64_encode(td::sha256(to)));
 }
+
+TEST(Mtproto, gzip_postponed_query) {
+  ConcurrentScheduler sched;
+  int threads_n = 0;
+  sched.init(threads_n);
+  {
+    auto guard = sched.get_main_guard();
+    class RunTest final : public Actor {
+      void start_up() final {
+        set_context(std::make_shared<Global>());
+        creator_ = make_unique<NetQueryCreator>(nullptr);
+
+        ASSERT_TRUE(create_query(string(10, 'a'))->gzip_flag() == NetQuery::GzipFlag::Off);
+        ASSERT_TRUE(create_query(string(1000, 'a'))->gzip_flag() == NetQuery::GzipFlag::On);
+
+        string random_data(GzipWorker::MIN_ASYNC_SIZE, '\0');
+        Random::secure_bytes(random_data);
+        ASSERT_TRUE(create_query(random_data)->gzip_flag() == NetQuery::GzipFlag::Off);
+
+        ASSERT_TRUE(GzipWorker::decode(random_data).is_error());
+
+        query_ = create_query(string(GzipWorker::MIN_ASYNC_SIZE, 'a'));
+        ASSERT_TRUE(query_->gzip_flag() == NetQuery::GzipFlag::Postponed);
+        original_query_ = query_->query().as_slice().str();
+
+        gzip_worker_ = create_actor<GzipWorker>("GzipWorker");
+        send_closure(gzip_worker_, &GzipWorker::encode_async, query_->query().clone(), 0.9,
+                     PromiseCreator::lambda([actor_id = actor_id(this)](Result<BufferSlice> r_compressed_query) {
+                       send_closure(actor_id, &RunTest::on_query_compressed, std::move(r_compressed_query));
+                     }));
+      }
+
+      void on_query_compressed(Result<BufferSlice> r_compressed_query) {
+        ASSERT_TRUE(r_compressed_query.is_ok());
+        query_->set_compressed_query(r_compressed_query.move_as_ok());
+        ASSERT_TRUE(query_->gzip_flag() == NetQuery::GzipFlag::On);
+        ASSERT_TRUE(query_->query().size() < original_query_.size());
+
+        auto r_query = GzipWorker::decode(query_->query().as_slice());
+        ASSERT_TRUE(r_query.is_ok());
+        ASSERT_EQ(original_query_, r_query.ok().as_slice().str());
+
+        query_.reset();
+        creator_.reset();
+        gzip_worker_.reset();
+        stop();
+        Scheduler::instance()->finish();
+      }
+
+      NetQueryPtr create_query(string about) {
+        return creator_->create(telegram_api::account_updateProfile(telegram_api::account_updateProfile::ABOUT_MASK,
+                                                                    string(), string(), about));
+      }
+
+      unique_ptr<NetQueryCreator> creator_;
+      ActorOwn<GzipWorker> gzip_worker_;
+      NetQueryPtr query_;
+      string original_query_;
+    };
+    create_actor<RunTest>("RunTest").release();
+  }
+
+  sched.start();
+  while (sched.run_main(10)) {
+    // empty
+  }
+  sched.finish();
+}
+
+TEST(Mtproto, choose_session) {
+  using SessionStatistics = SessionMultiProxy::SessionStatistics;
+  vector<SessionStatistics> sessions(3);
+  ASSERT_EQ(0u, SessionMultiProxy::choose_session(sessions));
+
+  // queries are spread between sessions without finished queries
+  sessions[0].on_query_sent(100);
+  ASSERT_EQ(1u, SessionMultiProxy::choose_session(sessions));
+  sessions[1].on_query_sent(100);
+  ASSERT_EQ(2u, SessionMultiProxy::choose_session(sessions));
+  sessions[2].on_query_sent(100);
+  ASSERT_EQ(0u, SessionMultiProxy::choose_session(sessions));
+
+  // a session with smaller unfinished queries is preferred
+  sessions[0].on_query_sent(10 << 20);
+  ASSERT_EQ(1u, SessionMultiProxy::choose_session(sessions));
+  sessions[0].on_query_finished(1.0, 10 << 20, false);
+  ASSERT_EQ(100u, sessions[0].queries_size);
+
+  // the first finished query sets the query time, next ones change it smoothly
+  sessions[1].on_query_finished(2.0, 100, false);
+  ASSERT_EQ(2.0, sessions[1].query_time);
+  sessions[1].on_query_sent(100);
+  sessions[1].on_query_finished(1.0, 100, false);
+  ASSERT_TRUE(1.0 < sessions[1].query_time && sessions[1].query_time < 2.0);
+
+  // a faster session is preferred
+  sessions[2].on_query_finished(0.5, 100, false);
+  ASSERT_EQ(0u, sessions[2].queries_count);
+  ASSERT_EQ(2u, SessionMultiProxy::choose_session(sessions));
+
+  // a session with failed queries is avoided even if it is faster
+  for (int i = 0; i < 5; i++) {
+    sessions[2].on_query_sent(100);
+    sessions[2].on_query_finished(0.5, 100, true);
+  }
+  ASSERT_TRUE(sessions[2].failure_rate > 0.5);
+  ASSERT_TRUE(SessionMultiProxy::choose_session(sessions) != 2u);
+
+  // the failure rate decreases after successful queries
+  for (int i = 0; i < 20; i++) {
+    sessions[2].on_query_sent(100);
+    sessions[2].on_query_finished(0.5, 100, false);
+  }
+  ASSERT_TRUE(sessions[2].failure_rate < 0.05);
+  ASSERT_EQ(2u, SessionMultiProxy::choose_session(sessions));
+}
+
+#if TD_PORT_POSIX
+static BufferSlice create_server_packet(const mtproto::AuthKey &auth_key, int64 message_id, Slice data) {
+  // auth_key_id, msg_key, then salt, session_id, message_id, seq_no, message_data_length, message_data and padding
+  constexpr size_t HEADER_SIZE = 8 + 16;
+  constexpr size_t PREFIX_SIZE = 8 + 8 + 8 + 4 + 4;
+  size_t encrypted_size = (PREFIX_SIZE + data.size() + 12 + 15) & ~static_cast<size_t>(15);
+  BufferSlice packet(HEADER_SIZE + encrypted_size);
+  auto to_encrypt = packet.as_slice().substr(HEADER_SIZE);
+  Random::secure_bytes(to_encrypt);
+  as<int64>(to_encrypt.begin() + 16) = message_id;
+  as<int32>(to_encrypt.begin() + 28) = static_cast<int32>(data.size());
+  to_encrypt.substr(PREFIX_SIZE).copy_from(data);
+
+  // messages from the server are encrypted with X = 8
+  auto message_key = mtproto::Transport::calc_message_key2(auth_key, 8, to_encrypt).second;
+  UInt256 aes_key;
+  UInt256 aes_iv;
+  mtproto::KDF2(auth_key.key(), message_key, 8, &aes_key, &aes_iv);
+  aes_ige_encrypt(as_slice(aes_key), as_slice(aes_iv), to_encrypt, to_encrypt);
+
+  as<uint64>(packet.as_slice().begin()) = auth_key.id();
+  packet.as_slice().substr(8).copy_from(as_slice(message_key));
+  return packet;
+}
+
+static std::pair<vector<std::pair<int64, string>>, Status> receive_server_packets(const mtproto::AuthKey &auth_key,
+                                                                                 Slice frames, size_t packet_count,
+                                                                                 bool use_crypto_workers) {
+  int fds[2];
+  CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  auto client_fd = SocketFd::from_native_fd(NativeFd(fds[0])).move_as_ok();
+  auto server_fd = SocketFd::from_native_fd(NativeFd(fds[1])).move_as_ok();
+
+  auto connection = mtproto::RawConnection::create(IPAddress(), BufferedFd<SocketFd>(std::move(client_fd)),
+                                                   mtproto::TransportType{mtproto::TransportType::Tcp, 0,
+                                                                          mtproto::ProxySecret()},
+                                                   nullptr);
+  connection->set_use_crypto_workers(use_crypto_workers);
+
+  class Callback final : public mtproto::RawConnection::Callback {
+   public:
+    vector<std::pair<int64, string>> packets;
+
+    Status on_raw_packet(const mtproto::PacketInfo &info, BufferSlice packet) final {
+      // the packet begins with message_id, seq_no and message_data_length
+      packets.emplace_back(static_cast<int64>(info.message_id), packet.as_slice().substr(16).str());
+      return Status::OK();
+    }
+  };
+  Callback callback;
+
+  // all frames are written in advance if they fit into the socket buffers, so several large packets are read at once
+  Status status;
+  while (true) {
+    if (!frames.empty()) {
+      server_fd.get_poll_info().add_flags_from_poll(PollFlags::Write());
+      frames.remove_prefix(server_fd.write(frames).move_as_ok());
+    }
+    connection->get_poll_info().add_flags_from_poll(PollFlags::Read());
+    status = connection->flush(auth_key, callback);
+    if (status.is_error() || (frames.empty() && callback.packets.size() == packet_count)) {
+      break;
+    }
+  }
+  return {std::move(callback.packets), std::move(status)};
+}
+
+TEST(Mtproto, parallel_packet_decryption) {
+  string auth_key_data(256, '\0');
+  Random::secure_bytes(auth_key_data);
+  mtproto::AuthKey auth_key(Random::secure_uint64(), std::move(auth_key_data));
+
+  // large packets are decrypted by CryptoWorkerPool, small ones are decrypted in the current thread
+  const size_t packet_sizes[] = {100000, 128, 70000, 65536, 4, 200000};
+  vector<std::pair<int64, string>> expected_packets;
+  vector<BufferSlice> packets;
+  for (size_t i = 0; i < 6; i++) {
+    string data(packet_sizes[i], static_cast<char>('a' + i));
+    Random::secure_bytes(MutableSlice(data).substr(0, 4));
+    int64 message_id = 1000 + static_cast<int64>(i) * 4;
+    packets.push_back(create_server_packet(auth_key, message_id, data));
+    expected_packets.emplace_back(message_id, std::move(data));
+  }
+
+  auto create_frames = [&packets] {
+    string frames;
+    for (auto &packet : packets) {
+      string length(4, '\0');
+      as<uint32>(&length[0]) = narrow_cast<uint32>(packet.size());
+      frames += length;
+      frames += packet.as_slice().str();
+    }
+    return frames;
+  };
+
+  for (auto use_crypto_workers : {false, true}) {
+    auto result = receive_server_packets(auth_key, create_frames(), packets.size(), use_crypto_workers);
+    ASSERT_TRUE(result.second.is_ok());
+    ASSERT_TRUE(result.first == expected_packets);
+  }
+
+  // a damaged large packet must fail the connection after all preceding packets are handled in order
+  packets[3].as_slice()[packets[3].size() / 2] ^= 1;
+  auto serial_result = receive_server_packets(auth_key, create_frames(), packets.size(), false);
+  auto parallel_result = receive_server_packets(auth_key, create_frames(), packets.size(), true);
+  ASSERT_TRUE(serial_result.second.is_error());
+  ASSERT_TRUE(parallel_result.second.is_error());
+  ASSERT_EQ(serial_result.second.message(), parallel_result.second.message());
+  expected_packets.resize(3);
+  ASSERT_TRUE(serial_result.first == expected_packets);
+  ASSERT_TRUE(parallel_result.first == expected_packets);
+}
+#endif
@@ -972,6 +972,29 @@ TEST(Client, Manager) {
   }
 }
 
+TEST(Client, ManagerReceiveBatch) {
+  td::ClientManager client;
+  int clients_n = 100;
+  for (int i = 0; i < clients_n; i++) {
+    auto id = client.create_client_id();
+    client.send(id, 3, td::make_tl_object<td::td_api::testSquareInt>(3));
+  }
+
+  std::set<td::int32> ids;
+  while (ids.size() != static_cast<size_t>(clients_n)) {
+    auto responses = client.receive_batch(10, 10);
+    ASSERT_TRUE(!responses.empty());
+    ASSERT_TRUE(responses.size() <= 10u);
+    for (auto &response : responses) {
+      ASSERT_TRUE(response.object != nullptr);
+      if (response.request_id == 3) {
+        ASSERT_EQ(td::td_api::testInt::ID, response.object->get_id());
+        ASSERT_TRUE(ids.insert(response.client_id).second);
+      }
+    }
+  }
+}
+
 #if !TD_EVENTFD_UNSUPPORTED  // Client must be used from a single thread if there is no EventFd
 TEST(Client, Close) {
   std::atomic<bool> stop_send{false};